@@ -0,0 +1,352 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "ABConveyorConfiguration.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+/// A seeded simulation run of the benchmark catalogue
+struct Workload {
+    const string name;
+    const size_t capacity;
+    const size_t duration;
+    const size_t slots;
+    const bool verbose;
+    const uint64_t seed;
+};
+
+/// What is recorded for every workload, both when measuring and in the baseline file
+struct Measurement {
+    double wallSeconds;
+    double slotsPerSecond;
+    long peakRssKb;
+    size_t productCount;
+    size_t dropCount;
+    /// time spent constructing the configuration, before the first timeslot
+    double startupSeconds;
+};
+
+struct Tolerances {
+    double time = 0.25;
+    double memory = 0.25;
+    size_t count = 0;
+    /// absolute slack on top of the relative time tolerance for startup, which is too short
+    /// on small configurations to be compared relatively alone
+    double startupSlack = 0.005;
+};
+
+// The catalogue is fixed on purpose: changing it invalidates every stored baseline.
+const vector<Workload> catalogue = {
+        {"small_short_quiet",   5,    1,  400000, false, 1},
+        {"small_long_quiet",    5,    20, 400000, false, 2},
+        {"large_short_quiet",   1000, 1,  4000,   false, 3},
+        {"large_long_quiet",    1000, 20, 4000,   false, 4},
+        {"small_short_verbose", 5,    1,  20000,  true,  5},
+        {"small_long_verbose",  5,    20, 20000,  true,  6},
+        {"large_short_verbose", 200,  1,  500,    true,  7},
+        {"large_long_verbose",  200,  20, 500,    true,  8},
+        {"huge_startup",        2000000, 1, 4,    false, 9},
+};
+
+const string usage = ""
+                     "usage: conveyor_sim_bench [-h] [-b baseline] [-w output] [-f filter] [-r repeats]\n"
+                     "                          [-t tolerance] [-m tolerance] [-k tolerance]\n"
+                     "\n"
+                     "Runs a fixed catalogue of seeded conveyor_sim workloads, each in its own process,\n"
+                     "and records wall time, timeslots per second, peak RSS, startup time and the\n"
+                     "product and drop counts. When a baseline file is given, every workload is compared against it and\n"
+                     "the exit code is non-zero if any of them regressed.\n"
+                     "\n"
+                     "optional arguments:\n"
+                     "-h              show this help message and exit\n"
+                     "-b baseline     baseline file to compare the measurements against\n"
+                     "-w output       write the measurements to a file in the baseline format\n"
+                     "-f filter       only run workloads whose name contains the filter\n"
+                     "-r repeats      runs per workload; the fastest run is kept (default = 3)\n"
+                     "-t tolerance    relative tolerance of wall time, timeslots per second and startup time\n"
+                     "                (default = 0.25)\n"
+                     "-m tolerance    relative tolerance of peak RSS (default = 0.25)\n"
+                     "-k tolerance    absolute tolerance of the product and drop counts (default = 0)\n";
+
+// Parses a decimal unsigned 64 bit integer, rejecting signs, trailing characters and overflow
+bool parseUnsigned(const string& text, uint64_t& value) {
+    if (text.empty() || text.front() < '0' || text.front() > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Parses a non-negative finite decimal number, rejecting trailing characters
+bool parseTolerance(const string& text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    const double parsed = strtod(text.c_str(), &end);
+    if (text.empty() || errno == ERANGE || *end != '\0' || !isfinite(parsed) || parsed < 0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Reports an option value the parsers rejected
+int invalidValue(const char& option, const char* value, const string& expected) {
+    cerr << "conveyor_sim_bench: -" << option << " expects " << expected << ", got '" << value << "'" << endl;
+    return 1;
+}
+
+/// Runs a workload in a forked child process, so that the peak RSS reported by the kernel
+/// belongs to that workload alone.
+bool measure(const Workload& workload, Measurement& result) {
+    int fds[2];
+    if (pipe(fds)) {
+        return false;
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (!pid) {
+        close(fds[0]);
+        ofstream sink("/dev/null");
+        const auto construction = chrono::steady_clock::now();
+        ABConveyorConfiguration sim(workload.capacity, workload.duration, workload.seed);
+        const auto start = chrono::steady_clock::now();
+        if (workload.verbose) {
+            for (size_t slot = 0; slot < workload.slots; slot++) {
+                sim.run(1);
+                sink << sim << endl;
+            }
+        } else {
+            sim.run(workload.slots);
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        Measurement m{};
+        m.wallSeconds = elapsed.count();
+        m.startupSeconds = chrono::duration<double>(start - construction).count();
+        m.slotsPerSecond = workload.slots / m.wallSeconds;
+        m.productCount = sim.getProductCount();
+        m.dropCount = sim.getDropCount();
+        const bool written = write(fds[1], &m, sizeof(m)) == sizeof(m);
+        close(fds[1]);
+        _exit(written ? 0 : 1);
+    }
+    close(fds[1]);
+    const bool received = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage{};
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) || !received) {
+        return false;
+    }
+    result.peakRssKb = usage.ru_maxrss;
+    return true;
+}
+
+bool readBaseline(const string& path, map<string, Measurement>& baseline) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string name;
+        Measurement m{};
+        if (!(fields >> name >> m.wallSeconds >> m.slotsPerSecond >> m.peakRssKb >> m.productCount >> m.dropCount)) {
+            cerr << path << ": malformed baseline line: " << line << endl;
+            return false;
+        }
+        // Baselines recorded before startup time was measured lack the last column
+        if (!(fields >> m.startupSeconds)) {
+            m.startupSeconds = 0;
+        }
+        baseline[name] = m;
+    }
+    return true;
+}
+
+bool writeBaseline(const string& path, const vector<pair<string, Measurement>>& measurements) {
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "# name wall_s slots_per_s peak_rss_kb product_count drop_count startup_s" << endl;
+    for (const auto& [name, m]: measurements) {
+        out << name << " " << setprecision(6) << m.wallSeconds << " " << m.slotsPerSecond << " " << m.peakRssKb
+            << " " << m.productCount << " " << m.dropCount << " " << m.startupSeconds << endl;
+    }
+    return static_cast<bool>(out);
+}
+
+/// Returns a description of every way in which *m* regressed with respect to *base*
+vector<string> regressions(const Measurement& m, const Measurement& base, const Tolerances& tol) {
+    vector<string> found;
+    const auto countDiff = [](const size_t& a, const size_t& b) { return a > b ? a - b : b - a; };
+    if (countDiff(m.productCount, base.productCount) > tol.count) {
+        found.push_back("product count " + to_string(m.productCount) + " != " + to_string(base.productCount));
+    }
+    if (countDiff(m.dropCount, base.dropCount) > tol.count) {
+        found.push_back("drop count " + to_string(m.dropCount) + " != " + to_string(base.dropCount));
+    }
+    if (m.wallSeconds > base.wallSeconds * (1 + tol.time)) {
+        found.push_back("wall time " + to_string(m.wallSeconds) + "s > " + to_string(base.wallSeconds) + "s");
+    }
+    if (m.slotsPerSecond < base.slotsPerSecond * (1 - tol.time)) {
+        found.push_back("slots/s " + to_string(m.slotsPerSecond) + " < " + to_string(base.slotsPerSecond));
+    }
+    if (m.peakRssKb > base.peakRssKb * (1 + tol.memory)) {
+        found.push_back("peak RSS " + to_string(m.peakRssKb) + "kB > " + to_string(base.peakRssKb) + "kB");
+    }
+    if (base.startupSeconds > 0 && m.startupSeconds > base.startupSeconds * (1 + tol.time) + tol.startupSlack) {
+        found.push_back("startup " + to_string(m.startupSeconds) + "s > " + to_string(base.startupSeconds) + "s");
+    }
+    return found;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    string baselinePath;
+    string outputPath;
+    string filter;
+    size_t repeats = 3;
+    Tolerances tol;
+
+    for(;;) {
+        switch(getopt(argc, argv, "hb:w:f:r:t:m:k:")) {
+            case 'h':
+                cout << usage << endl;
+                return 0;
+            case 'b':
+                baselinePath = optarg;
+                continue;
+            case 'w':
+                outputPath = optarg;
+                continue;
+            case 'f':
+                filter = optarg;
+                continue;
+            case 'r': {
+                uint64_t parsed = 0;
+                if (!parseUnsigned(optarg, parsed)) {
+                    return invalidValue('r', optarg, "an unsigned 64 bit integer");
+                }
+                repeats = max<uint64_t>(1, parsed);
+                continue;
+            }
+            case 't':
+                if (!parseTolerance(optarg, tol.time)) {
+                    return invalidValue('t', optarg, "a non-negative number");
+                }
+                continue;
+            case 'm':
+                if (!parseTolerance(optarg, tol.memory)) {
+                    return invalidValue('m', optarg, "a non-negative number");
+                }
+                continue;
+            case 'k': {
+                uint64_t parsed = 0;
+                if (!parseUnsigned(optarg, parsed)) {
+                    return invalidValue('k', optarg, "an unsigned 64 bit integer");
+                }
+                tol.count = parsed;
+                continue;
+            }
+            default:
+                cout << usage << endl;
+                return 2;
+            case -1:
+                break;
+        }
+        break;
+    }
+
+    map<string, Measurement> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) {
+        cerr << "could not read baseline file " << baselinePath << endl;
+        return 2;
+    }
+
+    vector<pair<string, Measurement>> measurements;
+    size_t regressed = 0;
+    cout << left << setw(22) << "workload" << right << setw(12) << "wall [s]" << setw(14) << "slots/s"
+         << setw(12) << "RSS [kB]" << setw(12) << "startup [s]" << setw(12) << "products" << setw(10) << "drops"
+         << "  status" << endl;
+    for (const auto& workload: catalogue) {
+        if (workload.name.find(filter) == string::npos) {
+            continue;
+        }
+        Measurement best{};
+        for (size_t rep = 0; rep < repeats; rep++) {
+            Measurement m{};
+            if (!measure(workload, m)) {
+                cerr << workload.name << ": measurement failed" << endl;
+                return 2;
+            }
+            if (!rep || m.wallSeconds < best.wallSeconds) {
+                best = m;
+            }
+        }
+        measurements.emplace_back(workload.name, best);
+
+        string status = "measured";
+        vector<string> found;
+        if (!baselinePath.empty()) {
+            const auto base = baseline.find(workload.name);
+            if (base == baseline.end()) {
+                status = "no baseline";
+            } else {
+                found = regressions(best, base->second, tol);
+                status = found.empty() ? "ok" : "REGRESSION";
+            }
+        }
+        cout << left << setw(22) << workload.name << right << fixed << setprecision(4) << setw(12)
+             << best.wallSeconds << setprecision(0) << setw(14) << best.slotsPerSecond << setw(12) << best.peakRssKb
+             << setprecision(4) << setw(12) << best.startupSeconds << setw(12) << best.productCount << setw(10) << best.dropCount << "  " << status << endl;
+        cout.unsetf(ios::fixed);
+        for (const auto& what: found) {
+            cout << "    " << what << endl;
+        }
+        regressed += !found.empty();
+    }
+
+    if (!outputPath.empty() && !writeBaseline(outputPath, measurements)) {
+        cerr << "could not write baseline file " << outputPath << endl;
+        return 2;
+    }
+    if (regressed) {
+        cout << regressed << " workload(s) regressed" << endl;
+        return 1;
+    }
+    return 0;
+}
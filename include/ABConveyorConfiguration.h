@@ -4,11 +4,20 @@
 
 #pragma once
 
+#include <cstdint>
+#include <iosfwd>
 #include <memory>
+#include <optional>
+#include <vector>
 #include <experimental/propagate_const>
+#include "ItemPN.h"
 #include "SimulationComponentIF.h"
 
 namespace conveyorsim {
+
+class SimulationStatistics;
+enum class ArbitrationPolicy : std::uint8_t;
+
 /// This is a class that encapsulates the logic for running a conveyor belt simulation.
 ///
 /// Its parameters is the conveyor capacity and the duration required for assembling an
@@ -23,9 +32,10 @@ namespace conveyorsim {
 ///  * For every timeslot:
 ///     * an item is generated (or not) from the generator and enqueued on the first position
 ///       of the conveyor belt.
-///     * for every position on the belt, one of the workers is given priority at random to
-///       either get an Item from the position (if an item exists on the position) or to
-///       deposit an Item that it had previously created on that position.
+///     * for every position on the belt, one of the workers is given priority by the
+///       arbitration policy (see ArbitrationPolicy) to either get an Item from the position
+///       (if an item exists on the position) or to deposit an Item that it had previously
+///       created on that position.
 ///         * the created Item has ItemPN equal to 'P' and it takes both 'A' and 'B' items
 ///           to be collected from the belt by the worker to be created.
 ///         * creation time is parameterized as described above
@@ -42,11 +52,30 @@ namespace conveyorsim {
 class ABConveyorConfiguration : public SimulationComponentIF {
 public:
 
+    /// Constructor for the ABConveyorConfiguration object, with the GlobalRandom arbitration
+    /// policy
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' Item
+    /// \param seed master seed of the simulation; when given, the item generation and the worker
+    ///        priority draws are reproducible across runs. When absent, they are seeded from
+    ///        std::random_device.
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* exceeds
+    ///         WorkerSpec::MaxAssemblyDuration
+    explicit ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration,
+                                     const std::optional<std::uint64_t>& seed = std::nullopt);
+
     /// Constructor for the ABConveyorConfiguration object
     ///
     /// \param convCap capacity of the conveyor belt
     /// \param assemblyDuration duration for a single worker to construct a 'P' Item
-    explicit ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration);
+    /// \param seed master seed of the simulation, as above
+    /// \param arbitration policy deciding which worker of a position acts first; random
+    ///        policies draw from the worker priority stream of *seed*
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* exceeds
+    ///         WorkerSpec::MaxAssemblyDuration
+    ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration,
+                            const std::optional<std::uint64_t>& seed, const ArbitrationPolicy& arbitration);
 
     // Defined in the implementation file, where impl is a complete type
     ~ABConveyorConfiguration();
@@ -54,6 +83,46 @@ public:
     /// \copydoc SimulationComponentIF::run() See the class description for details.
     void run(const size_t& numSlots) override;
 
+    /// Runs the simulation for a single timeslot with externally supplied random draws.
+    ///
+    /// run() draws the generated item and the worker priority of every timeslot from its own
+    /// random streams and then behaves exactly like this method. Supplying the draws instead
+    /// lets several configurations be driven by identical streams (see
+    /// CommonRandomNumbersComparison).
+    /// \param generated part number of the item enqueued on the first position, or nullopt
+    ///        for no item
+    /// \param topFirst true if the top workers act before the bottom workers of their position
+    void runSlot(const std::optional<ItemPN>& generated, const bool& topFirst);
+
+    /// Runs the simulation for a single timeslot with an externally supplied generated item and
+    /// worker order per position.
+    ///
+    /// \param generated part number of the item enqueued on the first position, or nullopt
+    ///        for no item
+    /// \param topFirst a bit per position as described by ArbitrationPolicyIF, set if the top
+    ///        worker of the position acts before its bottom worker
+    void runSlot(const std::optional<ItemPN>& generated, const std::vector<std::uint64_t>& topFirst);
+
+    /// Returns the simulation to its initial state: an empty belt, idle workers and zero counts.
+    ///
+    /// Statistics collection, if enabled, starts over with the same number of segments, and the
+    /// arbitration policy starts over as well.
+    /// \param seed master seed of the simulation from now on, as for the constructor
+    void reset(const std::optional<std::uint64_t>& seed = std::nullopt);
+
+    /// Restarts the random streams from a master seed, keeping the belt, the workers, the counts
+    /// and the statistics as they are. The arbitration policy starts over.
+    ///
+    /// \param seed master seed of the simulation from now on, as for the constructor
+    void reseed(const std::optional<std::uint64_t>& seed);
+
+    /// Returns whether run() hands its timeslots to a FixedShapeEngine, which it does for the
+    /// capacities in FixedShapeCapacities as long as statistics are not enabled. The results are
+    /// the same either way.
+    ///
+    /// \return true if run() uses a FixedShapeEngine
+    [[nodiscard]] bool usesFixedShapeEngine() const;
+
     /// Returns the number of 'P' items that made it through the belt
     ///
     /// \return number of 'P' items that made it through the belt by the end of the simulation run
@@ -65,6 +134,31 @@ public:
     ///         run.
     [[nodiscard]] size_t getDropCount() const;
 
+    /// Returns the item on the last position of the belt, which leaves it at the beginning of the
+    /// next timeslot
+    ///
+    /// \return part number of the item on the last position, or nullopt if it is empty
+    [[nodiscard]] std::optional<ItemPN> peekLastItem() const;
+
+    /// Returns the number of belt positions currently holding an item, in constant time
+    ///
+    /// \return number of occupied belt positions
+    [[nodiscard]] size_t getOccupiedPositions() const;
+
+    /// Starts collecting latency and utilization distributions for the timeslots run from now on.
+    ///
+    /// Items placed on the belt are stamped with the timeslot they were placed at, so that the
+    /// workers can report how long they rode on it. See SimulationStatistics for the collected
+    /// distributions.
+    /// \param numSegments number of belt segments the distributions are reported for
+    /// \throws invalid_argument if *numSegments* is 0
+    void enableStatistics(const size_t& numSegments);
+
+    /// Returns the collected latency and utilization distributions
+    ///
+    /// \return the collected distributions, or nullptr if enableStatistics() was never called
+    [[nodiscard]] const SimulationStatistics* getStatistics() const;
+
     /// Insertion operator
     ///
     /// Inserts a string representation of this simulation at a specific timeslot into an output
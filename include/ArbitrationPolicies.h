@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "ArbitrationPolicyIF.h"
+
+namespace conveyorsim {
+
+/// The arbitration policies an ABConveyorConfiguration can use
+enum class ArbitrationPolicy : std::uint8_t {
+    /// one random draw per timeslot orders the workers of every position alike
+    GlobalRandom,
+    /// every position orders its workers at random, independently of the others
+    PositionRandom,
+    /// every position alternates which worker acts first
+    RoundRobin,
+    /// at every position, the worker served less recently acts first
+    LeastRecentlyServed
+};
+
+/// Parses the name of an arbitration policy: "global-random", "position-random", "round-robin"
+/// or "least-recently-served"
+///
+/// \param name the name of the policy
+/// \return the policy, or nullopt if *name* names none
+[[nodiscard]] std::optional<ArbitrationPolicy> parseArbitrationPolicy(const std::string& name);
+
+/// Creates an arbitration policy
+///
+/// \param policy the policy to create
+/// \param convCap capacity of the conveyor belt
+/// \param seed seed of the random policies
+/// \return the created policy
+[[nodiscard]] std::unique_ptr<ArbitrationPolicyIF> makeArbitrationPolicy(const ArbitrationPolicy& policy,
+                                                                         const std::size_t& convCap,
+                                                                         const std::uint64_t& seed);
+
+/// This class orders the workers of all positions alike, top first with probability 1/3 as
+/// ABConveyorConfiguration always did.
+///
+/// One draw decides the whole belt, so arbitration is correlated across positions.
+class GlobalRandomArbitration : public ArbitrationPolicyIF {
+public:
+    /// Constructor for GlobalRandomArbitration objects
+    ///
+    /// \param seed seed of the priority draws
+    explicit GlobalRandomArbitration(const std::uint64_t& seed);
+
+    void arbitrate(std::vector<std::uint64_t>& topFirst) override;
+    [[nodiscard]] bool tracksService() const override;
+    void served(const std::vector<std::uint64_t>& top, const std::vector<std::uint64_t>& bottom) override;
+
+private:
+    std::mt19937 rng;
+    std::uniform_int_distribution<std::size_t> udst;
+};
+
+/// This class orders the workers of every position by a fair coin of its own.
+///
+/// A 64 bit random word decides 64 positions, so a belt of up to 64 positions costs a single
+/// draw per timeslot, as GlobalRandomArbitration does.
+class PositionRandomArbitration : public ArbitrationPolicyIF {
+public:
+    /// Constructor for PositionRandomArbitration objects
+    ///
+    /// \param seed seed of the priority draws
+    explicit PositionRandomArbitration(const std::uint64_t& seed);
+
+    void arbitrate(std::vector<std::uint64_t>& topFirst) override;
+    [[nodiscard]] bool tracksService() const override;
+    void served(const std::vector<std::uint64_t>& top, const std::vector<std::uint64_t>& bottom) override;
+
+private:
+    std::mt19937_64 rng;
+};
+
+/// This class alternates which worker of every position acts first.
+///
+/// Neighbouring positions start with opposite workers, so that half of the belt gives the top
+/// workers priority in any timeslot.
+class RoundRobinArbitration : public ArbitrationPolicyIF {
+public:
+    /// Constructor for RoundRobinArbitration objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    explicit RoundRobinArbitration(const std::size_t& convCap);
+
+    void arbitrate(std::vector<std::uint64_t>& topFirst) override;
+    [[nodiscard]] bool tracksService() const override;
+    void served(const std::vector<std::uint64_t>& top, const std::vector<std::uint64_t>& bottom) override;
+
+private:
+    std::vector<std::uint64_t> next;
+};
+
+/// This class gives priority, at every position, to the worker that collected or placed an item
+/// less recently; the top worker goes first until either was served.
+class LeastRecentlyServedArbitration : public ArbitrationPolicyIF {
+public:
+    /// Constructor for LeastRecentlyServedArbitration objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    explicit LeastRecentlyServedArbitration(const std::size_t& convCap);
+
+    void arbitrate(std::vector<std::uint64_t>& topFirst) override;
+    [[nodiscard]] bool tracksService() const override;
+    void served(const std::vector<std::uint64_t>& top, const std::vector<std::uint64_t>& bottom) override;
+
+private:
+    // a bit per position, set if its top worker was served more recently than its bottom one
+    std::vector<std::uint64_t> topServedLast;
+};
+
+} // conveyorsim
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This is an abstract class that decides, every timeslot, which of the two workers of every
+/// belt position acts first.
+///
+/// Decisions are bit-sliced: position pos maps to bit pos % 64 of word pos / 64, so that a
+/// policy decides 64 positions with a single word operation.
+class ArbitrationPolicyIF {
+public:
+    virtual ~ArbitrationPolicyIF() = default;
+
+    /// Decides the order of the workers of every position for the next timeslot
+    ///
+    /// \param topFirst receives a bit per position, set if its top worker acts before its
+    ///        bottom worker; it holds a word per 64 positions
+    virtual void arbitrate(std::vector<std::uint64_t>& topFirst) = 0;
+
+    /// Returns whether the policy takes into account which workers were served
+    ///
+    /// \return true if served() must be called after every timeslot
+    [[nodiscard]] virtual bool tracksService() const = 0;
+
+    /// Reports which workers collected or placed an item in the timeslot just run
+    ///
+    /// \param top a bit per position, set if its top worker was served
+    /// \param bottom a bit per position, set if its bottom worker was served
+    virtual void served(const std::vector<std::uint64_t>& top, const std::vector<std::uint64_t>& bottom) = 0;
+};
+
+} // conveyorsim
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <experimental/propagate_const>
+#include "BoundaryChannelIF.h"
+#include "SimulationComponentIF.h"
+
+namespace conveyorsim {
+
+/// This class simulates one contiguous segment of the belt of an ABConveyorConfiguration, so
+/// that a belt too large for one process can be split over several.
+///
+/// The segment has its own belt and workers. Every timeslot, the item on its last position is
+/// sent downstream instead of leaving the belt, and the item received from upstream is placed
+/// on its first position instead of a generated one. Workers only ever act on their own
+/// position, so the segments together behave exactly like the whole belt:
+///  * the first segment generates the items, with the stream a seeded ABConveyorConfiguration
+///    would use
+///  * every segment draws the worker priority from the same stream, seeded from the master
+///    seed they all share
+///  * the last segment counts the items that leave the belt
+/// A sharded run therefore reproduces the unsharded ABConveyorConfiguration run with the same
+/// seed, whatever the number of segments.
+class BeltShard : public SimulationComponentIF {
+public:
+    /// Constructor for BeltShard objects
+    ///
+    /// \param segmentCap number of belt positions in the segment
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param seed master seed shared by all segments of the belt
+    /// \param input channel from the segment upstream, or nullptr for the first segment
+    /// \param output channel to the segment downstream, or nullptr for the last segment
+    /// \throws invalid_argument if *segmentCap* is 0
+    BeltShard(const size_t& segmentCap, const size_t& assemblyDuration, const std::uint64_t& seed,
+              BoundaryChannelIF* input, BoundaryChannelIF* output);
+
+    // Defined in the implementation file, where impl is a complete type
+    ~BeltShard() override;
+
+    /// \copydoc SimulationComponentIF::run() See the class description for details.
+    void run(const size_t& numSlots) override;
+
+    /// Returns the number of 'P' items that left the segment; for the last segment, these are
+    /// the products that made it through the belt
+    ///
+    /// \return number of 'P' items that left the segment
+    [[nodiscard]] size_t getProductCount() const;
+
+    /// Returns the number of 'A' and 'B' items that left the segment unused; for the last
+    /// segment, these are the unused items that made it through the belt
+    ///
+    /// \return number of 'A' and 'B' items that left the segment
+    [[nodiscard]] size_t getDropCount() const;
+
+private:
+    class impl;
+    std::experimental::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+} // conveyorsim
@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <optional>
+#include "ItemPN.h"
+
+namespace conveyorsim {
+
+/// Abstract interface of the link between two consecutive segments of a sharded belt.
+///
+/// Every timeslot, the segment upstream sends the item leaving its last position (or the
+/// absence of one) and the segment downstream receives it onto its first position, in order.
+/// Implementations decide the transport: ShmSpscChannel connects processes on one machine
+/// through shared memory, and a network transport only has to implement this interface.
+class BoundaryChannelIF {
+public:
+    virtual ~BoundaryChannelIF() = default;
+
+    /// Sends the item that left the upstream segment in a timeslot, waiting while the channel
+    /// is full
+    ///
+    /// \param item part number of the item, or nullopt if no item left the segment
+    virtual void send(const std::optional<ItemPN>& item) = 0;
+
+    /// Receives the item that left the upstream segment in the next timeslot, waiting while
+    /// the channel is empty
+    ///
+    /// \return part number of the item, or nullopt if no item left the segment
+    [[nodiscard]] virtual std::optional<ItemPN> receive() = 0;
+};
+
+} // conveyorsim
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This class finds the smallest belt capacity whose product rate meets a target, for a given
+/// assembly duration.
+///
+/// The product rate grows with the capacity, so the search bisects the capacities between 1 and
+/// a maximum. Every candidate capacity is simulated by a LockstepReplicaEngine, whose replicas
+/// run in parallel batches after a warm-up of a belt length. Every replica contributes the
+/// product rate of every batch as an observation to a sequential probability ratio test, which
+/// stops as soon as it decides whether the rate is above or below the target:
+///  * the hypotheses are a rate of target * (1 + indifference) and of
+///    target * (1 - indifference); rates within that zone may be decided either way
+///  * the observations are treated as normal, with the variance estimated from the
+///    observations so far
+///  * the test decides "above" wrongly with probability at most alpha and "below" wrongly with
+///    probability at most beta; a test still undecided after the maximum number of timeslots
+///    decides by the sign of the mean and is reported as truncated
+///
+/// The answer is right if every decision on the bisection path is, so its confidence is at
+/// least 1 minus the sum of the error bounds of those decisions, with truncated decisions
+/// counting 1/2.
+class CapacityOptimizer {
+public:
+    /// Parameters of the sequential tests
+    struct Settings {
+        /// bound on the probability of deciding above the target for a rate below the zone
+        double alpha = 0.01;
+        /// bound on the probability of deciding below the target for a rate above the zone
+        double beta = 0.01;
+        /// half width of the indifference zone, relative to the target
+        double indifference = 0.01;
+        /// timeslots per batch; 0 picks the larger of 1000 and 10 times the capacity
+        std::size_t batchSlots = 0;
+        /// timeslots after which a test is truncated, warm-up included
+        std::size_t maxSlots = 10000000;
+    };
+
+    /// The outcome of the test of a single capacity
+    struct Decision {
+        std::size_t capacity;
+        /// true if the product rate was decided to meet the target
+        bool meetsTarget;
+        /// mean product rate per timeslot over all observations
+        double productRate;
+        /// number of observations, that is replicas times batches
+        std::size_t observations;
+        /// timeslots run by every replica, warm-up included
+        std::size_t slots;
+        /// true if the test reached the maximum number of timeslots undecided
+        bool truncated;
+    };
+
+    /// The outcome of a search
+    struct Result {
+        /// the smallest capacity meeting the target, or nullopt if the maximum capacity did not
+        std::optional<std::size_t> capacity;
+        /// lower bound on the probability that the answer is right
+        double confidence;
+        /// timeslots run over all replicas of all candidates
+        std::size_t totalSlots;
+        /// the tests in the order they were run
+        std::vector<Decision> decisions;
+    };
+
+    /// Constructor for CapacityOptimizer objects
+    ///
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param targetRate the product rate per timeslot to be met
+    /// \param maxCapacity largest capacity searched
+    /// \param seed master seed of the replicas of all candidates; when absent, they are seeded
+    ///        from std::random_device
+    /// \param settings parameters of the sequential tests
+    /// \throws invalid_argument if *targetRate* is not positive, *maxCapacity* is 0, or the
+    ///         settings are out of range
+    CapacityOptimizer(const std::size_t& assemblyDuration, const double& targetRate,
+                      const std::size_t& maxCapacity, const std::optional<std::uint64_t>& seed,
+                      const Settings& settings);
+
+    /// Constructor for CapacityOptimizer objects with the default Settings
+    ///
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param targetRate the product rate per timeslot to be met
+    /// \param maxCapacity largest capacity searched
+    /// \param seed master seed of the replicas of all candidates; when absent, they are seeded
+    ///        from std::random_device
+    /// \throws invalid_argument if *targetRate* is not positive or *maxCapacity* is 0
+    CapacityOptimizer(const std::size_t& assemblyDuration, const double& targetRate,
+                      const std::size_t& maxCapacity, const std::optional<std::uint64_t>& seed = std::nullopt);
+
+    /// Searches the smallest capacity meeting the target
+    ///
+    /// \return the capacity found and its confidence
+    [[nodiscard]] Result run() const;
+
+    /// Tests whether a capacity meets the target
+    ///
+    /// \param capacity the capacity to test
+    /// \return the decision of the sequential test
+    [[nodiscard]] Decision test(const std::size_t& capacity) const;
+
+private:
+    const std::size_t assemblyDuration;
+    const double targetRate;
+    const std::size_t maxCapacity;
+    const std::optional<std::uint64_t> seed;
+    const Settings settings;
+};
+
+} // conveyorsim
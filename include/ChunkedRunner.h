@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "SimulationComponentIF.h"
+
+namespace conveyorsim {
+
+/// This class runs a simulation component in chunks of timeslots, so that long runs can report
+/// their progress and be stopped between chunks.
+///
+/// Everything that is not simulation (the callback after every chunk, checking whether a stop
+/// was requested) happens once per chunk, so it costs nothing per timeslot as long as chunks are
+/// long enough.
+///
+/// A stop can be requested from a signal handler; installSignalHandlers() makes SIGINT and
+/// SIGTERM do so. The component then stops at the end of the chunk it is running, at a timeslot
+/// boundary, and its statistics cover exactly the timeslots run. A second signal terminates the
+/// process as usual.
+class ChunkedRunner {
+public:
+    /// Constructor for ChunkedRunner objects
+    ///
+    /// \param chunkSlots number of timeslots per chunk
+    /// \throws invalid_argument if *chunkSlots* is 0
+    explicit ChunkedRunner(const std::uint64_t& chunkSlots);
+
+    /// Runs a component for a number of timeslots, or until a stop is requested.
+    ///
+    /// \param component the component to run
+    /// \param numSlots number of timeslots to run
+    /// \param afterChunk called after every chunk with the number of timeslots run so far
+    /// \return number of timeslots run, less than *numSlots* if a stop was requested
+    std::uint64_t run(SimulationComponentIF& component, const std::uint64_t& numSlots,
+                      const std::function<void(const std::uint64_t&)>& afterChunk = nullptr) const;
+
+    /// Makes the first SIGINT or SIGTERM request a stop instead of terminating the process.
+    static void installSignalHandlers();
+
+    /// Requests every run to stop at the end of its current chunk. This is async-signal-safe.
+    static void requestStop();
+
+    /// Withdraws a stop request, so that the following runs go ahead again
+    static void clearStopRequest();
+
+    /// Returns whether a stop was requested
+    ///
+    /// \return true if a stop was requested
+    [[nodiscard]] static bool stopRequested();
+
+    /// Returns the signal that requested the stop
+    ///
+    /// \return the signal number, or 0 if no signal requested a stop
+    [[nodiscard]] static int getStopSignal();
+
+private:
+    const std::uint64_t chunkSlots;
+};
+
+} // conveyorsim
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This class compares variants of ABConveyorConfiguration with common random numbers.
+///
+/// Every variant (a capacity and an assembly duration) is simulated in lockstep with the
+/// others, and all of them are driven by a single item generator and a single worker priority
+/// stream: every timeslot, one item is drawn and one priority is drawn, and both are handed to
+/// every variant. A variant therefore behaves exactly like a seeded ABConveyorConfiguration of
+/// its own, but the noise the variants share cancels out of their differences.
+///
+/// The measured timeslots are split into equal batches. The batch means of every variant and
+/// the batch means of the paired differences against the first variant give Student t
+/// confidence intervals. Comparing the variance of the paired differences with the variance
+/// two independent runs would have estimates how many times fewer timeslots the comparison
+/// needs for the same precision.
+class CommonRandomNumbersComparison {
+public:
+    /// A configuration variant
+    struct Variant {
+        std::size_t capacity;
+        std::size_t assemblyDuration;
+    };
+
+    /// A batch means estimate of a rate per timeslot
+    struct Estimate {
+        double mean;
+        /// half width of the 95% confidence interval around the mean
+        double halfWidth;
+    };
+
+    /// The rates of a single variant
+    struct VariantResult {
+        Variant variant;
+        /// 'P' items that made it through the belt during the measured timeslots
+        std::size_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt during the measured timeslots
+        std::size_t dropCount;
+        Estimate productRate;
+        Estimate dropRate;
+    };
+
+    /// The paired difference of a variant against the first variant
+    struct Difference {
+        Variant variant;
+        Estimate productRate;
+        Estimate dropRate;
+        /// variance of independent runs over variance of the paired differences, for the
+        /// product and the drop rate; infinite when the paired differences do not vary
+        double productVarianceReduction;
+        double dropVarianceReduction;
+    };
+
+    /// The outcome of a comparison
+    struct Result {
+        std::size_t warmupSlots;
+        std::size_t batchSlots;
+        std::size_t numBatches;
+        /// one entry per variant, in the order they were given
+        std::vector<VariantResult> variants;
+        /// one entry per variant but the first one, in the order they were given
+        std::vector<Difference> differences;
+    };
+
+    /// Constructor for CommonRandomNumbersComparison objects
+    ///
+    /// \param variants the configurations to compare; the first one is the reference the
+    ///        others are compared against
+    /// \param seed master seed of the shared random streams, as for ABConveyorConfiguration.
+    ///        When absent, they are seeded from std::random_device.
+    /// \throws invalid_argument if *variants* is empty or a variant has zero capacity
+    explicit CommonRandomNumbersComparison(const std::vector<Variant>& variants,
+                                           const std::optional<std::uint64_t>& seed = std::nullopt);
+
+    /// Runs the variants and compares them.
+    ///
+    /// \param numSlots number of timeslots to run, warm-up included; the timeslots left over
+    ///        after splitting the measured timeslots into equal batches are not run
+    /// \param numBatches number of batches the measured timeslots are split into
+    /// \param warmupSlots number of timeslots run before measuring, while the belts fill up
+    /// \return the estimated rates and paired differences
+    /// \throws invalid_argument if *numBatches* is less than 2 or there are fewer measured
+    ///         timeslots than batches
+    [[nodiscard]] Result run(const std::size_t& numSlots, const std::size_t& numBatches = 30,
+                             const std::size_t& warmupSlots = 0) const;
+
+private:
+    const std::vector<Variant> variants;
+    const std::optional<std::uint64_t> seed;
+};
+
+} // conveyorsim
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "ConveyorBeltIF.h"
+#include "MemoryPlacement.h"
 #include "SimulationComponentIF.h"
 #include <experimental/propagate_const>
 #include <memory>
@@ -73,9 +74,29 @@ public:
     /// \copydoc ConveyorBeltIF::getCapacity
     [[nodiscard]] size_t getCapacity() const override;
 
+    /// Returns the number of positions holding an item, which the belt keeps count of as items
+    /// come and go
+    ///
+    /// \return number of occupied positions
+    [[nodiscard]] size_t getOccupiedPositions() const;
+
     /// \copydoc SimulationComponentIF::run See class description for details.
     void run(const size_t& numSlots) override;
 
+    /// Removes every Item object from the conveyor belt and clears every reservation, without
+    /// reallocating the belt
+    void clear();
+
+    /// Overwrites a position with an Item object, or none, and a reservation, so that a state
+    /// kept elsewhere can be restored
+    ///
+    /// \param pos position on the conveyor belt
+    /// \param item the Item object on *pos*, or nullopt for none
+    /// \param reservation whether *pos* is reserved
+    /// \throws out_of_range if the *pos* argument indicates a position
+    ///         beyond the capacity of the conveyor belt
+    void restore(const size_t& pos, std::optional<Item>&& item, const bool& reservation);
+
 private:
     /// Returns true if the *pos* argument represents a position on the capacity
     /// of the conveyor belt, false otherwise
@@ -90,7 +111,7 @@ private:
     void rotate();
     void print(std::ostream& os) const override;
 
-    std::vector<bool> reserved;
+    PlacedVector<bool> reserved;
 
     class impl;
     std::experimental::propagate_const<std::unique_ptr<impl>> pImpl;
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PackedABState.h"
+#include "PeriodicItemGenerator.h"
+
+namespace conveyorsim {
+
+/// This class runs an ABConveyorConfiguration whose items and worker priorities follow fixed
+/// patterns, and skips over the timeslots once the run is found to repeat itself.
+///
+/// With periodic inputs the run is deterministic, and as a belt has finitely many states, the
+/// state of the belt and its workers together with the phases of the patterns eventually
+/// repeats, after which every timeslot repeats the one a cycle earlier. The engine runs a
+/// PackedABState and finds the cycle with Brent's algorithm: it keeps a single saved state,
+/// replaced by the current one whenever the number of timeslots since it was saved reaches a
+/// power of two, and compares every new state with it. The first match is a whole cycle, of
+/// the length of the timeslots since the state was saved, and the counts of the remaining
+/// timeslots follow from the counts of that cycle, leaving only the remainder of the timeslots
+/// that do not fill a cycle to run. Finding a cycle takes a small multiple of the timeslots
+/// before it starts and its length, and memory for two states.
+class CycleDetectingEngine {
+public:
+    /// The outcome of a run
+    struct Result {
+        /// 'P' items that made it through the belt
+        std::uint64_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt
+        std::uint64_t dropCount;
+        /// timeslots actually run
+        std::uint64_t simulatedSlots;
+        /// length of the cycle in timeslots, or 0 if none was found
+        std::uint64_t cycleLength;
+        /// timeslot at which the state was found to repeat, or 0 if it was not
+        std::uint64_t detectionSlot;
+        /// wall time of the run in seconds
+        double seconds;
+    };
+
+    /// Constructor for CycleDetectingEngine objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param generator generator of the items, from its current phase on; only 'A' and 'B'
+    ///        items are supported
+    /// \param topFirst the worker priority of every timeslot, repeated: true if the top workers
+    ///        act before the bottom workers
+    /// \param detectCycles false to run every timeslot
+    /// \throws invalid_argument if *convCap* is 0, *assemblyDuration* does not fit in 32 bits,
+    ///         *topFirst* is empty or the pattern of *generator* has items other than 'A' and 'B'
+    CycleDetectingEngine(const std::size_t& convCap, const std::size_t& assemblyDuration,
+                         const PeriodicItemGenerator& generator, const std::vector<bool>& topFirst,
+                         const bool& detectCycles = true);
+
+    /// Runs an empty belt with idle workers for a number of timeslots
+    ///
+    /// \param numSlots number of timeslots to run
+    /// \return the counts of the run and how they were found
+    [[nodiscard]] Result run(const std::uint64_t& numSlots) const;
+
+private:
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    std::vector<PackedItem> items;
+    const std::vector<bool> topFirst;
+    const bool detectCycles;
+};
+
+} // conveyorsim
@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace conveyorsim {
+
+/// Engines that run a seeded ABConveyorConfiguration to the same counts
+enum class EngineKind : std::uint8_t {
+    /// ABConveyorConfiguration: Worker objects, or the fixed-shape engine for small belts
+    Objects,
+    /// a PackedABState, on one thread (TimeWarpEngine with a single segment)
+    Packed,
+    /// conservative TimeWarpEngine, a thread per segment
+    TimeWarp,
+    /// ShardLauncher, a process per segment
+    Sharded,
+};
+
+/// An engine and how many threads or processes it runs on
+struct EngineChoice {
+    EngineKind kind;
+    std::size_t threads;
+
+    bool operator==(const EngineChoice& other) const;
+};
+
+/// This class picks the fastest engine for a configuration on the machine it runs on.
+///
+/// Every engine reproduces the run of a seeded ABConveyorConfiguration, so the choice is only a
+/// matter of speed, which depends on the capacity, the assembly duration and the cores of the
+/// machine. The candidates are every engine on every power of two of threads up to the
+/// threads it may use, and that many threads themselves. Each is probed for a short run of a belt of
+/// the capacity, capped to keep probing short, and the one updating the most positions per
+/// second is picked.
+///
+/// The rates are saved in a profile, a text file with a line per probe, keyed by the host, the
+/// cores, and the capacity and the assembly duration rounded down to a power of two, so that
+/// later runs of similar configurations on the same machine pick their engine without probing.
+class EngineCalibration {
+public:
+    /// Largest belt the engines are probed with
+    static constexpr std::size_t ProbeCapacity = 1U << 16U;
+    /// Position updates a probe runs, at least
+    static constexpr std::uint64_t ProbeUpdates = 1U << 23U;
+
+    /// The rate an engine was measured at
+    struct Probe {
+        EngineChoice engine;
+        /// belt positions updated per second
+        double updatesPerSecond;
+    };
+
+    /// The outcome of select()
+    struct Selection {
+        /// the fastest engine
+        EngineChoice engine;
+        /// the rates of all candidates
+        std::vector<Probe> probes;
+        /// true if the rates were read from the profile rather than measured
+        bool cached;
+    };
+
+    /// The counts of a run
+    struct Counts {
+        std::uint64_t productCount;
+        std::uint64_t dropCount;
+        /// timeslots run, fewer than asked if a stop was requested
+        std::uint64_t numSlots;
+    };
+
+    /// Constructor for EngineCalibration objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param maxThreads most threads or processes an engine may use
+    /// \param profilePath path of the profile, or empty to neither read nor save one
+    /// \throws invalid_argument if *convCap* or *maxThreads* is 0
+    EngineCalibration(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::size_t& maxThreads,
+                      const std::string& profilePath);
+
+    /// Picks the fastest engine, from the profile if it has the rates of the configuration and
+    /// by probing the candidates otherwise; probed rates are saved to the profile
+    ///
+    /// \param recalibrate true to probe even if the profile has the rates
+    /// \return the fastest engine and the rates of all candidates
+    [[nodiscard]] Selection select(const bool& recalibrate) const;
+
+    /// Returns the engines select() picks from
+    ///
+    /// \return the candidates, the single-threaded ones first
+    [[nodiscard]] std::vector<EngineChoice> candidates() const;
+
+    /// Measures the rate of an engine
+    ///
+    /// \param engine the engine
+    /// \return the rate of *engine*
+    [[nodiscard]] Probe probe(const EngineChoice& engine) const;
+
+    /// Runs a seeded configuration on an engine, until a stop is requested through ChunkedRunner
+    ///
+    /// \param engine the engine
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param seed master seed of the run
+    /// \param numSlots number of timeslots to run
+    /// \return the counts of the run, the same on every engine for the same timeslots
+    [[nodiscard]] static Counts run(const EngineChoice& engine, const std::size_t& convCap,
+                                    const std::size_t& assemblyDuration, const std::uint64_t& seed,
+                                    const std::uint64_t& numSlots);
+
+    /// Returns the name of an engine
+    ///
+    /// \param kind the engine
+    /// \return its name, as in the profile
+    [[nodiscard]] static std::string getName(const EngineKind& kind);
+
+    /// Returns where the profile of the user is kept
+    ///
+    /// \return $XDG_CACHE_HOME/conveyor_sim/calibration, or ~/.cache/conveyor_sim/calibration,
+    ///         or nullopt if neither variable is set
+    [[nodiscard]] static std::optional<std::string> getDefaultProfilePath();
+
+private:
+    // Key of the configuration in the profile
+    [[nodiscard]] std::string getKey() const;
+    [[nodiscard]] std::vector<Probe> load() const;
+    void save(const std::vector<Probe>& probes) const;
+
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    const std::size_t maxThreads;
+    const std::string profilePath;
+};
+
+} // conveyorsim
@@ -0,0 +1,240 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "ArbitrationPolicyIF.h"
+#include "ItemPN.h"
+#include "PackedABState.h"
+#include "TraceRecorder.h"
+#include "UniformRandomItemGenerator.h"
+
+namespace conveyorsim {
+
+/// The interface through which an ABConveyorConfiguration runs a FixedShapeEngine of whatever
+/// capacity it was instantiated for.
+class FixedShapeEngineIF {
+public:
+    virtual ~FixedShapeEngineIF() = default;
+
+    /// Runs a number of timeslots, drawing the generated item and the worker order of every
+    /// timeslot as ABConveyorConfiguration::run() does
+    ///
+    /// \param numSlots number of timeslots to run
+    /// \param generator generator of the 'A' and 'B' items
+    /// \param arbiter policy deciding which worker of a position acts first
+    /// \param productCount incremented for every 'P' item that leaves the belt
+    /// \param dropCount incremented for every 'A' or 'B' item that leaves the belt
+    virtual void run(const std::size_t& numSlots, const UniformRandomItemGenerator& generator,
+                     ArbitrationPolicyIF& arbiter, std::size_t& productCount, std::size_t& dropCount) = 0;
+
+    /// Returns the capacity of the conveyor belt
+    ///
+    /// \return capacity of the conveyor belt
+    [[nodiscard]] virtual std::size_t getCapacity() const = 0;
+
+    /// Returns the contents of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return contents of *pos*
+    [[nodiscard]] virtual PackedItem getItem(const std::size_t& pos) const = 0;
+
+    /// Returns whether a belt position was acted on in the last timeslot
+    ///
+    /// \param pos position on the belt
+    /// \return true if *pos* is reserved
+    [[nodiscard]] virtual bool isReserved(const std::size_t& pos) const = 0;
+
+    /// Returns the state of the top worker of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return the top worker of *pos*
+    [[nodiscard]] virtual const PackedWorker& getTopWorker(const std::size_t& pos) const = 0;
+
+    /// Returns the state of the bottom worker of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return the bottom worker of *pos*
+    [[nodiscard]] virtual const PackedWorker& getBottomWorker(const std::size_t& pos) const = 0;
+
+    /// Overwrites the state of a belt position and its workers
+    ///
+    /// \param pos position on the belt
+    /// \param item contents of *pos*
+    /// \param reservation whether *pos* was acted on in the last timeslot
+    /// \param top state of the top worker of *pos*
+    /// \param bottom state of the bottom worker of *pos*
+    virtual void setPosition(const std::size_t& pos, const PackedItem& item, const bool& reservation,
+                             const PackedWorker& top, const PackedWorker& bottom) = 0;
+};
+
+/// This class runs an ABConveyorConfiguration whose capacity is known at compile time.
+///
+/// The recipe is the one of PackedWorker, two arms assembling a 'P' from an 'A' and a 'B', so a
+/// position and its two workers take 18 bytes, all kept in std::array members: a belt of 64
+/// positions and its workers fit in about 1.2 KB, without a heap allocation or an indirection.
+/// The belt shifts its items instead of rotating a head index, so that every position stays at
+/// a constant index, and the loop over the positions is unrolled at compile time, with the
+/// worker steps inlined into it.
+///
+/// Given the same draws, a timeslot does exactly what ABConveyorConfiguration::runSlot() does.
+/// Capacities up to MaxCapacity can be instantiated; the worker order of all positions fits in
+/// a single word of the arbitration policy.
+template <std::size_t Cap>
+class FixedShapeEngine : public FixedShapeEngineIF {
+public:
+    /// Largest capacity a FixedShapeEngine can be instantiated for
+    static constexpr std::size_t MaxCapacity = 64;
+    static_assert(Cap >= 1 && Cap <= MaxCapacity, "a FixedShapeEngine holds between 1 and 64 positions");
+
+    /// Constructor for FixedShapeEngine objects, with an empty belt and idle workers
+    ///
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    explicit FixedShapeEngine(const std::uint32_t& assemblyDuration) :
+            assemblyDuration(assemblyDuration)
+    { }
+
+    /// Runs one timeslot of the configuration.
+    ///
+    /// \tparam TrackService whether to report the workers that were served, see ArbitrationPolicyIF
+    /// \param generated the item placed on the first position
+    /// \param topFirst a bit per position, set if its top worker acts before its bottom worker
+    /// \param topServed set to a bit per position, set if its top worker was served
+    /// \param bottomServed set to a bit per position, set if its bottom worker was served
+    /// \return the item that left the belt
+    template <bool TrackService>
+    PackedItem step(const PackedItem& generated, const std::uint64_t& topFirst, std::uint64_t& topServed,
+                    std::uint64_t& bottomServed) {
+        // The last item leaves and every other one moves on; for at most 64 bytes this is
+        // cheaper than the index arithmetic of a circular buffer
+        const PackedItem exited = belt[Cap - 1];
+        {
+            TraceScope trace(TracePhase::Rotation);
+            for (std::size_t pos = Cap - 1; pos > 0; pos--) {
+                belt[pos] = belt[pos - 1];
+            }
+            belt[0] = generated;
+        }
+        topServed = 0;
+        bottomServed = 0;
+        TraceScope trace(TracePhase::WorkerSweep);
+        stepPositions<TrackService>(std::make_index_sequence<Cap>(), topFirst, topServed, bottomServed);
+        return exited;
+    }
+
+    void run(const std::size_t& numSlots, const UniformRandomItemGenerator& generator,
+             ArbitrationPolicyIF& arbiter, std::size_t& productCount, std::size_t& dropCount) override {
+        if (arbiter.tracksService()) {
+            runSlots<true>(numSlots, generator, arbiter, productCount, dropCount);
+        } else {
+            runSlots<false>(numSlots, generator, arbiter, productCount, dropCount);
+        }
+    }
+
+    [[nodiscard]] std::size_t getCapacity() const override {
+        return Cap;
+    }
+
+    [[nodiscard]] PackedItem getItem(const std::size_t& pos) const override {
+        return belt.at(pos);
+    }
+
+    [[nodiscard]] bool isReserved(const std::size_t& pos) const override {
+        return reserved.at(pos);
+    }
+
+    [[nodiscard]] const PackedWorker& getTopWorker(const std::size_t& pos) const override {
+        return topWorkers.at(pos);
+    }
+
+    [[nodiscard]] const PackedWorker& getBottomWorker(const std::size_t& pos) const override {
+        return bottomWorkers.at(pos);
+    }
+
+    void setPosition(const std::size_t& pos, const PackedItem& item, const bool& reservation,
+                     const PackedWorker& top, const PackedWorker& bottom) override {
+        belt.at(pos) = item;
+        reserved.at(pos) = reservation;
+        topWorkers.at(pos) = top;
+        bottomWorkers.at(pos) = bottom;
+    }
+
+private:
+    template <bool TrackService>
+    void runSlots(const std::size_t& numSlots, const UniformRandomItemGenerator& generator,
+                  ArbitrationPolicyIF& arbiter, std::size_t& productCount, std::size_t& dropCount) {
+        const ItemPN pnA('A');
+        for (std::size_t slot = 0; slot < numSlots; slot++) {
+            TraceRecorder::nextSlot();
+            PackedItem generated;
+            {
+                TraceScope trace(TracePhase::Generation);
+                const auto item = generator.get_next_item();
+                arbiter.arbitrate(topFirst);
+                generated = !item.has_value() ? PackedItem::Empty
+                            : item.value().getPN() == pnA ? PackedItem::A : PackedItem::B;
+            }
+            const PackedItem exited = step<TrackService>(generated, topFirst[0], topServed[0], bottomServed[0]);
+            productCount += exited == PackedItem::P;
+            dropCount += exited == PackedItem::A || exited == PackedItem::B;
+            if constexpr (TrackService) {
+                arbiter.served(topServed, bottomServed);
+            }
+        }
+    }
+
+    template <bool TrackService, std::size_t... Pos>
+    void stepPositions(std::index_sequence<Pos...>, const std::uint64_t& topFirst, std::uint64_t& topServed,
+                       std::uint64_t& bottomServed) {
+        (stepPosition<TrackService, Pos>(topFirst, topServed, bottomServed), ...);
+    }
+
+    template <bool TrackService, std::size_t Pos>
+    void stepPosition(const std::uint64_t& topFirst, std::uint64_t& topServed, std::uint64_t& bottomServed) {
+        const bool top = (topFirst >> Pos) & 1U;
+        PackedWorker& first = top ? topWorkers[Pos] : bottomWorkers[Pos];
+        PackedWorker& second = top ? bottomWorkers[Pos] : topWorkers[Pos];
+        bool taken = false;
+        first.step(belt[Pos], taken, assemblyDuration);
+        const bool firstServed = taken;
+        second.step(belt[Pos], taken, assemblyDuration);
+        reserved[Pos] = taken;
+        if constexpr (TrackService) {
+            const bool secondServed = taken && !firstServed;
+            topServed |= static_cast<std::uint64_t>(top ? firstServed : secondServed) << Pos;
+            bottomServed |= static_cast<std::uint64_t>(top ? secondServed : firstServed) << Pos;
+        }
+    }
+
+    const std::uint32_t assemblyDuration;
+    std::array<PackedItem, Cap> belt{};
+    std::array<bool, Cap> reserved{};
+    std::array<PackedWorker, Cap> topWorkers{};
+    std::array<PackedWorker, Cap> bottomWorkers{};
+    // The arbitration policies take their words in vectors; these are sized once
+    std::vector<std::uint64_t> topFirst = std::vector<std::uint64_t>(1);
+    std::vector<std::uint64_t> topServed = std::vector<std::uint64_t>(1);
+    std::vector<std::uint64_t> bottomServed = std::vector<std::uint64_t>(1);
+};
+
+/// The capacities a FixedShapeEngine is instantiated for
+inline constexpr std::array<std::size_t, 20> FixedShapeCapacities = {
+        1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 24, 32, 48, 64
+};
+
+/// Creates the FixedShapeEngine of a capacity, if it is one of FixedShapeCapacities
+///
+/// \param convCap capacity of the conveyor belt
+/// \param assemblyDuration duration for a single worker to construct a 'P' item
+/// \return the engine, or nullptr if *convCap* is not instantiated
+[[nodiscard]] std::unique_ptr<FixedShapeEngineIF> makeFixedShapeEngine(const std::size_t& convCap,
+                                                                       const std::uint32_t& assemblyDuration);
+
+} // conveyorsim
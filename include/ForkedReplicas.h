@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This class runs independent replicas of an ABConveyorConfiguration that share a single
+/// warm-up.
+///
+/// A replica only yields meaningful statistics after the transient of filling the belt and
+/// starting the workers. Instead of every replica running it, one ABConveyorConfiguration runs
+/// the warm-up, and the process then forks a child per replica. A child starts with the
+/// warmed-up belt and workers as copy-on-write pages of the parent, so it starts at once and
+/// only copies the pages it changes. Every child restarts the random streams of the
+/// configuration from a seed of its own, runs the timeslots, and reports what it counted
+/// after the warm-up through shared memory.
+class ForkedReplicas {
+public:
+    /// The counts of a replica after the warm-up
+    struct Counts {
+        /// 'P' items that made it through the belt
+        std::uint64_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt
+        std::uint64_t dropCount;
+    };
+
+    /// The outcome of a run
+    struct Result {
+        /// the counts of every replica
+        std::vector<Counts> replicas;
+        /// wall time of the warm-up in seconds
+        double warmupSeconds;
+        /// wall time from the first fork to the last replica finishing in seconds
+        double replicaSeconds;
+    };
+
+    /// Constructor for ForkedReplicas objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param numReplicas number of replicas
+    /// \param seed master seed of the warm-up; the replicas draw from seeds derived from it
+    /// \param maxRunning most replica processes running at a time, which bounds the pages they
+    ///        copy; 0 picks the number of hardware threads
+    /// \throws invalid_argument if *convCap* or *numReplicas* is 0
+    ForkedReplicas(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::size_t& numReplicas,
+                   const std::uint64_t& seed, const std::size_t& maxRunning = 0);
+
+    /// Runs the warm-up, then every replica for a number of timeslots, and waits for them
+    ///
+    /// \param warmupSlots number of timeslots of the shared warm-up
+    /// \param numSlots number of timeslots every replica runs after the warm-up
+    /// \return the counts of every replica
+    /// \throws system_error if the shared memory or the replica processes cannot be created
+    /// \throws runtime_error if a replica fails
+    [[nodiscard]] Result run(const std::size_t& warmupSlots, const std::size_t& numSlots) const;
+
+    /// Returns the master seed a replica continues with after the warm-up
+    ///
+    /// \param seed master seed of the warm-up
+    /// \param replica index of the replica
+    /// \return the master seed of *replica*, distinct for every replica
+    [[nodiscard]] static std::uint64_t getReplicaSeed(const std::uint64_t& seed, const std::size_t& replica);
+
+private:
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    const std::size_t numReplicas;
+    const std::uint64_t seed;
+    const std::size_t maxRunning;
+};
+
+} // conveyorsim
@@ -10,25 +10,32 @@ namespace conveyorsim {
 
 /// This class represents items in the simulation.
 ///
-/// Item objects, as it currently stands, only contain an ItemPN part number
-/// object as its state. Future implementations could include more details
-/// relevant to the simulation (like weight, quality, etc)
+/// Item objects, as it currently stands, contain an ItemPN part number object and
+/// the timeslot at which they were placed on the conveyor belt as their state.
+/// Future implementations could include more details relevant to the simulation
+/// (like weight, quality, etc)
 class Item {
 public:
     /// Constructor for Item
     ///
     /// \param pn the ItemPN part number of the item
-    explicit Item(const ItemPN& pn);
+    /// \param enqueueSlot the timeslot at which the item was placed on the conveyor belt
+    explicit Item(const ItemPN& pn, const std::size_t& enqueueSlot = 0);
 
     /// Returns the ItemPN part number of the item
     ///
     /// \return ItemPN of the item
     [[nodiscard]] ItemPN getPN() const;
 
+    /// Returns the timeslot at which the item was placed on the conveyor belt
+    ///
+    /// \return the enqueue timeslot of the item
+    [[nodiscard]] std::size_t getEnqueueSlot() const;
+
     /// Equality operator
     ///
     /// Returns true if the ItemPN part number of both objects is the same,
-    /// false otherwise.
+    /// false otherwise. The enqueue timeslot does not take part in the comparison.
     /// \param other the item object this object compares to
     /// \return true if the objects are equal, false otherwise.
     bool operator==(const Item& other) const;
@@ -44,6 +51,7 @@ public:
 private:
     friend std::hash<Item>;
     ItemPN pn;
+    std::size_t enqueueSlot;
 };
 
 } // conveyorsim
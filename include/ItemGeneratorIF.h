@@ -5,6 +5,7 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 #include "Item.h"
 
 namespace conveyorsim {
@@ -13,7 +14,8 @@ namespace conveyorsim {
 class ItemGeneratorIF {
 public:
 
-    ~ItemGeneratorIF() = default;
+    // Virtual, so that generators can be deleted through this interface
+    virtual ~ItemGeneratorIF() = default;
 
     /// Returns a vector with the next Item objects produced by the generator object.
     ///
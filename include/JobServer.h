@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <experimental/propagate_const>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace conveyorsim {
+
+/// This class runs simulation jobs for as long as it lives, so that many short queries pay for
+/// process startup once.
+///
+/// A job is a line of whitespace separated fields:
+///
+///     id capacity duration timeslots seed [replicas]
+///
+/// where *id* is echoed back with the result, *seed* is an unsigned 64 bit integer or "-" for
+/// random seeds, and *replicas* defaults to 1 and is at most MaxReplicas. Replica r of a job
+/// simulates an ABConveyorConfiguration seeded with getReplicaSeed(*seed*, r), so replica 0
+/// reproduces the sim mode of conveyor_sim with the same seed. Empty lines and lines starting with '#' are ignored.
+///
+/// Every replica is a task of a thread pool, and a job's result is written as soon as its last
+/// replica finishes, so results come back in the order jobs complete rather than the order they
+/// were submitted:
+///
+///     id ok mean-product-count mean-drop-count product-rate drop-rate
+///     id error message
+///
+/// with the rates per timeslot. Configurations are reset and kept after a replica finishes, and
+/// replicas of the same capacity and duration reuse them instead of constructing new ones; the
+/// idle configurations hold at most a given number of belt positions altogether.
+///
+/// A stop requested through ChunkedRunner ends running replicas at the end of their current
+/// chunk, and their jobs report an error.
+class JobServer {
+public:
+    /// Largest number of replicas of a job; every replica is queued as a task of its own
+    static constexpr std::size_t MaxReplicas = 1U << 16U;
+
+    /// A parsed job
+    struct Job {
+        std::string id;
+        std::size_t capacity;
+        std::size_t assemblyDuration;
+        std::uint64_t numSlots;
+        /// master seed of replica 0, or nullopt for random seeds
+        std::optional<std::uint64_t> seed;
+        std::size_t replicas;
+    };
+
+    /// The outcome of a job, averaged over its replicas
+    struct Result {
+        std::string id;
+        double meanProductCount;
+        double meanDropCount;
+        /// products per timeslot, 0 for jobs of no timeslots
+        double productRate;
+        /// drops per timeslot, 0 for jobs of no timeslots
+        double dropRate;
+    };
+
+    /// Parses a job line
+    ///
+    /// \param line the line, without its newline
+    /// \return the job
+    /// \throws invalid_argument if a field is missing, malformed or out of range, or there are
+    ///         trailing fields
+    [[nodiscard]] static Job parseJob(const std::string& line);
+
+    /// Formats the result line of a successful job
+    ///
+    /// \param result the outcome of the job
+    /// \return the line, without its newline
+    [[nodiscard]] static std::string formatResult(const Result& result);
+
+    /// Returns the master seed of a replica of a job
+    ///
+    /// Replica 0 keeps the seed of the job; the others derive theirs from it through their own
+    /// random stream, so the replicas of jobs with nearby seeds do not share seeds.
+    /// \param seed master seed of the job
+    /// \param replica index of the replica
+    /// \return the master seed of *replica*
+    [[nodiscard]] static std::uint64_t getReplicaSeed(const std::uint64_t& seed, const std::size_t& replica);
+
+    /// Constructor for JobServer objects; starts the thread pool
+    ///
+    /// \param numThreads number of threads of the pool; 0 picks the number of hardware threads
+    /// \param maxCachedPositions most belt positions of idle configurations kept for reuse
+    explicit JobServer(const std::size_t& numThreads = 0, const std::size_t& maxCachedPositions = 1U << 24U);
+
+    /// Destructor for JobServer objects; waits for the queued replicas and stops the thread pool
+    ~JobServer();
+
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+
+    /// Runs the jobs read from a stream until its end, and waits for their results
+    ///
+    /// Malformed lines are answered with an error line right away, under the id they start with,
+    /// or "-" if they are empty of fields.
+    /// \param in the stream jobs are read from, one per line
+    /// \param out the stream results are written to, one per line and flushed as they are written
+    void serve(std::istream& in, std::ostream& out);
+
+    /// Accepts connections on a Unix domain socket and serves every one as serve() does, until a
+    /// stop is requested through ChunkedRunner.
+    ///
+    /// An existing socket at *path* is replaced, and the socket is removed when the server stops.
+    /// Connections still open when the server stops get the results of the jobs they already sent.
+    /// Results are queued per connection and sent by the thread reading it, so a client that
+    /// does not read its results never blocks the thread pool.
+    /// \param path the path the socket is bound to
+    /// \throws invalid_argument if *path* is too long for a socket address, or exists and is not
+    ///         a socket
+    /// \throws system_error if the socket cannot be created, bound or listened on
+    void listen(const std::string& path);
+
+    /// Returns the number of configurations constructed so far; the others were reused
+    ///
+    /// \return number of configurations constructed
+    [[nodiscard]] std::size_t getConstructedCount() const;
+
+private:
+    class impl;
+    std::experimental::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+} // conveyorsim
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace conveyorsim {
+
+struct LiveMetricsSegment;
+
+/// Progress of a running simulation, as published to a LiveMetricsPublisher segment
+struct LiveMetrics {
+    /// timeslots run so far
+    std::uint64_t slot = 0;
+    /// timeslots the simulation was asked to run
+    std::uint64_t numSlots = 0;
+    std::uint64_t productCount = 0;
+    std::uint64_t dropCount = 0;
+    /// belt positions holding an item
+    std::uint64_t occupiedPositions = 0;
+    /// capacity of the conveyor belt
+    std::uint64_t capacity = 0;
+    /// timeslots per second since the previous publication
+    double slotsPerSecond = 0;
+    /// true once the simulation published its final metrics
+    bool finished = false;
+    /// true if the metrics could not be read consistently, see LiveMetricsReader::read()
+    bool torn = false;
+};
+
+/// This class publishes LiveMetrics of a simulation to a POSIX shared memory segment.
+///
+/// The segment is protected by a seqlock: publishing increments a sequence number to an odd
+/// value, stores the metrics and increments it again to an even value, all with plain atomic
+/// stores on memory the publisher owns. Publishing therefore never makes a system call, never
+/// takes a lock and never waits for readers, however many there are. Readers (see
+/// LiveMetricsReader) retry whenever the sequence number was odd or changed while they copied,
+/// up to a bound, as a publisher that died while publishing leaves it odd for good.
+///
+/// The segment is created by the constructor and removed by the destructor.
+class LiveMetricsPublisher {
+public:
+    /// Constructor for LiveMetricsPublisher objects
+    ///
+    /// \param name name of the shared memory segment, with or without the leading '/'
+    /// \throws system_error if the segment cannot be created or mapped
+    explicit LiveMetricsPublisher(const std::string& name);
+
+    ~LiveMetricsPublisher();
+    LiveMetricsPublisher(const LiveMetricsPublisher&) = delete;
+    LiveMetricsPublisher& operator=(const LiveMetricsPublisher&) = delete;
+
+    /// Publishes the metrics of the simulation, replacing the previously published ones
+    ///
+    /// \param metrics the current metrics
+    void publish(const LiveMetrics& metrics);
+
+private:
+    const std::string name;
+    LiveMetricsSegment* segment;
+};
+
+/// This class reads the LiveMetrics a LiveMetricsPublisher publishes, possibly from another
+/// process.
+class LiveMetricsReader {
+public:
+    /// Constructor for LiveMetricsReader objects
+    ///
+    /// \param name name of the shared memory segment, with or without the leading '/'
+    /// \throws system_error if the segment does not exist or cannot be mapped
+    /// \throws runtime_error if the segment was not created by a LiveMetricsPublisher
+    explicit LiveMetricsReader(const std::string& name);
+
+    ~LiveMetricsReader();
+    LiveMetricsReader(const LiveMetricsReader&) = delete;
+    LiveMetricsReader& operator=(const LiveMetricsReader&) = delete;
+
+    /// Returns a consistent copy of the latest published metrics
+    ///
+    /// Gives up after MaxReadAttempts copies that raced a publication, and then returns the
+    /// last copy with LiveMetrics::torn set. This happens when the publisher died in the middle
+    /// of publishing, and practically never otherwise.
+    /// \return the latest published metrics
+    [[nodiscard]] LiveMetrics read() const;
+
+    /// Returns the process identifier of the publisher
+    ///
+    /// \return process identifier of the process that created the segment
+    [[nodiscard]] std::int64_t getPublisherPid() const;
+
+    /// Largest number of copies read() makes before it returns a torn one
+    static constexpr std::size_t MaxReadAttempts = 1000;
+
+private:
+    const LiveMetricsSegment* segment;
+};
+
+} // conveyorsim
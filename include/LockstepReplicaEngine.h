@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "PackedABState.h"
+
+namespace conveyorsim {
+
+/// This class runs several independent replicas of an ABConveyorConfiguration in lockstep.
+///
+/// Replicas of the same configuration execute the same sequence of actions every timeslot and
+/// only differ in their data, so they are laid out lane by lane: for every belt position, the
+/// item, worker flags and countdowns of all replicas are stored next to each other, and lane i
+/// of every one of those vectors belongs to replica i, as does lane i of the random number
+/// generator state. Every timeslot walks the positions once and updates all lanes of a position
+/// with the same straight-line code, in which the actions a worker does not take are masked out
+/// instead of branched around. The compiler turns these loops into vector instructions, which
+/// keeps the vector units busy even for belts too short to parallelize across positions.
+///
+/// The worker actions are those of PackedWorker::step, and every lane draws its generated item
+/// and worker priority with the probabilities of ABConveyorConfiguration::run, from its own
+/// xoshiro128+ generator. The replicas are therefore statistically equivalent to independent
+/// ABConveyorConfiguration runs, although their random streams differ.
+class LockstepReplicaEngine {
+public:
+    /// Number of replicas run per pass
+    static constexpr std::size_t Lanes = 16;
+
+    /// Constructor for LockstepReplicaEngine objects, with empty belts and idle workers
+    ///
+    /// \param convCap capacity of the conveyor belts
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param seed master seed of the replicas; when given, every replica is reproducible across
+    ///        runs. When absent, they are seeded from std::random_device.
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* does not fit in 32 bits
+    LockstepReplicaEngine(const std::size_t& convCap, const std::size_t& assemblyDuration,
+                          const std::optional<std::uint64_t>& seed = std::nullopt);
+
+    /// Runs all replicas for a number of timeslots, drawing their items and priorities from
+    /// their own random streams.
+    ///
+    /// \param numSlots number of timeslots to run
+    void run(const std::size_t& numSlots);
+
+    /// Runs all replicas for a single timeslot with externally supplied random draws.
+    ///
+    /// Lane by lane, this does what PackedABState::step does with the same draws.
+    /// \param generated the item placed on the first position of every replica
+    /// \param topFirst per replica, true if its top workers act before its bottom workers
+    void step(const std::array<PackedItem, Lanes>& generated, const std::array<bool, Lanes>& topFirst);
+
+    /// Returns the number of 'P' items that made it through the belt of a replica
+    ///
+    /// \param lane the replica
+    /// \return number of 'P' items that left the belt of *lane*
+    [[nodiscard]] std::size_t getProductCount(const std::size_t& lane) const;
+
+    /// Returns the number of unused 'A' and 'B' items that made it through the belt of a replica
+    ///
+    /// \param lane the replica
+    /// \return number of unused items that left the belt of *lane*
+    [[nodiscard]] std::size_t getDropCount(const std::size_t& lane) const;
+
+    /// Returns the contents of a belt position of a replica
+    ///
+    /// \param lane the replica
+    /// \param pos position on the belt
+    /// \return contents of *pos*
+    [[nodiscard]] PackedItem peekItem(const std::size_t& lane, const std::size_t& pos) const;
+
+    /// Returns the state of the top worker of a belt position of a replica
+    ///
+    /// \param lane the replica
+    /// \param pos position on the belt
+    /// \return the top worker of *pos*
+    [[nodiscard]] PackedWorker getTopWorker(const std::size_t& lane, const std::size_t& pos) const;
+
+    /// Returns the state of the bottom worker of a belt position of a replica
+    ///
+    /// \param lane the replica
+    /// \param pos position on the belt
+    /// \return the bottom worker of *pos*
+    [[nodiscard]] PackedWorker getBottomWorker(const std::size_t& lane, const std::size_t& pos) const;
+
+    /// Returns the capacity of the conveyor belts
+    ///
+    /// \return capacity of the conveyor belts
+    [[nodiscard]] std::size_t getCapacity() const;
+
+private:
+    /// A value per replica; everything is 32 bits wide so that all lanes of a position fill
+    /// the same number of vector registers
+    using LaneVector = std::array<std::uint32_t, Lanes>;
+
+    void step(const LaneVector& generated, const LaneVector& topFirst);
+    [[nodiscard]] std::size_t physical(const std::size_t& pos) const;
+
+    const std::size_t convCap;
+    const std::uint32_t assemblyDuration;
+    std::size_t head = 0;
+
+    // Per position, in the order of the physical belt for the items and of the logical
+    // positions for the workers
+    std::vector<LaneVector> belt;
+    std::vector<LaneVector> topFlags;
+    std::vector<LaneVector> topCountdowns;
+    std::vector<LaneVector> bottomFlags;
+    std::vector<LaneVector> bottomCountdowns;
+
+    std::array<LaneVector, 4> rngState;
+    std::array<std::uint64_t, Lanes> productCounts{};
+    std::array<std::uint64_t, Lanes> dropCounts{};
+};
+
+} // conveyorsim
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+namespace conveyorsim {
+
+/// This class is a histogram of non-negative integer values with logarithmically sized buckets.
+///
+/// It follows the layout of HDR histograms: values below 2^SubBucketBits are counted exactly,
+/// and every power-of-two range above that is split into 2^SubBucketBits equally sized
+/// sub-buckets. The relative error of any reported value is therefore bounded by
+/// 2^-SubBucketBits, while the memory of the histogram is constant regardless of how many
+/// values are recorded or how large they are.
+class LogHistogram {
+public:
+    static constexpr unsigned SubBucketBits = 5;
+    static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+    static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+    /// Records a value.
+    ///
+    /// \param value the recorded value
+    void record(const std::uint64_t& value);
+
+    /// Adds the counts of another histogram to this one.
+    ///
+    /// \param other the histogram that is added
+    void merge(const LogHistogram& other);
+
+    /// Returns the number of recorded values.
+    ///
+    /// \return number of recorded values
+    [[nodiscard]] std::uint64_t getCount() const;
+
+    /// Returns the smallest recorded value, or 0 if no value was recorded.
+    ///
+    /// \return the smallest recorded value
+    [[nodiscard]] std::uint64_t getMin() const;
+
+    /// Returns the largest recorded value, or 0 if no value was recorded.
+    ///
+    /// \return the largest recorded value
+    [[nodiscard]] std::uint64_t getMax() const;
+
+    /// Returns the exact mean of the recorded values, or 0 if no value was recorded.
+    ///
+    /// \return the mean of the recorded values
+    [[nodiscard]] double getMean() const;
+
+    /// Returns the value below or at which a given fraction of the recorded values lie.
+    ///
+    /// The returned value is the upper end of the bucket the percentile falls in, clamped to
+    /// the largest recorded value.
+    /// \param fraction fraction of the recorded values, in [0, 1]
+    /// \return the value at the given fraction, or 0 if no value was recorded
+    [[nodiscard]] std::uint64_t getPercentile(const double& fraction) const;
+
+    /// Returns the index of the bucket a value is counted in.
+    ///
+    /// \param value the value
+    /// \return the bucket index of *value*
+    [[nodiscard]] static std::size_t bucketOf(const std::uint64_t& value);
+
+    /// Returns the smallest value counted in a bucket.
+    ///
+    /// \param bucket the bucket index
+    /// \return the smallest value of *bucket*
+    [[nodiscard]] static std::uint64_t bucketLowerBound(const std::size_t& bucket);
+
+    /// Returns the largest value counted in a bucket.
+    ///
+    /// \param bucket the bucket index
+    /// \return the largest value of *bucket*
+    [[nodiscard]] static std::uint64_t bucketUpperBound(const std::size_t& bucket);
+
+    /// Insertion operator
+    ///
+    /// Inserts a one line summary of the histogram (count, mean, percentiles and extremes)
+    /// into an output stream.
+    /// \param os the output stream the string is inserted in
+    /// \param obj the LogHistogram object from which the string representation is derived
+    /// \return the os stream with the string representation of obj inserted to it
+    friend std::ostream& operator<<(std::ostream& os, const LogHistogram& obj);
+
+private:
+    std::array<std::uint64_t, BucketCount> counts{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t min = UINT64_MAX;
+    std::uint64_t max = 0;
+};
+
+} // conveyorsim
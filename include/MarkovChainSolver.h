@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace conveyorsim {
+
+/// This class computes the exact steady-state throughput of an ABConveyorConfiguration.
+///
+/// At timeslot boundaries the configuration is fully described by a PackedABState, and the
+/// next state only depends on the current one and on the random draws of the timeslot: the
+/// generated item ('A', 'B' or none, each with probability 1/3) and the worker priority (the top
+/// workers act first with probability 1/3, as ABConveyorConfiguration only gives them priority
+/// on one of three equally likely draws). The configuration is therefore a finite Markov chain.
+///
+/// The solver enumerates the states reachable from the empty belt with a hash table, builds
+/// the sparse transition matrix and solves for its stationary distribution with Gauss-Seidel
+/// iterations. The expected number of products and unused items leaving the belt per timeslot
+/// follow from the stationary probability of a 'P' or an 'A'/'B' on the last position.
+///
+/// The state space grows exponentially with the capacity, so the enumeration gives up once a
+/// configurable number of states is exceeded.
+class MarkovChainSolver {
+public:
+    /// The outcome of a successful solve
+    struct Result {
+        /// number of states reachable from the empty belt
+        std::size_t numStates;
+        /// Gauss-Seidel iterations performed
+        std::size_t iterations;
+        /// L1 norm of pi * P - pi for the returned distribution
+        double residual;
+        /// expected number of 'P' items leaving the belt per timeslot
+        double productRate;
+        /// expected number of unused 'A' and 'B' items leaving the belt per timeslot
+        double dropRate;
+    };
+
+    /// Constructor for MarkovChainSolver objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param maxStates largest number of states the solver is allowed to enumerate
+    MarkovChainSolver(const std::size_t& convCap, const std::size_t& assemblyDuration,
+                      const std::size_t& maxStates);
+
+    /// Solves for the steady state of the configuration.
+    ///
+    /// \param tolerance the iterations stop once an iteration changes the distribution by less
+    ///        than this, in L1 norm
+    /// \param maxIterations the iterations stop after this many regardless of convergence
+    /// \return the steady-state rates, or nullopt if there are more than maxStates states
+    [[nodiscard]] std::optional<Result> solve(const double& tolerance = 1e-12,
+                                              const std::size_t& maxIterations = 100000) const;
+
+private:
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    const std::size_t maxStates;
+};
+
+} // conveyorsim
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This class approximates the steady-state throughput of an ABConveyorConfiguration with a
+/// mean-field density evolution along the belt.
+///
+/// Instead of sampling the simulation, it propagates the probability that a position holds
+/// nothing, an 'A', a 'B' or a 'P' from the first position to the last:
+///  * the workers of a position are assumed to see a stream of independent items distributed
+///    like the occupancy of their position, and to be independent of each other
+///  * under that assumption every worker is a small semi-Markov chain: six idle states (the
+///    combinations of held items it can have between timeslots) and an assembly that lasts
+///    the assembly duration. Its stationary distribution is solved directly, using the same
+///    worker step as PackedABState.
+///  * the top and bottom workers see the item the other one left behind when they act second
+///    (with probability 2/3 and 1/3 respectively), so the two stationary distributions are
+///    solved for jointly by fixed point iteration
+///  * the occupancy of the next position is the occupancy after both workers acted
+///
+/// The recurrence stops at its fixed point, after which every position is the same. When the
+/// occupancy approaches it slowly rather than geometrically, the recurrence is treated as the
+/// ordinary differential equation it approximates and integrated with adaptive Heun steps
+/// that skip many positions at once. Belts of 10^8 positions are therefore approximated in
+/// milliseconds.
+///
+/// The approximation is only meant for long belts. Unused items mostly stem from the random
+/// imbalance between the 'A' and 'B' items that reach the workers, which the independence
+/// assumption leaves out: the approximated drop rate falls geometrically with the capacity,
+/// while the actual one falls roughly as its inverse. From MinCapacity positions on, both
+/// rates are within MaxRateError of simulated ones; on shorter belts drops are underestimated
+/// by up to 0.06 per timeslot and products overestimated by up to 0.03 per timeslot.
+class MeanFieldApproximation {
+public:
+    /// Smallest capacity for which the approximation is accurate
+    static constexpr std::size_t MinCapacity = 100;
+
+    /// Largest error of the product and of the drop rate per timeslot from MinCapacity on
+    static constexpr double MaxRateError = 0.005;
+
+    /// The outcome of an approximation
+    struct Result {
+        /// approximate number of 'P' items leaving the belt per timeslot
+        double productRate;
+        /// approximate number of unused 'A' and 'B' items leaving the belt per timeslot
+        double dropRate;
+        /// positions evaluated one by one
+        std::size_t exactPositions;
+        /// steps of the fluid integration over the remaining positions
+        std::size_t fluidSteps;
+    };
+
+    /// A comparison of the approximation with a simulation of the same configuration
+    struct ValidationPoint {
+        std::size_t capacity;
+        std::size_t assemblyDuration;
+        Result approximation;
+        double simulatedProductRate;
+        double simulatedDropRate;
+    };
+
+    /// Constructor for MeanFieldApproximation objects
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* does not fit in 32 bits
+    MeanFieldApproximation(const std::size_t& convCap, const std::size_t& assemblyDuration);
+
+    /// Approximates the steady-state rates of the configuration.
+    ///
+    /// \param fluidThreshold positions are evaluated one by one while the occupancy changes by
+    ///        more than this from one position to the next, in L1 norm, or while the change
+    ///        shrinks geometrically
+    /// \param stepTolerance largest change of the occupancy a fluid step may make, in L1 norm
+    /// \return the approximate rates
+    [[nodiscard]] Result solve(const double& fluidThreshold = 1e-4, const double& stepTolerance = 1e-3) const;
+
+    /// Compares the approximation against seeded simulations of ABConveyorConfiguration on a
+    /// grid of assembly durations and of capacities from MinCapacity to 100 times as many.
+    ///
+    /// \param numSlots number of timeslots the rates of every simulation are measured over, after
+    ///        the belt has filled
+    /// \param seed master seed of the simulations
+    /// \return one point per capacity and assembly duration of the grid
+    [[nodiscard]] static std::vector<ValidationPoint> validate(const std::size_t& numSlots,
+                                                               const std::uint64_t& seed);
+
+private:
+    const std::size_t convCap;
+    const std::uint32_t assemblyDuration;
+};
+
+} // conveyorsim
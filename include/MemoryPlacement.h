@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace conveyorsim {
+
+/// How MemoryPlacement places memory and threads
+struct MemoryPlacementSettings {
+    /// back large allocations with huge pages
+    bool hugePages = true;
+    /// pin the threads and processes running segments of the belt to CPUs
+    bool pinThreads = false;
+    /// stream the placement and fallback decisions are logged to, or nullptr
+    std::ostream* log = nullptr;
+};
+
+/// This class places the large state arrays of the engines in memory, and the threads running
+/// them on CPUs, for belts of hundreds of millions of positions.
+///
+/// Allocations of at least a huge page are mapped on their own, aligned to a huge page, so that
+/// the kernel can back them with huge pages, which cuts the TLB misses of sweeping them: with
+/// explicit huge pages (MAP_HUGETLB) where a pool of them is reserved, and with transparent
+/// huge pages (madvise(MADV_HUGEPAGE)) otherwise. Either way the memory is only placed when it
+/// is first touched, on the NUMA node of the CPU that touches it. The engines running segments
+/// of the belt on threads of their own therefore build every segment on the thread that runs
+/// it, which can also be pinned to a CPU, so that it stays on the node its memory is on.
+///
+/// Settings apply to the whole process, and decisions are logged as they are made.
+class MemoryPlacement {
+public:
+    /// Size of a huge page, and the smallest allocation that is mapped on its own
+    static constexpr std::size_t HugePageSize = 2U << 20U;
+
+    /// Sets how memory and threads are placed from now on
+    ///
+    /// \param settings the settings
+    static void configure(const MemoryPlacementSettings& settings);
+
+    /// Returns how memory and threads are placed
+    ///
+    /// \return the settings
+    [[nodiscard]] static MemoryPlacementSettings getSettings();
+
+    /// Allocates memory, aligned for any type; allocations of at least HugePageSize are mapped
+    /// on their own and backed with huge pages if they are on
+    ///
+    /// \param bytes size of the allocation
+    /// \return the memory
+    /// \throws bad_alloc if the memory cannot be allocated
+    [[nodiscard]] static void* allocate(const std::size_t& bytes);
+
+    /// Frees memory returned by allocate()
+    ///
+    /// \param memory the memory
+    /// \param bytes size it was allocated with
+    static void deallocate(void* memory, const std::size_t& bytes);
+
+    /// Pins the calling thread to a CPU if pinning is on, and logs where it runs
+    ///
+    /// \param idx index of the thread among its siblings; it is pinned to the *idx*-th CPU the
+    ///        process may run on, wrapping around
+    /// \param name name of the thread in the log
+    static void placeThread(const std::size_t& idx, const std::string& name);
+};
+
+/// An allocator of MemoryPlacement memory, for the containers of large state arrays
+template <typename T>
+class PlacedAllocator {
+public:
+    using value_type = T;
+
+    PlacedAllocator() = default;
+
+    template <typename U>
+    PlacedAllocator(const PlacedAllocator<U>&) noexcept { }
+
+    [[nodiscard]] T* allocate(const std::size_t& count) {
+        return static_cast<T*>(MemoryPlacement::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* memory, const std::size_t& count) noexcept {
+        MemoryPlacement::deallocate(memory, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PlacedAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PlacedAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+/// A vector of MemoryPlacement memory
+template <typename T>
+using PlacedVector = std::vector<T, PlacedAllocator<T>>;
+
+} // conveyorsim
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <experimental/propagate_const>
+#include <memory>
+#include <string>
+
+namespace conveyorsim {
+
+/// This class runs a belt whose state does not fit in memory, keeping it in a file and only
+/// holding a few segments of it in memory at a time.
+///
+/// The file holds the state of every position as PackedABState::encode() writes it, in belt
+/// order. An empty position with idle workers is all zero bytes, so the initial state is a
+/// sparse file of the right size, which takes no time to create.
+///
+/// Items only move downstream and workers only act on their own position, so a segment of the
+/// belt can run any number of timeslots on its own, given the items arriving from the segment
+/// upstream in those timeslots, as BeltShard and TimeWarpEngine do in parallel. This class does
+/// it in turn: the timeslots are run in chunks, and for every chunk each segment, from the
+/// first to the last, is read, runs all timeslots of the chunk on the items the segment
+/// upstream let out, and is written back. One pass over the file thus runs a whole chunk, and
+/// the I/O per timeslot shrinks with the chunk. The next segment is read ahead and the previous
+/// one written behind on threads of their own, overlapping the I/O with the timeslots. As for
+/// BeltShard, the first segment generates the items and every segment draws the worker
+/// priorities of a seeded ABConveyorConfiguration, so a run reproduces the in-memory run with
+/// the same seed.
+class OutOfCoreEngine {
+public:
+    /// Parameters of the engine
+    struct Settings {
+        /// belt positions per segment; a few segments are held in memory at a time
+        std::size_t segmentPositions = 1U << 21U;
+        /// timeslots each pass over the file runs
+        std::size_t chunkSlots = 4096;
+    };
+
+    /// The outcome of the runs so far
+    struct Result {
+        /// 'P' items that made it through the belt
+        std::uint64_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt
+        std::uint64_t dropCount;
+        /// passes over the file
+        std::uint64_t passes;
+        /// bytes read from the file
+        std::uint64_t bytesRead;
+        /// bytes written to the file
+        std::uint64_t bytesWritten;
+        /// wall time of the runs in seconds
+        double seconds;
+    };
+
+    /// Constructor for OutOfCoreEngine objects, creating the file of an empty belt with idle
+    /// workers
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param seed master seed of the run
+    /// \param path path of the file, which must not exist; the file is removed when the engine
+    ///        is destroyed
+    /// \param settings parameters of the engine
+    /// \throws invalid_argument if *convCap* or a setting is 0, or *assemblyDuration* does not
+    ///         fit in 32 bits
+    /// \throws system_error if the file exists or cannot be created
+    OutOfCoreEngine(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::uint64_t& seed,
+                    const std::string& path, const Settings& settings);
+
+    /// Constructor for OutOfCoreEngine objects with the default Settings
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param seed master seed of the run
+    /// \param path path of the file, which must not exist; the file is removed when the engine
+    ///        is destroyed
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* does not fit in 32 bits
+    /// \throws system_error if the file exists or cannot be created
+    OutOfCoreEngine(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::uint64_t& seed,
+                    const std::string& path);
+
+    ~OutOfCoreEngine();
+    OutOfCoreEngine(const OutOfCoreEngine&) = delete;
+    OutOfCoreEngine& operator=(const OutOfCoreEngine&) = delete;
+
+    /// Runs the belt for a number of timeslots, from where the previous run left it
+    ///
+    /// \param numSlots number of timeslots to run
+    /// \return the counts and the I/O of all runs so far
+    /// \throws system_error if the file cannot be read or written
+    Result run(const std::size_t& numSlots);
+
+private:
+    class impl;
+    std::experimental::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+} // conveyorsim
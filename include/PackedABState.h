@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MemoryPlacement.h"
+
+namespace conveyorsim {
+
+/// Contents of a conveyor belt position in the packed representation
+enum class PackedItem : std::uint8_t {
+    Empty = 0,
+    A = 1,
+    B = 2,
+    P = 3,
+};
+
+/// Mutable state of a two-armed Worker that assembles a 'P' from an 'A' and a 'B', packed
+/// into a few bytes.
+///
+/// With two arms and a quota of one 'A' and one 'B', a Worker never holds more than one item
+/// of each part number, so its held item counts reduce to flags.
+struct PackedWorker {
+    static constexpr std::uint8_t HoldsA = 1U;
+    static constexpr std::uint8_t HoldsB = 2U;
+    static constexpr std::uint8_t HoldsP = 4U;
+    static constexpr std::uint8_t Busy = 8U;
+
+    std::uint32_t countdown = 0;
+    std::uint8_t flags = 0;
+
+    bool operator==(const PackedWorker& other) const;
+
+    /// Runs the worker for one timeslot against a belt position.
+    ///
+    /// This is the same sequence of actions as Worker::run() (count down, try to collect, try to
+    /// initialize and finalize assembly, try to release the product) for the 'A' + 'B' -> 'P'
+    /// recipe with two arms.
+    /// \param cell contents of the position the worker is placed against
+    /// \param reserved whether the position has already been acted on this timeslot
+    /// \param assemblyDuration duration of product assembly in timeslots
+    void step(PackedItem& cell, bool& reserved, const std::uint32_t& assemblyDuration);
+};
+
+// Defined here, so that the engines stepping many workers per timeslot can inline it
+inline void PackedWorker::step(PackedItem& cell, bool& reserved, const std::uint32_t& assemblyDuration) {
+    if (countdown) {
+        countdown--;
+    }
+
+    // Try to collect: a free arm, not assembling, and an 'A' or 'B' that is still missing
+    if ((cell == PackedItem::A || cell == PackedItem::B) && !reserved && !(flags & Busy)
+        && __builtin_popcount(flags & (HoldsA | HoldsB | HoldsP)) < 2) {
+        const std::uint8_t held = cell == PackedItem::A ? HoldsA : HoldsB;
+        if (!(flags & held)) {
+            flags |= held;
+            cell = PackedItem::Empty;
+            reserved = true;
+        }
+    }
+
+    // Try to initialize assembly
+    if (!(flags & Busy) && (flags & (HoldsA | HoldsB)) == (HoldsA | HoldsB)) {
+        flags |= Busy;
+        countdown = assemblyDuration;
+    }
+
+    // Try to finalize assembly; the components are discarded and the product takes an arm
+    if ((flags & Busy) && !countdown) {
+        flags = static_cast<std::uint8_t>((flags & ~(HoldsA | HoldsB | Busy)) | HoldsP);
+    }
+
+    // Try to release the product
+    if (!reserved && cell == PackedItem::Empty && (flags & HoldsP)) {
+        flags &= static_cast<std::uint8_t>(~HoldsP);
+        cell = PackedItem::P;
+        reserved = true;
+    }
+}
+
+/// This class is the complete state of an ABConveyorConfiguration at a timeslot boundary in a
+/// packed representation: the contents of every belt position and the state of the top and
+/// bottom Worker of every position.
+///
+/// Reservations of belt positions are cleared whenever the belt moves, so they are not part of
+/// the state between timeslots. The random draws of a timeslot (the generated item and whether
+/// the top workers have priority) are given to step() explicitly, which makes the state usable
+/// both for simulation and for exploring the state space of the configuration.
+class PackedABState {
+public:
+    /// Bytes encode() takes per position: the item, then the flags and countdown of the top and
+    /// the bottom worker. An empty position with idle workers is all zero bytes
+    static constexpr std::size_t EncodedBytesPerPosition = 1 + 2 * (1 + sizeof(std::uint32_t));
+
+    /// Constructor for PackedABState objects, with an empty belt and idle workers
+    ///
+    /// \param convCap capacity of the conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \throws invalid_argument if *convCap* is 0 or *assemblyDuration* does not fit in 32 bits
+    PackedABState(const std::size_t& convCap, const std::size_t& assemblyDuration);
+
+    /// Runs one timeslot of the configuration.
+    ///
+    /// The item on the last position leaves the belt, the belt moves one position, the
+    /// generated item is placed on the first position and the workers of every position run
+    /// in the given priority order.
+    /// \param generated the item placed on the first position
+    /// \param topFirst true if the top workers act before the bottom workers
+    /// \return the item that left the belt
+    PackedItem step(const PackedItem& generated, const bool& topFirst);
+
+    /// Returns the contents of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return contents of *pos*
+    [[nodiscard]] PackedItem peekItem(const std::size_t& pos) const;
+
+    /// Returns the state of the top worker of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return the top worker of *pos*
+    [[nodiscard]] const PackedWorker& getTopWorker(const std::size_t& pos) const;
+
+    /// Returns the state of the bottom worker of a belt position
+    ///
+    /// \param pos position on the belt
+    /// \return the bottom worker of *pos*
+    [[nodiscard]] const PackedWorker& getBottomWorker(const std::size_t& pos) const;
+
+    /// Returns the capacity of the conveyor belt
+    ///
+    /// \return capacity of the conveyor belt
+    [[nodiscard]] std::size_t getCapacity() const;
+
+    /// Returns the assembly duration of the workers
+    ///
+    /// \return assembly duration in timeslots
+    [[nodiscard]] std::uint32_t getAssemblyDuration() const;
+
+    /// Serializes the state into a byte string that is equal for equal states.
+    ///
+    /// \return the serialized state
+    [[nodiscard]] std::string encode() const;
+
+    /// Restores a state serialized by encode() of a state with the same shape.
+    ///
+    /// \param key the serialized state
+    /// \throws invalid_argument if *key* does not match the shape of this state
+    void decode(const std::string& key);
+
+    bool operator==(const PackedABState& other) const;
+
+private:
+    [[nodiscard]] std::size_t physical(const std::size_t& pos) const;
+
+    std::uint32_t assemblyDuration;
+    std::size_t head = 0;
+    PlacedVector<PackedItem> belt;
+    PlacedVector<PackedWorker> topWorkers;
+    PlacedVector<PackedWorker> bottomWorkers;
+};
+
+} // conveyorsim
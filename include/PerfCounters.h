@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace conveyorsim {
+
+/// This class counts events of the calling thread with the performance counters of the kernel
+/// (perf_event_open), over the intervals it is started and stopped for, so that a run can
+/// report what its timeslots cost inside the binary rather than under an external profiler.
+///
+/// The counters are opened as one group, which the kernel schedules on the CPU all at once, so
+/// that their values are comparable. The hardware group counts cycles, instructions, cache
+/// misses and branch misses. Where the CPU or the kernel does not provide an event, as in most
+/// virtual machines and containers, it is left out of the group; where none of them is
+/// provided, the software group is opened instead, which counts the CPU time, page faults,
+/// context switches and CPU migrations. Only user space is counted, which unprivileged
+/// processes are allowed to do by default. When the kernel multiplexes more groups than the
+/// CPU has counters, values are scaled by the fraction of time the group was scheduled.
+class PerfCounters {
+public:
+    /// The value of a counter
+    struct Value {
+        /// name of the event, with its unit if it is not a count
+        const char* name;
+        std::uint64_t value;
+    };
+
+    /// Constructor for PerfCounters objects, opening the counters stopped and at 0
+    ///
+    /// \param hardware false to open the software group even if hardware events are provided
+    /// \throws system_error if neither group can be opened, for instance when perf_event_open
+    ///         is not permitted
+    explicit PerfCounters(const bool& hardware = true);
+
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /// Returns whether hardware events are counted
+    ///
+    /// \return true for the hardware group, false for the software group
+    [[nodiscard]] bool isHardware() const;
+
+    /// Starts counting
+    void start();
+
+    /// Stops counting; the values are kept, and a later start() adds to them
+    void stop();
+
+    /// Returns the values counted so far
+    ///
+    /// \return the value of every counter of the group, in the order of the class description
+    /// \throws system_error if the counters cannot be read
+    [[nodiscard]] std::vector<Value> read() const;
+
+    /// Writes the values counted so far, per timeslot and per position update, as well as the
+    /// instructions per cycle if they were counted
+    ///
+    /// \param os the output stream the report is written to
+    /// \param numSlots timeslots run while counting
+    /// \param numUpdates position updates, timeslots times belt positions, run while counting
+    /// \throws system_error if the counters cannot be read
+    void report(std::ostream& os, const std::uint64_t& numSlots, const std::uint64_t& numUpdates) const;
+
+private:
+    bool hardware = false;
+    // The group leader comes first
+    std::vector<int> fds;
+    std::vector<const char*> names;
+};
+
+} // conveyorsim
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include "ItemGeneratorIF.h"
+#include "ItemPN.h"
+
+namespace conveyorsim {
+
+/// This class represents an Item generator that repeats a fixed pattern of part numbers and
+/// empty timeslots, such as a recorded trace or A, B, A, B.
+class PeriodicItemGenerator : public ItemGeneratorIF {
+public:
+
+    /// Constructor for PeriodicItemGenerator
+    ///
+    /// \param pattern the items generated, in order, before the pattern starts over; nullopt
+    ///        generates no item
+    /// \throws invalid_argument if *pattern* is empty
+    explicit PeriodicItemGenerator(const std::vector<std::optional<ItemPN>>& pattern);
+
+    /// Returns a vector with the next Item objects produced by the generator object.
+    ///
+    /// \param quantity number of trials
+    /// \return a vector of size equal to the number of trials with the produced Item objects
+    ///         of the generator.
+    [[nodiscard]] std::vector<std::optional<Item>> get_next_items(const size_t &quantity) const override;
+
+    /// Returns the next Item object produced by the generator object.
+    ///
+    /// \return next Item object of the pattern, or nullopt for an empty timeslot
+    [[nodiscard]] std::optional<Item> get_next_item() const override;
+
+    /// Returns the repeated pattern
+    ///
+    /// \return the pattern given to the constructor
+    [[nodiscard]] const std::vector<std::optional<ItemPN>>& getPattern() const;
+
+    /// Returns where in the pattern the generator is
+    ///
+    /// \return index in the pattern of the next item generated
+    [[nodiscard]] std::size_t getPhase() const;
+
+private:
+    void print(std::ostream& os) const override;
+
+    const std::vector<std::optional<ItemPN>> pattern;
+    mutable std::size_t phase = 0;
+};
+
+/// Parses a pattern of PeriodicItemGenerator, a character per timeslot: the part number of the
+/// item generated, or '-' for no item, as in "AB-"
+///
+/// \param text the pattern
+/// \return the pattern, or nullopt if *text* is empty
+[[nodiscard]] std::optional<std::vector<std::optional<ItemPN>>> parseItemPattern(const std::string& text);
+
+} // conveyorsim
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace conveyorsim {
+
+/// Identifies the independent random streams that a simulation draws from.
+///
+/// Every simulation component that owns a random number generator seeds it from its own
+/// stream, so that a single master seed reproduces a whole simulation run while the
+/// components remain statistically independent of each other.
+enum class RandomStream : std::uint64_t {
+    ItemGeneration = 0,
+    WorkerPriority = 1,
+    ReplicaLanes = 2,
+    ForkedReplicas = 3,
+    JobReplicas = 4,
+};
+
+/// Scrambles a 64 bit value with the splitmix64 finalizer.
+///
+/// The finalizer is a bijection, so distinct values stay distinct, while every output bit
+/// depends on every input bit.
+/// \param value the value to scramble
+/// \return the scrambled value
+[[nodiscard]] std::uint64_t mixBits(const std::uint64_t& value);
+
+/// Derives the seed of a random stream from a master seed.
+///
+/// The derivation is a splitmix64 finalizer over the master seed and the stream identifier,
+/// which decorrelates streams even for adjacent master seeds.
+/// \param masterSeed the seed given to the simulation as a whole
+/// \param stream the random stream the seed is derived for
+/// \return the seed of the random stream
+[[nodiscard]] std::uint32_t deriveSeed(const std::uint64_t& masterSeed, const RandomStream& stream);
+
+} // conveyorsim
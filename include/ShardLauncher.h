@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace conveyorsim {
+
+/// This class runs a belt split into BeltShard segments, one process per segment, on the local
+/// machine.
+///
+/// The belt is split into contiguous segments whose sizes differ by at most one position.
+/// Consecutive segments are connected by ShmSpscChannel objects created before the shard
+/// processes are forked. Every shard process allocates only its own segment, runs it and
+/// reports its counts through shared memory. If any shard fails, the others are killed.
+class ShardLauncher {
+public:
+    /// The outcome of a sharded run
+    struct Result {
+        /// 'P' items that made it through the belt
+        std::uint64_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt
+        std::uint64_t dropCount;
+        /// timeslots run, fewer than asked if a stop was requested
+        std::uint64_t numSlots;
+    };
+
+    /// Constructor for ShardLauncher objects
+    ///
+    /// \param convCap capacity of the whole conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param numShards number of segments and processes
+    /// \param seed master seed shared by all segments
+    /// \param channelCapacity number of timeslots a segment may run ahead of the next one
+    /// \throws invalid_argument if *numShards* is 0 or larger than *convCap*, or
+    ///         *channelCapacity* is 0
+    ShardLauncher(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::size_t& numShards,
+                  const std::uint64_t& seed, const std::size_t& channelCapacity = 1024);
+
+    /// Runs all shards for a number of timeslots, or until a stop is requested through
+    /// ChunkedRunner, and waits for them to finish
+    ///
+    /// On a stop, all shards end at the same timeslot, a few past the one the first shard
+    /// reached, so the counts are those of an unsharded run of that many timeslots.
+    /// \param numSlots number of timeslots to run
+    /// \return the counts of the whole belt
+    /// \throws system_error if the shared memory or the shard processes cannot be created
+    /// \throws runtime_error if a shard fails
+    [[nodiscard]] Result run(const std::size_t& numSlots) const;
+
+private:
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    const std::size_t numShards;
+    const std::uint64_t seed;
+    const std::size_t channelCapacity;
+};
+
+} // conveyorsim
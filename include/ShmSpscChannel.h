@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "BoundaryChannelIF.h"
+
+namespace conveyorsim {
+
+struct ShmSpscRing;
+
+/// This class is a BoundaryChannelIF between two processes on the same machine: a single
+/// producer, single consumer ring buffer in shared memory.
+///
+/// The ring is mapped shared and anonymous, so the channel has to be constructed before the
+/// producer and consumer processes are forked from the process that constructs it. The
+/// producer and the consumer each own one index on its own cache line and publish it with a
+/// release store; each keeps a private copy of the other's index and only reloads it when the
+/// ring looks full or empty. Waiting spins briefly and then yields the processor.
+class ShmSpscChannel : public BoundaryChannelIF {
+public:
+    /// Constructor for ShmSpscChannel objects
+    ///
+    /// \param capacity number of items the channel holds, rounded up to a power of two
+    /// \throws invalid_argument if *capacity* is 0
+    /// \throws system_error if the shared memory cannot be mapped
+    explicit ShmSpscChannel(const std::size_t& capacity);
+
+    ~ShmSpscChannel() override;
+    ShmSpscChannel(const ShmSpscChannel&) = delete;
+    ShmSpscChannel& operator=(const ShmSpscChannel&) = delete;
+
+    /// \copydoc BoundaryChannelIF::send
+    void send(const std::optional<ItemPN>& item) override;
+
+    /// \copydoc BoundaryChannelIF::receive
+    [[nodiscard]] std::optional<ItemPN> receive() override;
+
+private:
+    std::size_t mask;
+    std::size_t mappedBytes;
+    ShmSpscRing* ring;
+    std::uint64_t* items;
+
+    // Private to the producer and the consumer process respectively
+    std::uint64_t cachedHead = 0;
+    std::uint64_t cachedTail = 0;
+};
+
+} // conveyorsim
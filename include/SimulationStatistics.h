@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+#include "Item.h"
+#include "LogHistogram.h"
+
+namespace conveyorsim {
+
+/// This class collects latency and utilization distributions of a conveyor belt simulation.
+///
+/// The belt is split into a number of contiguous segments of (almost) equal length and every
+/// event is counted in the segment of the position it took place on:
+///  * how many timeslots an item rode on the belt before a worker collected it
+///  * how many timeslots a worker held a finished product before it could release it on the belt
+///  * how many timeslots every worker spent assembling
+///
+/// How many timeslots the items that made it through the belt rode on it is recorded over
+/// the whole belt. Distributions are kept in LogHistogram objects, so the memory used is
+/// constant regardless of the number of simulated timeslots.
+///
+/// Workers are identified by an index; the workers of belt position *pos* have the indices
+/// 2 * pos and 2 * pos + 1.
+class SimulationStatistics {
+public:
+    /// Constructor for SimulationStatistics objects
+    ///
+    /// \param capacity capacity of the conveyor belt
+    /// \param numSegments number of segments the belt is split into, clamped to the capacity
+    /// \throws invalid_argument if *capacity* or *numSegments* is 0
+    SimulationStatistics(const std::size_t& capacity, const std::size_t& numSegments);
+
+    /// Marks the start of the next timeslot
+    void startSlot();
+
+    /// Returns the current timeslot, counting from 1 for the first simulated timeslot
+    ///
+    /// \return current timeslot
+    [[nodiscard]] std::uint64_t getSlot() const;
+
+    /// Records a worker collecting an item from the belt
+    ///
+    /// \param workerIdx index of the worker
+    /// \param item the collected item
+    void recordCollection(const std::size_t& workerIdx, const Item& item);
+
+    /// Records a worker finishing the assembly of a product
+    ///
+    /// \param workerIdx index of the worker
+    void recordProductReady(const std::size_t& workerIdx);
+
+    /// Records a worker releasing the product it finished last on the belt
+    ///
+    /// \param workerIdx index of the worker
+    void recordRelease(const std::size_t& workerIdx);
+
+    /// Records a worker spending the current timeslot assembling
+    ///
+    /// \param workerIdx index of the worker
+    void recordBusy(const std::size_t& workerIdx);
+
+    /// Records an item making it through the belt
+    ///
+    /// \param item the item
+    /// \param product true if the item is a product, false if it is unused
+    void recordExit(const Item& item, const bool& product);
+
+    /// Returns the number of segments the belt is split into
+    ///
+    /// \return number of segments
+    [[nodiscard]] std::size_t getNumSegments() const;
+
+    /// Returns the segment a belt position belongs to
+    ///
+    /// \param pos position on the belt
+    /// \return segment of *pos*
+    [[nodiscard]] std::size_t segmentOf(const std::size_t& pos) const;
+
+    /// Returns the distribution of timeslots items rode before collection within a segment
+    ///
+    /// \param segment the segment
+    /// \return distribution of timeslots ridden before collection
+    [[nodiscard]] const LogHistogram& getCollectionLatency(const std::size_t& segment) const;
+
+    /// Returns the distribution of timeslots products waited for release within a segment
+    ///
+    /// \param segment the segment
+    /// \return distribution of timeslots waited for release
+    [[nodiscard]] const LogHistogram& getReleaseWait(const std::size_t& segment) const;
+
+    /// Returns the distribution of timeslots the products that made it through the belt rode on it
+    ///
+    /// \return distribution of timeslots ridden by products
+    [[nodiscard]] const LogHistogram& getProductTransit() const;
+
+    /// Returns the distribution of timeslots the unused items that made it through the belt
+    /// rode on it
+    ///
+    /// \return distribution of timeslots ridden by unused items
+    [[nodiscard]] const LogHistogram& getDropTransit() const;
+
+    /// Returns the fraction of timeslots the workers of a belt position spent assembling
+    ///
+    /// \param pos position on the belt
+    /// \return busy fraction of the workers of *pos*, in [0, 1]
+    [[nodiscard]] double getBusyFraction(const std::size_t& pos) const;
+
+    /// Insertion operator
+    ///
+    /// Inserts a report of the collected distributions, per segment and over the whole belt,
+    /// into an output stream.
+    /// \param os the output stream the string is inserted in
+    /// \param obj the SimulationStatistics object from which the string representation is derived
+    /// \return the os stream with the string representation of obj inserted to it
+    friend std::ostream& operator<<(std::ostream& os, const SimulationStatistics& obj);
+
+private:
+    /// Distribution of the busy fraction of the positions of [first, last), in percent
+    [[nodiscard]] LogHistogram busyPercentages(const std::size_t& first, const std::size_t& last) const;
+
+    const std::size_t capacity;
+    const std::size_t numSegments;
+    std::uint64_t slot = 0;
+
+    std::vector<LogHistogram> collectionLatency;
+    std::vector<LogHistogram> releaseWait;
+    std::vector<std::uint64_t> busySlots;
+    // Kept here rather than in the Worker objects, which are built by the million
+    std::vector<std::uint64_t> productReadySlots;
+    LogHistogram productTransit;
+    LogHistogram dropTransit;
+};
+
+} // conveyorsim
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace conveyorsim {
+
+/// This class runs a belt split into contiguous segments, one thread per segment, either
+/// conservatively or optimistically (Time Warp).
+///
+/// Every segment is a PackedABState of its positions, and the item leaving its last position in
+/// a timeslot is the item arriving on the first position of the next segment in that timeslot.
+/// As for BeltShard, the first segment generates the items and every segment draws the worker
+/// priorities of a seeded ABConveyorConfiguration, so either way a run reproduces the unsegmented
+/// run with the same seed.
+///
+/// Conservatively, a segment only runs a timeslot once the segment upstream has run it, so it
+/// waits for its upstream neighbour every timeslot it catches up with.
+///
+/// Optimistically, a segment runs ahead of the segment upstream instead:
+///  * an arrival the segment upstream has not produced yet is predicted from the last snapshot
+///    of that segment's belt, as the item that many positions before its end; arrivals only
+///    differ from that when a worker upstream collects or places an item in between, which is
+///    rare on the long quiet stretches of a belt
+///  * the segment logs the arrival and worker priority of every timeslot it runs and saves its
+///    state every few timeslots
+///  * a timeslot is committed once the arrival it was run with matches the one the segment
+///    upstream committed; a straggler, an arrival that differs, rolls the segment back to the
+///    last saved state before it, from which the logged timeslots are run again up to the
+///    straggler
+///  * the global virtual time, the earliest uncommitted timeslot over all segments, is the
+///    committed timeslots of the last segment. Saved states and logs from before it can never
+///    be rolled back to, and are collected; no segment runs more than a window of timeslots
+///    past it, which bounds the logs
+class TimeWarpEngine {
+public:
+    /// Parameters of a run
+    struct Settings {
+        /// true to run optimistically, false to run conservatively
+        bool optimistic = true;
+        /// timeslots between saved states of a segment
+        std::size_t checkpointInterval = 64;
+        /// timeslots a segment may run past the global virtual time
+        std::size_t window = 4096;
+        /// timeslots a segment runs between checks of its neighbours
+        std::size_t batchSlots = 64;
+    };
+
+    /// The outcome of a run
+    struct Result {
+        /// 'P' items that made it through the belt
+        std::uint64_t productCount;
+        /// unused 'A' and 'B' items that made it through the belt
+        std::uint64_t dropCount;
+        /// timeslots run, fewer than asked if a stop was requested
+        std::uint64_t numSlots;
+        /// timeslots run over all segments, rolled back ones included; the committed ones are
+        /// the number of timeslots times the number of segments
+        std::uint64_t executedSlots;
+        /// timeslots run on predicted arrivals over all segments
+        std::uint64_t predictedSlots;
+        /// rollbacks over all segments
+        std::uint64_t rollbacks;
+        /// timeslots undone by rollbacks over all segments
+        std::uint64_t rolledBackSlots;
+        /// wall time of the run in seconds
+        double seconds;
+    };
+
+    /// Constructor for TimeWarpEngine objects
+    ///
+    /// \param convCap capacity of the whole conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param numSegments number of segments and threads
+    /// \param seed master seed of the run
+    /// \param settings parameters of the run
+    /// \throws invalid_argument if *numSegments* is 0 or larger than *convCap*,
+    ///         *assemblyDuration* does not fit in 32 bits, or a setting is 0
+    TimeWarpEngine(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::size_t& numSegments,
+                   const std::uint64_t& seed, const Settings& settings);
+
+    /// Constructor for TimeWarpEngine objects with the default Settings
+    ///
+    /// \param convCap capacity of the whole conveyor belt
+    /// \param assemblyDuration duration for a single worker to construct a 'P' item
+    /// \param numSegments number of segments and threads
+    /// \param seed master seed of the run
+    /// \throws invalid_argument if *numSegments* is 0 or larger than *convCap*, or
+    ///         *assemblyDuration* does not fit in 32 bits
+    TimeWarpEngine(const std::size_t& convCap, const std::size_t& assemblyDuration, const std::size_t& numSegments,
+                   const std::uint64_t& seed);
+
+    /// Runs all segments for a number of timeslots, or until a stop is requested through
+    /// ChunkedRunner, and waits for them to commit
+    ///
+    /// On a stop, all segments end at the timeslot the first segment reached, so the counts are
+    /// those of an unsegmented run of that many timeslots.
+    /// \param numSlots number of timeslots to run
+    /// \return the counts of the whole belt and the work it took
+    [[nodiscard]] Result run(const std::size_t& numSlots) const;
+
+private:
+    const std::size_t convCap;
+    const std::size_t assemblyDuration;
+    const std::size_t numSegments;
+    const std::uint64_t seed;
+    const Settings settings;
+};
+
+} // conveyorsim
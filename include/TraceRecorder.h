@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace conveyorsim {
+
+/// Phases of a timeslot that can be traced
+enum class TracePhase : std::uint8_t {
+    /// drawing the generated item and the worker priorities
+    Generation,
+    /// moving the belt and placing the generated item
+    Rotation,
+    /// running the workers of every position
+    WorkerSweep,
+    /// waiting for another thread or process
+    Wait,
+    /// exchanging items with another process
+    IO,
+    /// saving the state for a later rollback
+    Checkpoint,
+    /// restoring a saved state and running up to a straggler again
+    Rollback,
+};
+
+struct TraceBuffer;
+
+/// What TraceRecorder keeps per thread
+struct TraceThreadState {
+    /// the ring buffer of the thread, or nullptr if it is not attached
+    TraceBuffer* buffer = nullptr;
+    /// timeslots the thread started since it was attached
+    std::uint64_t slot = 0;
+    /// whether the current timeslot is traced
+    bool sampled = false;
+};
+
+/// This class records when the phases of timeslots begin and end, per thread, and writes them
+/// as Chrome trace events, which Perfetto (ui.perfetto.dev) and chrome://tracing display as a
+/// timeline per thread.
+///
+/// Tracing is switched on and off at runtime with enable() and disable(). A thread is traced
+/// once it called attachThread() while tracing was enabled, which allocates its ring buffer;
+/// recording an event only writes into that buffer, and once it is full, the oldest events are
+/// overwritten. The loops running timeslots call nextSlot() at the start of every timeslot, and
+/// only every *samplePeriod*-th timeslot is traced, through TraceScope objects around its
+/// phases. Threads that are not attached, and all threads while tracing is disabled, pay for a
+/// thread-local flag check per timeslot and phase.
+///
+/// The trace file is written in the JSON array format, which processes can append to: open()
+/// starts it, flush() appends the events recorded by the threads of the calling process, for
+/// instance by a forked shard once it is done, and close() appends the last events and ends the
+/// array. Timestamps come from the monotonic clock, which all processes share.
+class TraceRecorder {
+public:
+    /// Events a thread keeps by default
+    static constexpr std::size_t DefaultEventsPerThread = 1U << 16;
+
+    /// Switches tracing on
+    ///
+    /// \param samplePeriod trace one timeslot out of this many
+    /// \param eventsPerThread events the ring buffer of a thread attached from now on keeps
+    /// \throws invalid_argument if *samplePeriod* or *eventsPerThread* is 0
+    static void enable(const std::size_t& samplePeriod, const std::size_t& eventsPerThread = DefaultEventsPerThread);
+
+    /// Switches tracing off; attached threads keep their buffers and events
+    static void disable();
+
+    /// Returns whether tracing is on
+    ///
+    /// \return true if tracing is on
+    [[nodiscard]] static bool isEnabled();
+
+    /// Starts tracing the calling thread, if tracing is on; a thread attached before is only
+    /// renamed
+    ///
+    /// \param name name of the thread in the timeline
+    static void attachThread(const std::string& name);
+
+    /// Makes the calling process forget the threads of the process it was forked from, and
+    /// attaches its only thread; to be called right after fork()
+    ///
+    /// \param name name of the thread in the timeline
+    static void restartAfterFork(const std::string& name);
+
+    /// Marks the start of a timeslot of the calling thread, and decides whether it is traced
+    static void nextSlot() {
+        TraceThreadState& thread = currentThread;
+        thread.sampled = thread.buffer && enabled.load(std::memory_order_relaxed)
+                         && !(thread.slot++ % samplePeriod.load(std::memory_order_relaxed));
+    }
+
+    /// Returns whether an event of the calling thread would be recorded
+    ///
+    /// \param always true for an event that is recorded in any timeslot
+    /// \return true if the event would be recorded
+    [[nodiscard]] static bool isRecording(const bool& always) {
+        const TraceThreadState& thread = currentThread;
+        return always ? thread.buffer && enabled.load(std::memory_order_relaxed) : thread.sampled;
+    }
+
+    /// Returns the time of the monotonic clock
+    ///
+    /// \return nanoseconds since an arbitrary point, shared by all processes
+    [[nodiscard]] static std::uint64_t now();
+
+    /// Records a phase of the calling thread
+    ///
+    /// \param phase the phase
+    /// \param begin when it began, from now()
+    /// \param end when it ended, from now()
+    static void record(const TracePhase& phase, const std::uint64_t& begin, const std::uint64_t& end);
+
+    /// Writes the recorded events of the threads of the calling process as Chrome trace events,
+    /// every one preceded by a comma, oldest first, and forgets them. The threads must not be
+    /// recording meanwhile
+    ///
+    /// \param os the output stream the events are written to
+    static void writeEvents(std::ostream& os);
+
+    /// Starts a trace file, which flush() and close() append to
+    ///
+    /// \param path path of the trace file; an existing file is overwritten
+    /// \throws system_error if the file cannot be written
+    static void open(const std::string& path);
+
+    /// Appends the recorded events of the threads of the calling process to the trace file, if
+    /// one was started. The threads must not be recording meanwhile
+    ///
+    /// \throws system_error if the file cannot be written
+    static void flush();
+
+    /// Appends the recorded events of the threads of the calling process to the trace file and
+    /// ends it, if one was started
+    ///
+    /// \throws system_error if the file cannot be written
+    static void close();
+
+private:
+    inline static thread_local TraceThreadState currentThread;
+    inline static std::atomic<bool> enabled{false};
+    inline static std::atomic<std::size_t> samplePeriod{1};
+};
+
+/// This class records the phase it lives through, if the current timeslot is traced.
+class TraceScope {
+public:
+    /// Constructor for TraceScope objects, starting the phase
+    ///
+    /// \param phase the phase
+    /// \param always true to record the phase in any timeslot, for rare or long phases
+    explicit TraceScope(const TracePhase& phase, const bool& always = false) :
+            phase(phase),
+            recording(TraceRecorder::isRecording(always)),
+            begin(recording ? TraceRecorder::now() : 0)
+    { }
+
+    /// Destructor for TraceScope objects, ending the phase
+    ~TraceScope() {
+        if (recording) {
+            TraceRecorder::record(phase, begin, TraceRecorder::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const TracePhase phase;
+    const bool recording;
+    const std::uint64_t begin;
+};
+
+} // conveyorsim
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <unordered_set>
 #include <experimental/propagate_const>
@@ -16,7 +17,7 @@ namespace conveyorsim {
 
 /// This class represents an Item generator that creates items in a range of ItemPN with
 /// uniform random probability.
-class UniformRandomItemGenerator : ItemGeneratorIF {
+class UniformRandomItemGenerator : public ItemGeneratorIF {
 public:
 
     /// Constructor for UniformRandomItemGenerator
@@ -25,8 +26,10 @@ public:
     /// It can also configure the generator to not produce an item as one of the uniform random choices.
     /// \param PNSet set of possible ItemPN for each generated item
     /// \param emptyPossible makes it possible for the generator to not produce an item.
+    /// \param seed seed of the generator; when absent the generator is seeded from std::random_device
     /// \throws invalid_argument if there are no possible outcomes (PNSet is empty and emptyPossible is false)
-    explicit UniformRandomItemGenerator(const std::unordered_set<ItemPN>& PNSet, const bool& emptyPossible=false);
+    explicit UniformRandomItemGenerator(const std::unordered_set<ItemPN>& PNSet, const bool& emptyPossible=false,
+                                        const std::optional<std::uint32_t>& seed=std::nullopt);
 
     // Defined in the implementation file, where impl is a complete type
     ~UniformRandomItemGenerator();
@@ -44,6 +47,11 @@ public:
     ///         create an Item object is enabled)
     [[nodiscard]] std::optional<Item> get_next_item() const override;
 
+    /// Restarts the generation from a new seed
+    ///
+    /// \param seed seed of the generation; when absent, it is seeded from std::random_device
+    void reseed(const std::optional<std::uint32_t>& seed);
+
 private:
     void print(std::ostream& os) const override;
 
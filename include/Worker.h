@@ -4,71 +4,90 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
 #include "ConveyorPositionControllerIF.h"
-#include "SimulationComponentIF.h"
+#include "PackedABState.h"
+#include "SimulationStatistics.h"
+#include "WorkerAutomaton.h"
+#include "WorkerSpec.h"
 
 namespace conveyorsim {
 
+/// What all the Worker objects of a configuration share, held once by the configuration and
+/// handed to every call of a Worker
+struct WorkerContext {
+    /// what the Worker objects need and produce
+    const WorkerSpec& spec;
+    /// the transitions of *spec* tabulated
+    const WorkerAutomaton& automaton;
+    /// the statistics the Worker objects report to, or nullptr for none
+    SimulationStatistics* statistics = nullptr;
+};
+
 /// This class represents a worker on the conveyor belt. A worker is
 /// presented with a conveyor positional controller which it uses to
 /// manipulate the contents of the position on the conveyor belt it is
 /// placed against. It collects items from the conveyor belt and produces
-/// items to be placed in the conveyor belt. It is parameterized by its
-/// number of arms, the needed quotas for each object before production
-/// can begin, the part number of the product it produces and how long
-/// it takes to assemble the object.
-class Worker : public SimulationComponentIF {
+/// items to be placed in the conveyor belt. It is parameterized by a
+/// WorkerSpec: its number of arms, the needed quotas for each object
+/// before production can begin, the part number of the product it
+/// produces and how long it takes to assemble the object.
+///
+/// A Worker only holds what differs from one Worker to the next: the
+/// number of its state in the WorkerAutomaton of its spec, and its
+/// assembly countdown. Everything else is the same for all Workers of a
+/// configuration or follows from their position, so it is passed in by
+/// the configuration, in the manner of PackedWorker::step(). A Worker
+/// takes 8 bytes and looks its timeslots up.
+class Worker {
 
 public:
-    /// Constructor for Worker objects
+    /// Runs the Worker for one timeslot. The Worker tries to do the following actions in order:
+    ///  - try to collect an object from the belt
+    ///  - try to initialize assembly of an product if the part quotas are met
+    ///  - if a product is finished assembling, put it on one of its arms
+    ///  - if it holds any products, try to emplace them on the conveyor belt
     ///
+    /// \param context what the Worker shares with the others of its configuration
     /// \param controller interface to the position on the conveyor belt
-    /// \param armsN number of arms that the Worker has to hold Item objects
-    /// \param neededPNQuotas needed number of Item object with ItemPN part numbers required for product assembly
-    /// \param productPN ItemPN product number of the produced Item object
-    /// \param assemblyDuration duration of product assembly in timeslots
-    /// \throw invalid_argument if *armsN* is 0 or is less than the total
-    ///        quota of needed items
-    Worker(const ConveyorPositionControllerIF& controller, const size_t& armsN,
-           const std::unordered_map<ItemPN, size_t>& neededPNQuotas,
-           const ItemPN& productPN, const size_t& assemblyDuration);
+    /// \param workerIdx the index the Worker reports under to the statistics of *context*
+    void run(const WorkerContext& context, const ConveyorPositionControllerIF& controller,
+             const std::size_t& workerIdx);
+
+    /// Returns the Worker to the state it was constructed in: no held items and no assembly
+    void reset();
+
+    /// Returns the state of the Worker in the packed representation.
+    ///
+    /// Only Workers of the two-armed 'A' + 'B' -> 'P' recipe of PackedWorker have one.
+    /// \param context what the Worker shares with the others of its configuration
+    /// \return the packed state
+    [[nodiscard]] PackedWorker pack(const WorkerContext& context) const;
 
-    /// \copydoc SimulationComponentIF::run() For every timeslot, the Worker tries to do the following
-    ///          actions in order:
-    ///          - try to collect an object from the belt
-    ///          - try to initialize assembly of an product if the part quotas are met
-    ///          - if a product is finished assembling, put it on one of its arms
-    ///          - if it holds any products, try to emplace them on the conveyor belt
-    void run(const size_t& numSlots) override;
+    /// Restores a state returned by pack()
+    ///
+    /// \param context what the Worker shares with the others of its configuration
+    /// \param packed the packed state
+    /// \throws invalid_argument if the state is not one of the automaton of *context*
+    void unpack(const WorkerContext& context, const PackedWorker& packed);
 
-    /// Insertion operator
+    /// Inserts a string representation of the Worker into an output stream
     ///
-    /// Inserts a string representation of a Worker object into an output stream
     /// \param os the output stream the string is inserted in
-    /// \param obj the Worker object from which the string representation is derived
-    /// \return the os stream with the string representation of obj inserted to it
-    friend std::ostream& operator<<(std::ostream& os, const Worker& obj);
+    /// \param context what the Worker shares with the others of its configuration
+    /// \param controller interface to the position on the conveyor belt
+    void print(std::ostream& os, const WorkerContext& context,
+               const ConveyorPositionControllerIF& controller) const;
 
 private:
-    bool tryCollect();
-    bool tryInitializeAssembly();
-    bool tryFinalizeAssembly();
-    bool tryReleaseProduct();
-    bool canPickItem(const Item& pn) const;
-    bool canUseItem(const Item& pn) const;
-
-    const ConveyorPositionControllerIF& controller;
-    const size_t assemblyDuration;
-    const std::unordered_map<ItemPN, size_t> neededPNQuotas;
-    const ItemPN productPN;
-    const size_t armsN;
+    // Takes the actions of a timeslot on the position
+    static void act(const WorkerContext& context, const ConveyorPositionControllerIF& controller,
+                    const std::size_t& workerIdx, const std::uint8_t& actions);
 
-    std::unordered_map<ItemPN, size_t> heldItemCounts;
-    size_t busyArms;
-    size_t neededItemsCount{};
-    size_t assemblyCountdown;
-    bool busy;
+    std::uint32_t assemblyCountdown = 0;
+    std::uint16_t automatonState = 0;
 };
 
 } // conveyorsim
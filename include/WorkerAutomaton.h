@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "Item.h"
+#include "WorkerSpec.h"
+
+namespace conveyorsim {
+
+/// The finite part of the state of a Worker: everything but its assembly countdown.
+struct WorkerState {
+    /// Held items, counted by their number in the WorkerSpec
+    std::array<std::uint8_t, WorkerSpec::MaxParts> heldItemCounts{};
+    std::uint8_t heldProductCount = 0;
+    std::uint8_t busyArms = 0;
+    /// Items still missing for the next assembly
+    std::uint8_t neededItemsCount = 0;
+    bool busy = false;
+
+    bool operator==(const WorkerState& other) const;
+};
+
+/// This class is the transition function of the Worker objects of a WorkerSpec, tabulated.
+///
+/// A timeslot of a Worker depends on its WorkerState, the contents of its position (empty, one
+/// of the needed part numbers, or anything else), whether the position is reserved and whether
+/// its assembly countdown has run out; the countdown itself is the only unbounded part of the
+/// state and is kept out of the table. apply() is that function, written out step by step as
+/// Worker::run() describes it. build() enumerates the states reachable from the initial one
+/// once, when a configuration is set up, and tabulates apply() for all of them, so that a
+/// timeslot of a Worker becomes a single lookup, the actions it returns and the countdown.
+class WorkerAutomaton {
+public:
+    /// Action of a transition: the item of the position is collected
+    static constexpr std::uint8_t Collect = 1U;
+    /// Action of a transition: an assembly starts, and the countdown is set to its duration
+    static constexpr std::uint8_t Start = 2U;
+    /// Action of a transition: an assembly finishes, and its product takes an arm
+    static constexpr std::uint8_t Finish = 4U;
+    /// Action of a transition: a product is placed on the position
+    static constexpr std::uint8_t Release = 8U;
+
+    /// Largest number of states that is tabulated
+    static constexpr std::size_t MaxStates = 4096;
+
+    /// The next state and the actions of a timeslot
+    struct Transition {
+        std::uint16_t next;
+        std::uint8_t actions;
+    };
+
+    /// Returns the state of a Worker with no held items and no assembly
+    ///
+    /// \param spec what the Worker needs and produces
+    /// \return the initial state
+    [[nodiscard]] static WorkerState initialState(const WorkerSpec& spec);
+
+    /// Classifies the contents of a position for apply() and transition()
+    ///
+    /// \param spec what the Worker needs and produces
+    /// \param item contents of the position
+    /// \return 0 for an empty position, 1 + the number of a needed part number, or
+    ///         getNumParts() + 1 for any other item
+    [[nodiscard]] static std::size_t classify(const WorkerSpec& spec, const std::optional<Item>& item);
+
+    /// Runs a Worker for one timeslot, after its countdown was decremented
+    ///
+    /// \param spec what the Worker needs and produces
+    /// \param state state of the Worker, updated in place
+    /// \param content contents of the position, as classified by classify()
+    /// \param reserved whether the position has already been acted on this timeslot
+    /// \param expired whether the countdown is 0
+    /// \return the actions the Worker takes, in the order Collect, Start, Finish, Release
+    static std::uint8_t apply(const WorkerSpec& spec, WorkerState& state, const std::size_t& content,
+                              const bool& reserved, const bool& expired);
+
+    /// Tabulates the transitions of the Worker objects of a spec
+    ///
+    /// \param spec what the Worker objects need and produce
+    /// \return the automaton, or nullptr if more than MaxStates states are reachable
+    [[nodiscard]] static std::unique_ptr<const WorkerAutomaton> build(const WorkerSpec& spec);
+
+    /// Returns the number of reachable states
+    ///
+    /// \return number of states, the initial one being state 0
+    [[nodiscard]] std::size_t getNumStates() const;
+
+    /// Returns a state
+    ///
+    /// \param state number of the state, less than getNumStates()
+    /// \return the state
+    [[nodiscard]] const WorkerState& getState(const std::uint16_t& state) const;
+
+    /// Finds the number of a state
+    ///
+    /// \param state a state
+    /// \return the number of *state*, or nullopt if it is not reachable
+    [[nodiscard]] std::optional<std::uint16_t> findState(const WorkerState& state) const;
+
+    /// Looks the transition of a timeslot up, see apply()
+    ///
+    /// \param state number of the state of the Worker
+    /// \param content contents of the position, as classified by classify()
+    /// \param reserved whether the position has already been acted on this timeslot
+    /// \param expired whether the countdown is 0
+    /// \return the next state and the actions
+    [[nodiscard]] const Transition& transition(const std::uint16_t& state, const std::size_t& content,
+                                               const bool& reserved, const bool& expired) const {
+        return table[((state * numContents + content) << 2U) | (reserved << 1U) | expired];
+    }
+
+private:
+    // Key of a state in the index, its counts and flags in a row
+    using Key = std::array<std::uint8_t, WorkerSpec::MaxParts + 4>;
+
+    explicit WorkerAutomaton(const std::size_t& numContents);
+
+    [[nodiscard]] static Key key(const WorkerState& state);
+
+    const std::size_t numContents;
+    std::vector<WorkerState> states;
+    std::vector<Transition> table;
+    std::map<Key, std::uint16_t> index;
+};
+
+} // conveyorsim
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "ItemPN.h"
+
+namespace conveyorsim {
+
+/// This class describes what a Worker needs and produces: its number of arms, the quota of
+/// every part number it needs before assembly can begin, the part number of its product and
+/// how long the assembly takes.
+///
+/// A WorkerSpec is immutable and shared by reference between all the Worker objects it
+/// describes, which only keep their mutable state. The needed part numbers are numbered in
+/// the iteration order of the quota map, which is unspecified but fixed for a given standard
+/// library, and workers keep their counts of held items by that number. Workers print their
+/// parts in that order, as they did when they kept the quota map themselves.
+class WorkerSpec {
+public:
+    /// Largest number of distinct needed part numbers
+    static constexpr std::size_t MaxParts = 7;
+
+    /// Largest number of arms; held item counts never exceed it, so a byte holds any of them
+    static constexpr std::size_t MaxArms = std::numeric_limits<std::uint8_t>::max();
+
+    /// Largest assembly duration, in timeslots
+    static constexpr std::size_t MaxAssemblyDuration = std::numeric_limits<std::uint32_t>::max();
+
+    /// Constructor for WorkerSpec objects
+    ///
+    /// \param armsN number of arms that the Worker has to hold Item objects
+    /// \param neededPNQuotas needed number of Item object with ItemPN part numbers required for product assembly
+    /// \param productPN ItemPN product number of the produced Item object
+    /// \param assemblyDuration duration of product assembly in timeslots
+    /// \throw invalid_argument if *armsN* is 0, is less than the total quota of needed items or
+    ///        exceeds MaxArms, if more than MaxParts part numbers are needed, or if
+    ///        *assemblyDuration* exceeds MaxAssemblyDuration
+    WorkerSpec(const std::size_t& armsN, const std::unordered_map<ItemPN, std::size_t>& neededPNQuotas,
+               const ItemPN& productPN, const std::size_t& assemblyDuration);
+
+    /// Returns the number of arms
+    ///
+    /// \return number of arms of the Worker
+    [[nodiscard]] std::size_t getArmsN() const;
+
+    /// Returns the duration of product assembly
+    ///
+    /// \return duration of product assembly in timeslots
+    [[nodiscard]] std::size_t getAssemblyDuration() const;
+
+    /// Returns the part number of the product
+    ///
+    /// \return ItemPN product number of the produced Item object
+    [[nodiscard]] const ItemPN& getProductPN() const;
+
+    /// Returns the number of distinct needed part numbers
+    ///
+    /// \return number of distinct needed part numbers
+    [[nodiscard]] std::size_t getNumParts() const;
+
+    /// Returns a needed part number
+    ///
+    /// \param part number of the needed part number, less than getNumParts()
+    /// \return the needed part number
+    [[nodiscard]] const ItemPN& getPartPN(const std::size_t& part) const;
+
+    /// Returns the quota of a needed part number
+    ///
+    /// \param part number of the needed part number, less than getNumParts()
+    /// \return number of items with that part number needed for product assembly
+    [[nodiscard]] std::size_t getQuota(const std::size_t& part) const;
+
+    /// Returns the total quota of needed items
+    ///
+    /// \return number of items needed for product assembly
+    [[nodiscard]] std::size_t getNeededItemsCount() const;
+
+    /// Finds the number of a needed part number
+    ///
+    /// \param pn a part number
+    /// \return the number of *pn*, or nullopt if it is not needed
+    [[nodiscard]] std::optional<std::size_t> findPart(const ItemPN& pn) const;
+
+private:
+    const std::size_t armsN;
+    const std::size_t assemblyDuration;
+    const ItemPN productPN;
+    std::vector<ItemPN> partPNs;
+    std::vector<std::size_t> quotas;
+    std::size_t neededItemsCount = 0;
+};
+
+} // conveyorsim
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+ */
+
+/**
+ * \file conveyorsim.h
+ * The C interface of libconveyorsim, for running ABConveyorConfiguration simulations in process.
+ *
+ * The interface is a stable C ABI: configurations are opaque handles, and the structures below
+ * only ever grow by fields appended at their end, together with an increment of
+ * CONVEYORSIM_ABI_VERSION. Every structure the caller passes in starts with its size, which the
+ * caller sets to sizeof the structure it was compiled with; the library tells the layouts apart
+ * by it, rejects sizes it does not know with CONVEYORSIM_INVALID_ARGUMENT, and keeps accepting
+ * the sizes of all earlier versions. Functions never throw; they report errors with a
+ * conveyorsim_status.
+ */
+
+#ifndef CONVEYORSIM_H
+#define CONVEYORSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define CONVEYORSIM_API __attribute__((visibility("default")))
+#else
+#define CONVEYORSIM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Version of the ABI described by this header */
+#define CONVEYORSIM_ABI_VERSION 1
+
+/** Outcome of a libconveyorsim call */
+typedef enum conveyorsim_status {
+    CONVEYORSIM_OK = 0,
+    /** a pointer was null, or the parameters do not describe a valid configuration */
+    CONVEYORSIM_INVALID_ARGUMENT = 1,
+    CONVEYORSIM_OUT_OF_MEMORY = 2,
+    /** any other failure */
+    CONVEYORSIM_ERROR = 3
+} conveyorsim_status;
+
+/** Parameters of a configuration */
+typedef struct conveyorsim_params {
+    /** sizeof(conveyorsim_params) */
+    size_t struct_size;
+    /** capacity of the conveyor belt; must not be 0 */
+    uint64_t capacity;
+    /** duration for a single worker to construct a 'P' item, in timeslots */
+    uint64_t assembly_duration;
+    /** master seed of the simulation; only used if seeded is not 0 */
+    uint64_t seed;
+    /** 0 to seed the simulation from the operating system, anything else to use seed */
+    int32_t seeded;
+} conveyorsim_params;
+
+/** Counters of a configuration since it was created or last reset */
+typedef struct conveyorsim_counters {
+    /** timeslots run */
+    uint64_t slots;
+    /** 'P' items that made it through the belt */
+    uint64_t product_count;
+    /** unused 'A' and 'B' items that made it through the belt */
+    uint64_t drop_count;
+    /** belt positions currently holding an item */
+    uint64_t occupied_positions;
+} conveyorsim_counters;
+
+/** A run of conveyorsim_run_batch() */
+typedef struct conveyorsim_batch_entry {
+    /** input: sizeof(conveyorsim_batch_entry); the entries are this far apart */
+    size_t struct_size;
+    /** input: the configuration to run */
+    conveyorsim_params params;
+    /** input: number of timeslots to run it for */
+    uint64_t num_slots;
+    /** output: the counters at the end of the run */
+    conveyorsim_counters counters;
+    /** output: the outcome of the run */
+    conveyorsim_status status;
+} conveyorsim_batch_entry;
+
+/** A simulation, created by conveyorsim_create() */
+typedef struct conveyorsim_config conveyorsim_config;
+
+/**
+ * Returns the ABI version of the library, to be compared with CONVEYORSIM_ABI_VERSION
+ *
+ * \return the ABI version of the library
+ */
+CONVEYORSIM_API uint32_t conveyorsim_abi_version(void);
+
+/**
+ * Returns a description of a status
+ *
+ * \param status a status returned by the library
+ * \return a static, null terminated description of *status*
+ */
+CONVEYORSIM_API const char* conveyorsim_status_string(conveyorsim_status status);
+
+/**
+ * Creates a configuration with an empty belt and idle workers
+ *
+ * \param params parameters of the configuration
+ * \param config receives the created configuration, to be destroyed with conveyorsim_destroy()
+ * \return CONVEYORSIM_OK, or the reason the configuration could not be created
+ */
+CONVEYORSIM_API conveyorsim_status conveyorsim_create(const conveyorsim_params* params, conveyorsim_config** config);
+
+/**
+ * Destroys a configuration
+ *
+ * \param config a configuration created by conveyorsim_create(), or null
+ */
+CONVEYORSIM_API void conveyorsim_destroy(conveyorsim_config* config);
+
+/**
+ * Runs a configuration for a number of timeslots
+ *
+ * \param config the configuration
+ * \param num_slots number of timeslots to run
+ * \return CONVEYORSIM_OK, or the reason the run failed
+ */
+CONVEYORSIM_API conveyorsim_status conveyorsim_run(conveyorsim_config* config, uint64_t num_slots);
+
+/**
+ * Reads the counters of a configuration
+ *
+ * \param config the configuration
+ * \param counters receives the counters
+ * \return CONVEYORSIM_OK, or CONVEYORSIM_INVALID_ARGUMENT if a pointer is null
+ */
+CONVEYORSIM_API conveyorsim_status conveyorsim_read(const conveyorsim_config* config, conveyorsim_counters* counters);
+
+/**
+ * Returns a configuration to its initial state, for reuse with a new seed
+ *
+ * \param config the configuration
+ * \param seed master seed of the simulation from now on
+ * \param seeded 0 to seed the simulation from the operating system instead of *seed*
+ * \return CONVEYORSIM_OK, or the reason the reset failed
+ */
+CONVEYORSIM_API conveyorsim_status conveyorsim_reset(conveyorsim_config* config, uint64_t seed, int32_t seeded);
+
+/**
+ * Runs many independent configurations, spread over threads
+ *
+ * Every entry is created, run for its number of timeslots and read into its counters; its
+ * status tells whether that succeeded. Entries are handed out to the threads one at a time, so
+ * runs of different lengths balance out.
+ *
+ * \param entries the runs
+ * \param count number of entries
+ * \param num_threads number of threads to use; 0 uses one per hardware thread
+ * \return CONVEYORSIM_OK once all entries ran, whatever their status, or
+ *         CONVEYORSIM_INVALID_ARGUMENT if *entries* is null while *count* is not 0, or if the
+ *         size of the first entry is unknown, in which case no entry is run
+ */
+CONVEYORSIM_API conveyorsim_status conveyorsim_run_batch(conveyorsim_batch_entry* entries, size_t count,
+                                                         uint32_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVEYORSIM_H */
@@ -2,56 +2,141 @@
 // Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
 //
 
+#include <algorithm>
 #include <ostream>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include "ArbitrationPolicies.h"
 #include "Worker.h"
+#include "WorkerAutomaton.h"
+#include "WorkerSpec.h"
 #include "UniformRandomItemGenerator.h"
 #include "ConveyorBelt.h"
 #include "ConveyorPositionController.h"
+#include "FixedShapeEngine.h"
+#include "MemoryPlacement.h"
+#include "Seeding.h"
+#include "SimulationStatistics.h"
+#include "TraceRecorder.h"
 #include "ABConveyorConfiguration.h"
 
 using namespace std;
 using namespace conveyorsim;
 
+namespace {
+
+optional<uint32_t> itemSeed(const optional<uint64_t>& seed) {
+    return seed.has_value() ? optional(deriveSeed(seed.value(), RandomStream::ItemGeneration)) : nullopt;
+}
+
+uint64_t prioritySeed(const optional<uint64_t>& seed) {
+    return seed.has_value() ? deriveSeed(seed.value(), RandomStream::WorkerPriority) : random_device()();
+}
+
+PackedItem packItem(const optional<Item>& item) {
+    if (!item.has_value()) {
+        return PackedItem::Empty;
+    }
+    const ItemPN& pn = item.value().getPN();
+    return pn == ItemPN('A') ? PackedItem::A : pn == ItemPN('B') ? PackedItem::B : PackedItem::P;
+}
+
+optional<Item> unpackItem(const PackedItem& item) {
+    switch (item) {
+        case PackedItem::A:
+            return Item(ItemPN('A'));
+        case PackedItem::B:
+            return Item(ItemPN('B'));
+        case PackedItem::P:
+            return Item(ItemPN('P'));
+        case PackedItem::Empty:
+            break;
+    }
+    return nullopt;
+}
+
+} // namespace
+
 class ABConveyorConfiguration::impl {
 public:
-    impl(const size_t& convCap, const size_t& assemblyDuration) :
-            generator({ItemPN('A'), ItemPN('B')}, true),
+    impl(const size_t& convCap, const size_t& assemblyDuration, const optional<uint64_t>& seed,
+         const ArbitrationPolicy& arbitration) :
+            spec(2, {{ItemPN('A'), 1}, {ItemPN('B'), 1}}, ItemPN('P'), assemblyDuration),
+            automaton(WorkerAutomaton::build(spec)),
+            generator({ItemPN('A'), ItemPN('B')}, true, itemSeed(seed)),
             belt(ConveyorBelt(convCap)),
-            rng(rd()),
-            udst(0, 2)
+            topWorkers(convCap),
+            bottomWorkers(convCap),
+            arbitration(arbitration),
+            arbiter(makeArbitrationPolicy(arbitration, convCap, prioritySeed(seed))),
+            topFirst((convCap + 63) / 64),
+            topServed(topFirst.size()),
+            bottomServed(topFirst.size()),
+            fixed(makeFixedShapeEngine(convCap, static_cast<uint32_t>(assemblyDuration)))
     {
+        // Every element is constructed in place in storage reserved once, and the workers only
+        // hold their own state, so construction does a constant number of allocations
+        controllers.reserve(convCap);
         for (size_t pos = 0; pos < convCap; pos++) {
-            controllers.emplace_back(ConveyorPositionController(belt, pos));
-        }
-        for (size_t pos = 0; pos < convCap; pos++) {
-            topWorkers.push_back( Worker(
-                    controllers.at(pos),
-                    2,
-                    { {ItemPN('A'), 1}, {ItemPN('B'), 1} },
-                    ItemPN('P'),
-                    assemblyDuration));
-            bottomWorkers.push_back( Worker(
-                    controllers.at(pos),
-                    2,
-                    { {ItemPN('A'), 1}, {ItemPN('B'), 1} },
-                    ItemPN('P'),
-                    assemblyDuration));
+            controllers.emplace_back(belt, pos);
         }
     }
-    const UniformRandomItemGenerator generator;
+    // What every worker needs and produces, and its transitions tabulated once, held here rather
+    // than by every worker; see context()
+    const WorkerSpec spec;
+    const unique_ptr<const WorkerAutomaton> automaton;
+    UniformRandomItemGenerator generator;
     ConveyorBelt belt;
-    vector<Worker> topWorkers;
-    vector<Worker> bottomWorkers;
-    vector<ConveyorPositionController> controllers;
+    // The largest arrays of a giant belt, on huge pages
+    PlacedVector<Worker> topWorkers;
+    PlacedVector<Worker> bottomWorkers;
+    PlacedVector<ConveyorPositionController> controllers;
+    unique_ptr<SimulationStatistics> statistics;
+    const ArbitrationPolicy arbitration;
+    unique_ptr<ArbitrationPolicyIF> arbiter;
+    // Bit-sliced per position, see ArbitrationPolicyIF
+    vector<uint64_t> topFirst;
+    vector<uint64_t> topServed;
+    vector<uint64_t> bottomServed;
+    // Runs the timeslots of run() for small belts; nullptr for the others
+    const unique_ptr<FixedShapeEngineIF> fixed;
 
-    mutable random_device rd;
-    mutable mt19937 rng;
-    mutable uniform_int_distribution<size_t> udst;
+    // What the workers share; the top worker of a position reports to the statistics under
+    // twice the position, and the bottom one under the index after it
+    [[nodiscard]] WorkerContext context() const {
+        return {spec, *automaton, statistics.get()};
+    }
+
+    // Hands the state of the belt and the workers to the fixed-shape engine
+    void loadFixedEngine() {
+        const WorkerContext shared = context();
+        for (size_t pos = 0; pos < belt.getCapacity(); pos++) {
+            fixed->setPosition(pos, packItem(belt.peekItem(pos)), belt.isReserved(pos), topWorkers[pos].pack(shared),
+                               bottomWorkers[pos].pack(shared));
+        }
+    }
+
+    // Takes the state of the belt and the workers back from the fixed-shape engine
+    void storeFixedEngine() {
+        const WorkerContext shared = context();
+        for (size_t pos = 0; pos < belt.getCapacity(); pos++) {
+            belt.restore(pos, unpackItem(fixed->getItem(pos)), fixed->isReserved(pos));
+            topWorkers[pos].unpack(shared, fixed->getTopWorker(pos));
+            bottomWorkers[pos].unpack(shared, fixed->getBottomWorker(pos));
+        }
+    }
 };
 
-ABConveyorConfiguration::ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration) :
-        pImpl(make_unique<impl>(convCap, assemblyDuration)),
+ABConveyorConfiguration::ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration,
+                                                 const optional<uint64_t>& seed) :
+        ABConveyorConfiguration(convCap, assemblyDuration, seed, ArbitrationPolicy::GlobalRandom)
+{ }
+
+ABConveyorConfiguration::ABConveyorConfiguration(const size_t& convCap, const size_t& assemblyDuration,
+                                                 const optional<uint64_t>& seed,
+                                                 const ArbitrationPolicy& arbitration) :
+        pImpl(make_unique<impl>(convCap, assemblyDuration, seed, arbitration)),
         productCount(0),
         dropCount(0)
 { }
@@ -59,44 +144,131 @@ ABConveyorConfiguration::ABConveyorConfiguration(const size_t& convCap, const si
 ABConveyorConfiguration::~ABConveyorConfiguration() = default;
 
 void ABConveyorConfiguration::run(const size_t& numSlots) {
+    // The engine takes over the state for the timeslots it runs, so that everything else sees
+    // the belt and the workers as if they had run them
+    if (usesFixedShapeEngine() && numSlots) {
+        pImpl->loadFixedEngine();
+        pImpl->fixed->run(numSlots, pImpl->generator, *pImpl->arbiter, productCount, dropCount);
+        pImpl->storeFixedEngine();
+        return;
+    }
     for (size_t slot = 0; slot < numSlots; slot++) {
+        TraceRecorder::nextSlot();
+        optional<ItemPN> generated;
+        {
+            TraceScope trace(TracePhase::Generation);
+            const auto item = pImpl->generator.get_next_item();
+            pImpl->arbiter->arbitrate(pImpl->topFirst);
+            generated = item.has_value() ? optional(item.value().getPN()) : nullopt;
+        }
+        runSlot(generated, pImpl->topFirst);
+    }
+}
 
-        // Update statistics:
-        const size_t& cap = pImpl->belt.getCapacity();
-        const auto& peek = pImpl->belt.peekItem(cap-1);
-        if (peek.has_value()) {
-            if (peek.value().getPN() == ItemPN('P')) {
-                productCount++;
-            } else {
-                dropCount++;
-            }
+void ABConveyorConfiguration::runSlot(const optional<ItemPN>& generated, const bool& topFirst) {
+    fill(pImpl->topFirst.begin(), pImpl->topFirst.end(), topFirst ? ~0ULL : 0);
+    runSlot(generated, pImpl->topFirst);
+}
+
+void ABConveyorConfiguration::runSlot(const optional<ItemPN>& generated, const vector<uint64_t>& topFirst) {
+    if (topFirst.size() < pImpl->topFirst.size()) {
+        throw invalid_argument(string(__func__) + ": expected a priority bit for each of the "
+                               + to_string(pImpl->belt.getCapacity()) + " positions");
+    }
+    SimulationStatistics* const stats = pImpl->statistics.get();
+    if (stats) {
+        stats->startSlot();
+    }
+
+    // Update statistics:
+    const size_t& cap = pImpl->belt.getCapacity();
+    const auto& peek = pImpl->belt.peekItem(cap-1);
+    if (peek.has_value()) {
+        const bool product = peek.value().getPN() == ItemPN('P');
+        if (product) {
+            productCount++;
+        } else {
+            dropCount++;
+        }
+        if (stats) {
+            stats->recordExit(peek.value(), product);
         }
+    }
+
+    {
+        TraceScope trace(TracePhase::Rotation);
 
         // run the conveyor belt for one slot:
         pImpl->belt.run(1);
 
-        // place the next item from the generator
-        auto item = pImpl->generator.get_next_item();
-        if (item.has_value()) {
-            pImpl->belt.enqueueItem(move(item.value()));
-            item = nullopt;
+        // place the generated item
+        if (generated.has_value()) {
+            pImpl->belt.enqueueItem(Item(generated.value(), stats ? stats->getSlot() : 0));
         }
+    }
 
-        // Run the workers for 1 slot with random worker priority on the
-        // conveyor belt position:
-        const int priority = pImpl->udst(pImpl->rng);
-        for(size_t pos = 0; pos < pImpl->belt.getCapacity(); pos++) {
-            if (priority % 2) {
-                pImpl->topWorkers.at(pos).run(1);
-                pImpl->bottomWorkers.at(pos).run(1);
+    // Run the workers for 1 slot with the given worker priority on the
+    // conveyor belt position:
+    TraceScope trace(TracePhase::WorkerSweep);
+    const WorkerContext context = pImpl->context();
+    if (!pImpl->arbiter->tracksService()) {
+        for(size_t pos = 0; pos < cap; pos++) {
+            const auto& controller = pImpl->controllers[pos];
+            if ((topFirst[pos / 64] >> (pos % 64)) & 1U) {
+                pImpl->topWorkers[pos].run(context, controller, 2 * pos);
+                pImpl->bottomWorkers[pos].run(context, controller, 2 * pos + 1);
             } else {
-                pImpl->bottomWorkers.at(pos).run(1);
-                pImpl->topWorkers.at(pos).run(1);
+                pImpl->bottomWorkers[pos].run(context, controller, 2 * pos + 1);
+                pImpl->topWorkers[pos].run(context, controller, 2 * pos);
             }
         }
+        return;
+    }
+
+    // A worker was served if it reserved its position by collecting or placing an item
+    fill(pImpl->topServed.begin(), pImpl->topServed.end(), 0);
+    fill(pImpl->bottomServed.begin(), pImpl->bottomServed.end(), 0);
+    for(size_t pos = 0; pos < cap; pos++) {
+        const bool top = (topFirst[pos / 64] >> (pos % 64)) & 1U;
+        const auto& controller = pImpl->controllers[pos];
+        const bool reserved = controller.isReserved();
+        (top ? pImpl->topWorkers : pImpl->bottomWorkers)[pos].run(context, controller, 2 * pos + !top);
+        const bool firstServed = !reserved && controller.isReserved();
+        (top ? pImpl->bottomWorkers : pImpl->topWorkers)[pos].run(context, controller, 2 * pos + top);
+        const bool secondServed = !reserved && !firstServed && controller.isReserved();
+        const uint64_t bit = 1ULL << (pos % 64);
+        pImpl->topServed[pos / 64] |= (top ? firstServed : secondServed) ? bit : 0;
+        pImpl->bottomServed[pos / 64] |= (top ? secondServed : firstServed) ? bit : 0;
+    }
+    pImpl->arbiter->served(pImpl->topServed, pImpl->bottomServed);
+}
+
+void ABConveyorConfiguration::reset(const optional<uint64_t>& seed) {
+    // Everything is reset in place, so that reusing a configuration costs a pass over the belt
+    // instead of its construction
+    reseed(seed);
+    pImpl->belt.clear();
+    for (size_t pos = 0; pos < pImpl->belt.getCapacity(); pos++) {
+        pImpl->topWorkers[pos].reset();
+        pImpl->bottomWorkers[pos].reset();
+    }
+    const size_t numSegments = pImpl->statistics ? pImpl->statistics->getNumSegments() : 0;
+    productCount = 0;
+    dropCount = 0;
+    if (numSegments) {
+        enableStatistics(numSegments);
     }
 }
 
+void ABConveyorConfiguration::reseed(const optional<uint64_t>& seed) {
+    pImpl->generator.reseed(itemSeed(seed));
+    pImpl->arbiter = makeArbitrationPolicy(pImpl->arbitration, pImpl->belt.getCapacity(), prioritySeed(seed));
+}
+
+bool ABConveyorConfiguration::usesFixedShapeEngine() const {
+    return pImpl->fixed && !pImpl->statistics;
+}
+
 size_t ABConveyorConfiguration::getProductCount() const {
     return productCount;
 }
@@ -105,6 +277,24 @@ size_t ABConveyorConfiguration::getDropCount() const {
     return dropCount;
 }
 
+optional<ItemPN> ABConveyorConfiguration::peekLastItem() const {
+    const auto& peek = pImpl->belt.peekItem(pImpl->belt.getCapacity() - 1);
+    return peek.has_value() ? optional(peek.value().getPN()) : nullopt;
+}
+
+size_t ABConveyorConfiguration::getOccupiedPositions() const {
+    return pImpl->belt.getOccupiedPositions();
+}
+
+void ABConveyorConfiguration::enableStatistics(const size_t& numSegments) {
+    // The workers find the statistics through the context they are run with
+    pImpl->statistics = make_unique<SimulationStatistics>(pImpl->belt.getCapacity(), numSegments);
+}
+
+const SimulationStatistics* ABConveyorConfiguration::getStatistics() const {
+    return pImpl->statistics.get();
+}
+
 namespace conveyorsim {
 
 ostream& operator<<(ostream& os, const ABConveyorConfiguration& obj) {
@@ -114,11 +304,15 @@ ostream& operator<<(ostream& os, const ABConveyorConfiguration& obj) {
     os << "***** Conveyor Belt Status: *****" << endl;
     os << obj.pImpl->belt << endl;
     os << "***** Workers Status: *****" << endl;
+    const WorkerContext context = obj.pImpl->context();
     for (size_t pos = 0; pos < obj.pImpl->belt.getCapacity(); pos++) {
+        const auto& controller = obj.pImpl->controllers.at(pos);
         os << "*** Top Worker: " << to_string(pos) << " ***" << endl;
-        os << obj.pImpl->topWorkers.at(pos) << endl;
+        obj.pImpl->topWorkers.at(pos).print(os, context, controller);
+        os << endl;
         os << "*** Bottom Worker: " << to_string(pos) << " ***" << endl;
-        os << obj.pImpl->bottomWorkers.at(pos) << endl;
+        obj.pImpl->bottomWorkers.at(pos).print(os, context, controller);
+        os << endl;
     }
     return os;
 }
@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include "ArbitrationPolicies.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+size_t numWords(const size_t& convCap) {
+    return (convCap + 63) / 64;
+}
+
+} // namespace
+
+namespace conveyorsim {
+
+optional<ArbitrationPolicy> parseArbitrationPolicy(const string& name) {
+    if (name == "global-random") {
+        return ArbitrationPolicy::GlobalRandom;
+    }
+    if (name == "position-random") {
+        return ArbitrationPolicy::PositionRandom;
+    }
+    if (name == "round-robin") {
+        return ArbitrationPolicy::RoundRobin;
+    }
+    if (name == "least-recently-served") {
+        return ArbitrationPolicy::LeastRecentlyServed;
+    }
+    return nullopt;
+}
+
+unique_ptr<ArbitrationPolicyIF> makeArbitrationPolicy(const ArbitrationPolicy& policy, const size_t& convCap,
+                                                      const uint64_t& seed) {
+    switch (policy) {
+        case ArbitrationPolicy::PositionRandom:
+            return make_unique<PositionRandomArbitration>(seed);
+        case ArbitrationPolicy::RoundRobin:
+            return make_unique<RoundRobinArbitration>(convCap);
+        case ArbitrationPolicy::LeastRecentlyServed:
+            return make_unique<LeastRecentlyServedArbitration>(convCap);
+        case ArbitrationPolicy::GlobalRandom:
+            break;
+    }
+    return make_unique<GlobalRandomArbitration>(seed);
+}
+
+} // conveyorsim
+
+GlobalRandomArbitration::GlobalRandomArbitration(const uint64_t& seed) :
+        rng(seed),
+        udst(0, 2)
+{ }
+
+void GlobalRandomArbitration::arbitrate(vector<uint64_t>& topFirst) {
+    const uint64_t word = udst(rng) % 2 ? ~0ULL : 0;
+    fill(topFirst.begin(), topFirst.end(), word);
+}
+
+bool GlobalRandomArbitration::tracksService() const {
+    return false;
+}
+
+void GlobalRandomArbitration::served(const vector<uint64_t>& /*top*/, const vector<uint64_t>& /*bottom*/) { }
+
+PositionRandomArbitration::PositionRandomArbitration(const uint64_t& seed) :
+        rng(seed)
+{ }
+
+void PositionRandomArbitration::arbitrate(vector<uint64_t>& topFirst) {
+    for (auto& word: topFirst) {
+        word = rng();
+    }
+}
+
+bool PositionRandomArbitration::tracksService() const {
+    return false;
+}
+
+void PositionRandomArbitration::served(const vector<uint64_t>& /*top*/, const vector<uint64_t>& /*bottom*/) { }
+
+RoundRobinArbitration::RoundRobinArbitration(const size_t& convCap) :
+        next(numWords(convCap), 0x5555555555555555ULL)
+{ }
+
+void RoundRobinArbitration::arbitrate(vector<uint64_t>& topFirst) {
+    for (size_t idx = 0; idx < next.size(); idx++) {
+        topFirst[idx] = next[idx];
+        next[idx] = ~next[idx];
+    }
+}
+
+bool RoundRobinArbitration::tracksService() const {
+    return false;
+}
+
+void RoundRobinArbitration::served(const vector<uint64_t>& /*top*/, const vector<uint64_t>& /*bottom*/) { }
+
+LeastRecentlyServedArbitration::LeastRecentlyServedArbitration(const size_t& convCap) :
+        topServedLast(numWords(convCap), 0)
+{ }
+
+void LeastRecentlyServedArbitration::arbitrate(vector<uint64_t>& topFirst) {
+    for (size_t idx = 0; idx < topServedLast.size(); idx++) {
+        topFirst[idx] = ~topServedLast[idx];
+    }
+}
+
+bool LeastRecentlyServedArbitration::tracksService() const {
+    return true;
+}
+
+void LeastRecentlyServedArbitration::served(const vector<uint64_t>& top, const vector<uint64_t>& bottom) {
+    for (size_t idx = 0; idx < topServedLast.size(); idx++) {
+        topServedLast[idx] = (topServedLast[idx] & ~bottom[idx]) | top[idx];
+    }
+}
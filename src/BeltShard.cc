@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <random>
+#include <unordered_set>
+#include "ABConveyorConfiguration.h"
+#include "Seeding.h"
+#include "TraceRecorder.h"
+#include "UniformRandomItemGenerator.h"
+#include "BeltShard.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+class BeltShard::impl {
+public:
+    impl(const size_t& segmentCap, const size_t& assemblyDuration, const uint64_t& seed,
+         BoundaryChannelIF* input, BoundaryChannelIF* output) :
+            segment(segmentCap, assemblyDuration),
+            input(input),
+            output(output),
+            rng(deriveSeed(seed, RandomStream::WorkerPriority)),
+            udst(0, 2)
+    {
+        if (!input) {
+            generator = make_unique<UniformRandomItemGenerator>(unordered_set<ItemPN>{ItemPN('A'), ItemPN('B')}, true,
+                                                                deriveSeed(seed, RandomStream::ItemGeneration));
+        }
+    }
+    ABConveyorConfiguration segment;
+    BoundaryChannelIF* const input;
+    BoundaryChannelIF* const output;
+    unique_ptr<UniformRandomItemGenerator> generator;
+    mt19937 rng;
+    uniform_int_distribution<size_t> udst;
+};
+
+BeltShard::BeltShard(const size_t& segmentCap, const size_t& assemblyDuration, const uint64_t& seed,
+                     BoundaryChannelIF* input, BoundaryChannelIF* output) :
+        pImpl(make_unique<impl>(segmentCap, assemblyDuration, seed, input, output))
+{ }
+
+BeltShard::~BeltShard() = default;
+
+void BeltShard::run(const size_t& numSlots) {
+    for (size_t slot = 0; slot < numSlots; slot++) {
+        TraceRecorder::nextSlot();
+
+        // Sending before receiving lets every segment run ahead of the ones downstream; both
+        // wait on the channel while it is full or empty
+        if (pImpl->output) {
+            TraceScope trace(TracePhase::IO);
+            pImpl->output->send(pImpl->segment.peekLastItem());
+        }
+
+        optional<ItemPN> arriving;
+        if (pImpl->input) {
+            TraceScope trace(TracePhase::IO);
+            arriving = pImpl->input->receive();
+        } else {
+            TraceScope trace(TracePhase::Generation);
+            const auto item = pImpl->generator->get_next_item();
+            if (item.has_value()) {
+                arriving = item.value().getPN();
+            }
+        }
+
+        const int priority = pImpl->udst(pImpl->rng);
+        pImpl->segment.runSlot(arriving, priority % 2);
+    }
+}
+
+size_t BeltShard::getProductCount() const {
+    return pImpl->segment.getProductCount();
+}
+
+size_t BeltShard::getDropCount() const {
+    return pImpl->segment.getDropCount();
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include "CapacityOptimizer.h"
+#include "LockstepReplicaEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Keeps the likelihood ratio finite when every observation so far was the same
+constexpr double minVariance = 1e-12;
+
+// Gives every candidate capacity replicas of its own
+uint64_t candidateSeed(const uint64_t& seed, const size_t& capacity) {
+    return seed ^ (capacity * 0x9e3779b97f4a7c15ULL);
+}
+
+} // namespace
+
+CapacityOptimizer::CapacityOptimizer(const size_t& assemblyDuration, const double& targetRate,
+                                     const size_t& maxCapacity, const optional<uint64_t>& seed,
+                                     const Settings& settings) :
+        assemblyDuration(assemblyDuration),
+        targetRate(targetRate),
+        maxCapacity(maxCapacity),
+        seed(seed),
+        settings(settings)
+{
+    if (!(targetRate > 0)) {
+        throw invalid_argument(string(__func__) + ": the target rate must be positive");
+    }
+    if (!maxCapacity) {
+        throw invalid_argument(string(__func__) + ": the maximum capacity must not be 0");
+    }
+    if (!(settings.alpha > 0 && settings.alpha < 0.5 && settings.beta > 0 && settings.beta < 0.5)) {
+        throw invalid_argument(string(__func__) + ": the error bounds must be between 0 and 0.5");
+    }
+    if (!(settings.indifference > 0 && settings.indifference < 1)) {
+        throw invalid_argument(string(__func__) + ": the indifference must be between 0 and 1");
+    }
+}
+
+CapacityOptimizer::CapacityOptimizer(const size_t& assemblyDuration, const double& targetRate,
+                                     const size_t& maxCapacity, const optional<uint64_t>& seed) :
+        CapacityOptimizer(assemblyDuration, targetRate, maxCapacity, seed, Settings())
+{ }
+
+CapacityOptimizer::Decision CapacityOptimizer::test(const size_t& capacity) const {
+    LockstepReplicaEngine engine(capacity, assemblyDuration,
+                                 seed.has_value() ? optional(candidateSeed(seed.value(), capacity)) : nullopt);
+    const size_t batchSlots = settings.batchSlots ? settings.batchSlots : max<size_t>(1000, 10 * capacity);
+
+    // Wald's boundaries on the log likelihood ratio of "above" against "below"
+    const double upper = log((1 - settings.beta) / settings.alpha);
+    const double lower = log(settings.beta / (1 - settings.alpha));
+    const double delta = settings.indifference * targetRate;
+
+    Decision decision{capacity, false, 0, 0, capacity, false};
+    engine.run(capacity);
+    array<size_t, LockstepReplicaEngine::Lanes> previous{};
+    for (size_t lane = 0; lane < LockstepReplicaEngine::Lanes; lane++) {
+        previous[lane] = engine.getProductCount(lane);
+    }
+
+    double sum = 0;
+    double sumSquares = 0;
+    for (;;) {
+        engine.run(batchSlots);
+        decision.slots += batchSlots;
+        for (size_t lane = 0; lane < LockstepReplicaEngine::Lanes; lane++) {
+            const size_t products = engine.getProductCount(lane);
+            const double rate = static_cast<double>(products - previous[lane]) / batchSlots;
+            previous[lane] = products;
+            sum += rate;
+            sumSquares += rate * rate;
+        }
+        decision.observations += LockstepReplicaEngine::Lanes;
+
+        // For normal observations of variance s^2, the log likelihood ratio of the means
+        // target + delta and target - delta is 2 delta (sum - n target) / s^2
+        const double n = decision.observations;
+        decision.productRate = sum / n;
+        const double variance = max(minVariance,
+                                    (sumSquares - n * decision.productRate * decision.productRate) / (n - 1));
+        const double llr = 2 * delta * (sum - n * targetRate) / variance;
+        if (llr >= upper || llr <= lower) {
+            decision.meetsTarget = llr >= upper;
+            return decision;
+        }
+        if (decision.slots >= settings.maxSlots) {
+            decision.meetsTarget = decision.productRate >= targetRate;
+            decision.truncated = true;
+            return decision;
+        }
+    }
+}
+
+CapacityOptimizer::Result CapacityOptimizer::run() const {
+    Result result{nullopt, 1, 0, {}};
+    const auto decide = [&](const size_t& capacity) {
+        const Decision decision = test(capacity);
+        result.decisions.push_back(decision);
+        result.totalSlots += decision.slots * LockstepReplicaEngine::Lanes;
+        result.confidence -= decision.truncated ? 0.5 : decision.meetsTarget ? settings.alpha : settings.beta;
+        return decision.meetsTarget;
+    };
+
+    // The smallest capacity meeting the target lies in [low, high] once high is known to meet it
+    if (decide(maxCapacity)) {
+        size_t low = 1;
+        size_t high = maxCapacity;
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            if (decide(mid)) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        result.capacity = high;
+    }
+    result.confidence = max(0.0, result.confidence);
+    return result;
+}
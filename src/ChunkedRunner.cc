@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include "ChunkedRunner.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+volatile sig_atomic_t stopFlag = 0;
+volatile sig_atomic_t stopSignal = 0;
+
+void stopHandler(int signal) {
+    stopSignal = signal;
+    stopFlag = 1;
+}
+
+} // namespace
+
+ChunkedRunner::ChunkedRunner(const uint64_t& chunkSlots) :
+        chunkSlots(chunkSlots)
+{
+    if (!chunkSlots) {
+        throw invalid_argument(string(__func__) + ": attempt to run in empty chunks");
+    }
+}
+
+uint64_t ChunkedRunner::run(SimulationComponentIF& component, const uint64_t& numSlots,
+                            const function<void(const uint64_t&)>& afterChunk) const {
+    uint64_t slotsRun = 0;
+    while (slotsRun < numSlots && !stopRequested()) {
+        const uint64_t chunk = min(chunkSlots, numSlots - slotsRun);
+        component.run(chunk);
+        slotsRun += chunk;
+        if (afterChunk) {
+            afterChunk(slotsRun);
+        }
+    }
+    return slotsRun;
+}
+
+void ChunkedRunner::installSignalHandlers() {
+    struct sigaction action{};
+    action.sa_handler = stopHandler;
+    sigemptyset(&action.sa_mask);
+    // The handler only sets a flag; a second signal gets the default action
+    action.sa_flags = SA_RESETHAND | SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+void ChunkedRunner::requestStop() {
+    stopFlag = 1;
+}
+
+void ChunkedRunner::clearStopRequest() {
+    stopFlag = 0;
+    stopSignal = 0;
+}
+
+bool ChunkedRunner::stopRequested() {
+    return stopFlag;
+}
+
+int ChunkedRunner::getStopSignal() {
+    return stopSignal;
+}
@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "ABConveyorConfiguration.h"
+#include "Seeding.h"
+#include "UniformRandomItemGenerator.h"
+#include "CommonRandomNumbersComparison.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Two sided 95% quantile of the Student t distribution, from the Cornish-Fisher expansion
+// around the normal quantile; accurate to about 1e-3 from 2 degrees of freedom on
+double studentQuantile(const double& degreesOfFreedom) {
+    const double z = 1.959963984540054;
+    const double z3 = z * z * z;
+    const double z5 = z3 * z * z;
+    const double z7 = z5 * z * z;
+    const double nu = degreesOfFreedom;
+    return z + (z3 + z) / (4 * nu) + (5 * z5 + 16 * z3 + 3 * z) / (96 * nu * nu)
+           + (3 * z7 + 19 * z5 + 17 * z3 - 15 * z) / (384 * nu * nu * nu);
+}
+
+double mean(const vector<double>& samples) {
+    double sum = 0;
+    for (const auto& sample: samples) {
+        sum += sample;
+    }
+    return sum / samples.size();
+}
+
+// Unbiased sample variance
+double variance(const vector<double>& samples) {
+    const double mu = mean(samples);
+    double sum = 0;
+    for (const auto& sample: samples) {
+        sum += (sample - mu) * (sample - mu);
+    }
+    return sum / (samples.size() - 1);
+}
+
+CommonRandomNumbersComparison::Estimate estimate(const vector<double>& batchMeans) {
+    const double n = batchMeans.size();
+    return {mean(batchMeans), studentQuantile(n - 1) * sqrt(variance(batchMeans) / n)};
+}
+
+double varianceReduction(const vector<double>& reference, const vector<double>& variant,
+                         const vector<double>& difference) {
+    const double paired = variance(difference);
+    return paired > 0 ? (variance(reference) + variance(variant)) / paired : numeric_limits<double>::infinity();
+}
+
+vector<double> subtract(const vector<double>& lhs, const vector<double>& rhs) {
+    vector<double> result(lhs.size());
+    for (size_t idx = 0; idx < lhs.size(); idx++) {
+        result[idx] = lhs[idx] - rhs[idx];
+    }
+    return result;
+}
+
+} // namespace
+
+CommonRandomNumbersComparison::CommonRandomNumbersComparison(const vector<Variant>& variants,
+                                                             const optional<uint64_t>& seed) :
+        variants(variants),
+        seed(seed)
+{
+    if (variants.empty()) {
+        throw invalid_argument(string(__func__) + ": attempt to compare an empty set of variants");
+    }
+    for (const auto& variant: variants) {
+        if (!variant.capacity) {
+            throw invalid_argument(string(__func__) + ": attempt to compare a zero capacity variant");
+        }
+    }
+}
+
+CommonRandomNumbersComparison::Result CommonRandomNumbersComparison::run(const size_t& numSlots,
+                                                                         const size_t& numBatches,
+                                                                         const size_t& warmupSlots) const {
+    if (numBatches < 2) {
+        throw invalid_argument(string(__func__) + ": confidence intervals need at least 2 batches");
+    }
+    if (numSlots < warmupSlots || numSlots - warmupSlots < numBatches) {
+        throw invalid_argument(string(__func__) + ": fewer measured timeslots than batches");
+    }
+    const size_t batchSlots = (numSlots - warmupSlots) / numBatches;
+
+    // The shared streams are seeded like the streams of a seeded ABConveyorConfiguration, so
+    // every variant reproduces the standalone run with the same seed
+    random_device rd;
+    const UniformRandomItemGenerator generator({ItemPN('A'), ItemPN('B')}, true,
+            seed.has_value() ? optional(deriveSeed(seed.value(), RandomStream::ItemGeneration)) : nullopt);
+    mt19937 rng(seed.has_value() ? deriveSeed(seed.value(), RandomStream::WorkerPriority) : rd());
+    uniform_int_distribution<size_t> udst(0, 2);
+
+    // The variants are driven through runSlot() and never draw from their own streams, but they
+    // are seeded alike so that they neither read std::random_device nor differ between runs
+    vector<unique_ptr<ABConveyorConfiguration>> sims;
+    for (const auto& variant: variants) {
+        sims.push_back(make_unique<ABConveyorConfiguration>(variant.capacity, variant.assemblyDuration, seed));
+    }
+
+    const auto runSlots = [&](const size_t& slots) {
+        for (size_t slot = 0; slot < slots; slot++) {
+            const auto item = generator.get_next_item();
+            const bool topFirst = udst(rng) % 2;
+            const optional<ItemPN> generated = item.has_value() ? optional(item.value().getPN()) : nullopt;
+            for (auto& sim: sims) {
+                sim->runSlot(generated, topFirst);
+            }
+        }
+    };
+
+    runSlots(warmupSlots);
+
+    vector<size_t> productsBefore;
+    vector<size_t> dropsBefore;
+    for (const auto& sim: sims) {
+        productsBefore.push_back(sim->getProductCount());
+        dropsBefore.push_back(sim->getDropCount());
+    }
+
+    vector<vector<double>> productMeans(sims.size());
+    vector<vector<double>> dropMeans(sims.size());
+    for (size_t batch = 0; batch < numBatches; batch++) {
+        vector<size_t> products;
+        vector<size_t> drops;
+        for (const auto& sim: sims) {
+            products.push_back(sim->getProductCount());
+            drops.push_back(sim->getDropCount());
+        }
+        runSlots(batchSlots);
+        for (size_t idx = 0; idx < sims.size(); idx++) {
+            productMeans[idx].push_back(static_cast<double>(sims[idx]->getProductCount() - products[idx]) / batchSlots);
+            dropMeans[idx].push_back(static_cast<double>(sims[idx]->getDropCount() - drops[idx]) / batchSlots);
+        }
+    }
+
+    Result result{warmupSlots, batchSlots, numBatches, {}, {}};
+    for (size_t idx = 0; idx < sims.size(); idx++) {
+        result.variants.push_back({variants[idx],
+                                   sims[idx]->getProductCount() - productsBefore[idx],
+                                   sims[idx]->getDropCount() - dropsBefore[idx],
+                                   estimate(productMeans[idx]),
+                                   estimate(dropMeans[idx])});
+    }
+    for (size_t idx = 1; idx < sims.size(); idx++) {
+        const auto productDifference = subtract(productMeans[idx], productMeans[0]);
+        const auto dropDifference = subtract(dropMeans[idx], dropMeans[0]);
+        result.differences.push_back({variants[idx],
+                                      estimate(productDifference),
+                                      estimate(dropDifference),
+                                      varianceReduction(productMeans[0], productMeans[idx], productDifference),
+                                      varianceReduction(dropMeans[0], dropMeans[idx], dropDifference)});
+    }
+    return result;
+}
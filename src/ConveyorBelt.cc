@@ -3,6 +3,7 @@
 //
 
 #include <exception>
+#include <ostream>
 #include <string>
 #include <boost/circular_buffer.hpp>
 #include "ConveyorBelt.h"
@@ -13,7 +14,9 @@ using namespace conveyorsim;
 class ConveyorBelt::impl {
 public:
     explicit impl(const size_t& capacity) : belt(capacity, nullopt) {}
-    boost::circular_buffer<std::optional<Item>> belt;
+    boost::circular_buffer<std::optional<Item>, PlacedAllocator<std::optional<Item>>> belt;
+    // Positions holding an item, kept up to date by every change so that it is never counted
+    size_t occupied = 0;
 };
 
 namespace {
@@ -36,8 +39,8 @@ namespace {
 }
 
 ConveyorBelt::ConveyorBelt(const size_t &capacity) :
-pImpl(make_unique<impl>(capacity)),
-reserved(capacity,false)
+reserved(capacity,false),
+pImpl(make_unique<impl>(capacity))
 {
     if (!capacity) {
         throw invalid_argument(string(__func__) + ": attempt to construct a zero capacity conveyor belt");
@@ -60,6 +63,7 @@ ConveyorBelt::enqueueItem(Item&& item)
         throw runtime_error(reservedErr(__func__, 0));
     }
     pImpl->belt.at(0).emplace(move(item));
+    pImpl->occupied++;
 }
 
 Item
@@ -76,6 +80,7 @@ ConveyorBelt::collectItem(const size_t &pos)
     }
     Item it = pImpl->belt.at(pos).value();
     pImpl->belt.at(pos) = nullopt;
+    pImpl->occupied--;
     reserved.at(pos) = true;
     return it;
 }
@@ -91,6 +96,7 @@ void ConveyorBelt::emplaceItem(Item&& item, const size_t& pos) {
         throw invalid_argument(nonEmptyPosErr(__func__, pos));
     }
     pImpl->belt.at(pos).emplace(move(item));
+    pImpl->occupied++;
     reserved.at(pos) = true;
 }
 
@@ -123,6 +129,7 @@ ConveyorBelt::peekItem(const size_t &pos) const
 void
 ConveyorBelt::rotate()
 {
+    pImpl->occupied -= pImpl->belt.back().has_value();
     pImpl->belt.push_front(nullopt);
 }
 
@@ -136,6 +143,28 @@ size_t ConveyorBelt::getCapacity() const {
     return pImpl->belt.capacity();
 }
 
+size_t ConveyorBelt::getOccupiedPositions() const {
+    return pImpl->occupied;
+}
+
+void ConveyorBelt::clear() {
+    for (size_t pos = 0; pos < getCapacity(); pos++) {
+        pImpl->belt[pos] = nullopt;
+        reserved[pos] = false;
+    }
+    pImpl->occupied = 0;
+}
+
+void ConveyorBelt::restore(const size_t& pos, optional<Item>&& item, const bool& reservation) {
+    if (!validPos(pos)) {
+        throw out_of_range(outOfRangeErr(__func__, pos, pImpl->belt.capacity()));
+    }
+    pImpl->occupied += item.has_value();
+    pImpl->occupied -= pImpl->belt.at(pos).has_value();
+    pImpl->belt.at(pos) = move(item);
+    reserved.at(pos) = reservation;
+}
+
 void ConveyorBelt::run(const size_t &numSlots) {
     for(size_t i = 0; i < numSlots; i++) {
         rotate();
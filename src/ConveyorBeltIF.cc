@@ -2,6 +2,7 @@
 // Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
 //
 
+#include <ostream>
 #include "ConveyorBeltIF.h"
 using namespace conveyorsim;
 using namespace std;
@@ -2,6 +2,7 @@
 // Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
 //
 
+#include <ostream>
 #include "ConveyorPositionControllerIF.h"
 
 using namespace std;
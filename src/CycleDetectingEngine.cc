@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include "CycleDetectingEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+CycleDetectingEngine::CycleDetectingEngine(const size_t& convCap, const size_t& assemblyDuration,
+                                           const PeriodicItemGenerator& generator, const vector<bool>& topFirst,
+                                           const bool& detectCycles) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        topFirst(topFirst),
+        detectCycles(detectCycles)
+{
+    if (!convCap || topFirst.empty()) {
+        throw invalid_argument(string(__func__) + ": the capacity and the priority pattern must not be empty");
+    }
+    if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+    }
+    // The pattern from the phase the generator is at
+    const auto& pattern = generator.getPattern();
+    for (size_t idx = 0; idx < pattern.size(); idx++) {
+        const auto& pn = pattern[(generator.getPhase() + idx) % pattern.size()];
+        if (!pn.has_value()) {
+            items.push_back(PackedItem::Empty);
+        } else if (pn.value() == ItemPN('A') || pn.value() == ItemPN('B')) {
+            items.push_back(pn.value() == ItemPN('A') ? PackedItem::A : PackedItem::B);
+        } else {
+            throw invalid_argument(string(__func__) + ": only 'A' and 'B' items are supported");
+        }
+    }
+}
+
+CycleDetectingEngine::Result CycleDetectingEngine::run(const uint64_t& numSlots) const {
+    const auto start = chrono::steady_clock::now();
+    Result result{};
+    PackedABState state(convCap, assemblyDuration);
+    uint64_t slot = 0;
+    uint64_t skipped = 0;
+    const auto step = [&]() {
+        const PackedItem exited = state.step(items[slot % items.size()], topFirst[slot % topFirst.size()]);
+        result.productCount += exited == PackedItem::P;
+        result.dropCount += exited == PackedItem::A || exited == PackedItem::B;
+        slot++;
+    };
+
+    if (detectCycles && numSlots) {
+        // The patterns are part of the state, so a state only repeats a whole number of their
+        // common periods later
+        const uint64_t period = lcm<uint64_t>(items.size(), topFirst.size());
+        PackedABState saved = state;
+        uint64_t savedSlot = 0;
+        uint64_t savedProducts = 0;
+        uint64_t savedDrops = 0;
+        uint64_t power = 1;
+        step();
+        while (slot < numSlots) {
+            const uint64_t length = slot - savedSlot;
+            if (length % period == 0 && state == saved) {
+                const uint64_t cycles = (numSlots - slot) / length;
+                result.cycleLength = length;
+                result.detectionSlot = slot;
+                result.productCount += cycles * (result.productCount - savedProducts);
+                result.dropCount += cycles * (result.dropCount - savedDrops);
+                // The state after the skipped cycles is the current one
+                skipped = cycles * length;
+                slot += skipped;
+                break;
+            }
+            if (length == power) {
+                saved = state;
+                savedSlot = slot;
+                savedProducts = result.productCount;
+                savedDrops = result.dropCount;
+                power *= 2;
+            }
+            step();
+        }
+    }
+    while (slot < numSlots) {
+        step();
+    }
+    result.simulatedSlots = slot - skipped;
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    return result;
+}
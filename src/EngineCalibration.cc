@@ -0,0 +1,255 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits.h>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "ChunkedRunner.h"
+#include "EngineCalibration.h"
+#include "ShardLauncher.h"
+#include "TimeWarpEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+const array<EngineKind, 4> EngineKinds = {EngineKind::Objects, EngineKind::Packed, EngineKind::TimeWarp,
+                                          EngineKind::Sharded};
+
+// Seed of the probes; any seed runs at the same speed
+constexpr uint64_t ProbeSeed = 1;
+
+size_t log2Floor(const size_t& value) {
+    size_t log = 0;
+    while (value >> (log + 1)) {
+        log++;
+    }
+    return log;
+}
+
+string getHostName() {
+    char name[HOST_NAME_MAX + 1] = {};
+    if (gethostname(name, sizeof(name) - 1) || !name[0]) {
+        return "localhost";
+    }
+    // The profile is split on spaces
+    string host(name);
+    replace(host.begin(), host.end(), ' ', '_');
+    return host;
+}
+
+optional<EngineKind> parseKind(const string& name) {
+    for (const auto& kind: EngineKinds) {
+        if (EngineCalibration::getName(kind) == name) {
+            return kind;
+        }
+    }
+    return nullopt;
+}
+
+} // namespace
+
+bool EngineChoice::operator==(const EngineChoice& other) const {
+    return kind == other.kind && threads == other.threads;
+}
+
+EngineCalibration::EngineCalibration(const size_t& convCap, const size_t& assemblyDuration, const size_t& maxThreads,
+                                     const string& profilePath) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        maxThreads(maxThreads),
+        profilePath(profilePath)
+{
+    if (!convCap || !maxThreads) {
+        throw invalid_argument(string(__func__) + ": the capacity and the threads must not be 0");
+    }
+}
+
+EngineCalibration::Selection EngineCalibration::select(const bool& recalibrate) const {
+    Selection selection{{EngineKind::Objects, 1}, {}, false};
+    if (!recalibrate) {
+        selection.probes = load();
+        selection.cached = !selection.probes.empty();
+    }
+    if (!selection.cached) {
+        for (const auto& engine: candidates()) {
+            selection.probes.push_back(probe(engine));
+        }
+        save(selection.probes);
+    }
+    double fastest = -1;
+    for (const auto& probe: selection.probes) {
+        if (probe.updatesPerSecond > fastest) {
+            fastest = probe.updatesPerSecond;
+            selection.engine = probe.engine;
+        }
+    }
+    return selection;
+}
+
+vector<EngineChoice> EngineCalibration::candidates() const {
+    vector<EngineChoice> engines{{EngineKind::Objects, 1}, {EngineKind::Packed, 1}};
+    // A segment needs a position; one segment is the packed engine with extra synchronization
+    const size_t limit = min(maxThreads, min(convCap, ProbeCapacity));
+    for (const auto& kind: {EngineKind::TimeWarp, EngineKind::Sharded}) {
+        for (size_t threads = 2; threads <= limit; threads *= 2) {
+            engines.push_back({kind, threads});
+        }
+        if (limit > 1 && (limit & (limit - 1))) {
+            engines.push_back({kind, limit});
+        }
+    }
+    return engines;
+}
+
+EngineCalibration::Probe EngineCalibration::probe(const EngineChoice& engine) const {
+    // A probe of a few million updates is long enough to time, and a belt of its capacity or of
+    // ProbeCapacity positions has the cache behaviour of larger ones
+    const size_t probeCap = min(convCap, ProbeCapacity);
+    const uint64_t probeSlots = max<uint64_t>(64, ProbeUpdates / probeCap);
+    const auto start = chrono::steady_clock::now();
+    static_cast<void>(run(engine, probeCap, assemblyDuration, ProbeSeed, probeSlots));
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return {engine, static_cast<double>(probeSlots * probeCap) / max(elapsed.count(), 1e-9)};
+}
+
+EngineCalibration::Counts EngineCalibration::run(const EngineChoice& engine, const size_t& convCap,
+                                                 const size_t& assemblyDuration, const uint64_t& seed,
+                                                 const uint64_t& numSlots) {
+    switch (engine.kind) {
+        case EngineKind::Objects: {
+            ABConveyorConfiguration sim(convCap, assemblyDuration, seed);
+            // Chunks of about a million position updates, as for the sim mode
+            const uint64_t slotsRun = ChunkedRunner(max<uint64_t>(1, (1U << 20U) / convCap)).run(sim, numSlots);
+            return {sim.getProductCount(), sim.getDropCount(), slotsRun};
+        }
+        case EngineKind::Packed:
+        case EngineKind::TimeWarp: {
+            // Conservatively, as the optimistic run only pays off where the segments wait for
+            // each other more than they roll back
+            TimeWarpEngine::Settings settings;
+            settings.optimistic = false;
+            const size_t numSegments = engine.kind == EngineKind::Packed ? 1 : engine.threads;
+            const auto result = TimeWarpEngine(convCap, assemblyDuration, numSegments, seed, settings).run(numSlots);
+            return {result.productCount, result.dropCount, result.numSlots};
+        }
+        case EngineKind::Sharded: {
+            const auto result = ShardLauncher(convCap, assemblyDuration, engine.threads, seed).run(numSlots);
+            return {result.productCount, result.dropCount, result.numSlots};
+        }
+    }
+    throw invalid_argument(string(__func__) + ": unknown engine");
+}
+
+string EngineCalibration::getName(const EngineKind& kind) {
+    switch (kind) {
+        case EngineKind::Objects:
+            return "objects";
+        case EngineKind::Packed:
+            return "packed";
+        case EngineKind::TimeWarp:
+            return "timewarp";
+        case EngineKind::Sharded:
+            return "sharded";
+    }
+    return "unknown";
+}
+
+optional<string> EngineCalibration::getDefaultProfilePath() {
+    const char* cache = getenv("XDG_CACHE_HOME");
+    if (cache && cache[0]) {
+        return string(cache) + "/conveyor_sim/calibration";
+    }
+    const char* home = getenv("HOME");
+    if (home && home[0]) {
+        return string(home) + "/.cache/conveyor_sim/calibration";
+    }
+    return nullopt;
+}
+
+string EngineCalibration::getKey() const {
+    // Rates change little within a power of two of the capacity or the duration
+    return getHostName() + " " + to_string(maxThreads) + " " + to_string(log2Floor(convCap)) + " "
+           + to_string(log2Floor(assemblyDuration + 1));
+}
+
+vector<EngineCalibration::Probe> EngineCalibration::load() const {
+    vector<Probe> probes;
+    if (profilePath.empty()) {
+        return probes;
+    }
+    const string key = getKey();
+    ifstream profile(profilePath);
+    for (string line; getline(profile, line);) {
+        if (line.compare(0, key.size() + 1, key + " ")) {
+            continue;
+        }
+        istringstream fields(line.substr(key.size() + 1));
+        string name;
+        Probe probe{{EngineKind::Objects, 0}, 0};
+        fields >> name >> probe.engine.threads >> probe.updatesPerSecond;
+        const auto kind = parseKind(name);
+        // A damaged profile is calibrated again
+        if (fields.fail() || !kind.has_value() || !probe.engine.threads || probe.engine.threads > maxThreads) {
+            return {};
+        }
+        probe.engine.kind = kind.value();
+        // Capacities of the same power of two share the rates, but not all can be split as far
+        if (probe.engine.threads <= convCap) {
+            probes.push_back(probe);
+        }
+    }
+    return probes;
+}
+
+void EngineCalibration::save(const vector<Probe>& probes) const {
+    if (profilePath.empty()) {
+        return;
+    }
+    const string key = getKey();
+    ostringstream contents;
+    {
+        ifstream profile(profilePath);
+        for (string line; getline(profile, line);) {
+            if (line.compare(0, key.size() + 1, key + " ")) {
+                contents << line << '\n';
+            }
+        }
+    }
+    for (const auto& probe: probes) {
+        contents << key << " " << getName(probe.engine.kind) << " " << probe.engine.threads << " "
+                 << probe.updatesPerSecond << '\n';
+    }
+
+    // The profile is only a cache; runs that cannot save it calibrate again next time. Renaming
+    // a complete file over it keeps concurrent runs from reading half of one.
+    error_code error;
+    const filesystem::path path(profilePath);
+    if (path.has_parent_path()) {
+        filesystem::create_directories(path.parent_path(), error);
+    }
+    const string temporary = profilePath + "." + to_string(getpid());
+    {
+        ofstream out(temporary, ios::trunc);
+        out << contents.str();
+        if (!out.flush()) {
+            out.close();
+            unlink(temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), profilePath.c_str())) {
+        unlink(temporary.c_str());
+    }
+}
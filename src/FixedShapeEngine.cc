@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <utility>
+#include "FixedShapeEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Instantiates the engine of every capacity in FixedShapeCapacities and picks the one of *convCap*
+template <size_t... Idx>
+unique_ptr<FixedShapeEngineIF> makeEngine(index_sequence<Idx...>, const size_t& convCap,
+                                          const uint32_t& assemblyDuration) {
+    unique_ptr<FixedShapeEngineIF> engine;
+    ((convCap == FixedShapeCapacities[Idx]
+      && (engine = make_unique<FixedShapeEngine<FixedShapeCapacities[Idx]>>(assemblyDuration))) || ...);
+    return engine;
+}
+
+} // namespace
+
+namespace conveyorsim {
+
+unique_ptr<FixedShapeEngineIF> makeFixedShapeEngine(const size_t& convCap, const uint32_t& assemblyDuration) {
+    return makeEngine(make_index_sequence<FixedShapeCapacities.size()>(), convCap, assemblyDuration);
+}
+
+} // conveyorsim
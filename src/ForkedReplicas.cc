@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "ForkedReplicas.h"
+#include "Seeding.h"
+#include "TraceRecorder.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+void killAll(const vector<pid_t>& pids) {
+    for (const auto& pid: pids) {
+        kill(pid, SIGKILL);
+    }
+    for (const auto& pid: pids) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+} // namespace
+
+ForkedReplicas::ForkedReplicas(const size_t& convCap, const size_t& assemblyDuration, const size_t& numReplicas,
+                               const uint64_t& seed, const size_t& maxRunning) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        numReplicas(numReplicas),
+        seed(seed),
+        maxRunning(maxRunning ? maxRunning : max(1U, thread::hardware_concurrency()))
+{
+    if (!convCap || !numReplicas) {
+        throw invalid_argument(string(__func__) + ": the capacity and the number of replicas must not be 0");
+    }
+}
+
+ForkedReplicas::Result ForkedReplicas::run(const size_t& warmupSlots, const size_t& numSlots) const {
+    const size_t countsBytes = numReplicas * sizeof(Counts);
+    void* const memory = mmap(nullptr, countsBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot map the replica counts");
+    }
+    const unique_ptr<void, function<void(void*)>> countsMapping(memory, [&](void* mapped) {
+        munmap(mapped, countsBytes);
+    });
+    auto* const counts = static_cast<Counts*>(memory);
+
+    Result result{vector<Counts>(numReplicas), 0, 0};
+    auto start = chrono::steady_clock::now();
+    ABConveyorConfiguration sim(convCap, assemblyDuration, seed);
+    sim.run(warmupSlots);
+    const Counts warmup{sim.getProductCount(), sim.getDropCount()};
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    result.warmupSeconds = elapsed.count();
+
+    // Replicas are forked as others finish, so that no more than maxRunning of them copy pages
+    // at a time. They are polled rather than waited for with waitpid(-1, ...), which could reap
+    // children of the caller that are not replicas.
+    start = chrono::steady_clock::now();
+    vector<pid_t> running;
+    size_t forked = 0;
+    while (forked < numReplicas || !running.empty()) {
+        while (forked < numReplicas && running.size() < maxRunning) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                const int error = errno;
+                killAll(running);
+                throw system_error(error, generic_category(), string(__func__) + ": cannot fork replica "
+                                                              + to_string(forked));
+            }
+            if (!pid) {
+                // The replica never returns to the caller
+                try {
+                    TraceRecorder::restartAfterFork("replica " + to_string(forked));
+                    sim.reseed(getReplicaSeed(seed, forked));
+                    sim.run(numSlots);
+                    counts[forked] = {sim.getProductCount() - warmup.productCount,
+                                      sim.getDropCount() - warmup.dropCount};
+                    TraceRecorder::flush();
+                } catch (...) {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            running.push_back(pid);
+            forked++;
+        }
+        for (auto it = running.begin(); it != running.end();) {
+            int status = 0;
+            const pid_t pid = waitpid(*it, &status, WNOHANG);
+            if (!pid || (pid < 0 && errno == EINTR)) {
+                ++it;
+                continue;
+            }
+            it = running.erase(it);
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+                killAll(running);
+                throw runtime_error(string(__func__) + ": a replica failed");
+            }
+        }
+        if (running.size() == maxRunning || (forked == numReplicas && !running.empty())) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    elapsed = chrono::steady_clock::now() - start;
+    result.replicaSeconds = elapsed.count();
+    copy(counts, counts + numReplicas, result.replicas.begin());
+    return result;
+}
+
+uint64_t ForkedReplicas::getReplicaSeed(const uint64_t& seed, const size_t& replica) {
+    // The stream of the replicas keeps every bit of the master seed, and is unrelated to the
+    // streams of the warm-up. As mixBits is a bijection and the step is odd, every replica
+    // index gives a seed of its own.
+    constexpr uint64_t step = 0x9e3779b97f4a7c15ULL;
+    const uint64_t stream = mixBits(seed + (static_cast<uint64_t>(RandomStream::ForkedReplicas) + 1) * step);
+    return mixBits(stream + (static_cast<uint64_t>(replica) + 1) * step);
+}
@@ -8,13 +8,18 @@
 using namespace std;
 using namespace conveyorsim;
 
-Item::Item(const ItemPN& pn) : pn(pn) {}
+Item::Item(const ItemPN& pn, const size_t& enqueueSlot) : pn(pn), enqueueSlot(enqueueSlot) {}
 
 ItemPN Item::getPN() const
 {
     return pn;
 }
 
+size_t Item::getEnqueueSlot() const
+{
+    return enqueueSlot;
+}
+
 bool Item::operator==(const Item& other) const
 {
     return (pn == other.pn);
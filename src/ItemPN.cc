@@ -4,6 +4,7 @@
 
 #include "ItemPN.h"
 #include <functional>
+#include <ostream>
 
 using namespace std;
 using namespace conveyorsim;
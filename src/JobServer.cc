@@ -0,0 +1,473 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "ABConveyorConfiguration.h"
+#include "ChunkedRunner.h"
+#include "JobServer.h"
+#include "Seeding.h"
+#include "TraceRecorder.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// How often listen() checks whether a stop was requested
+constexpr int pollMilliseconds = 100;
+
+// Parses a decimal unsigned 64 bit integer field of a job line
+uint64_t parseField(const string& text, const string& name) {
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+    if (text.front() < '0' || text.front() > '9' || errno == ERANGE || *end != '\0') {
+        throw invalid_argument("parseJob: " + name + " expects an unsigned 64 bit integer, got '" + text + "'");
+    }
+    return parsed;
+}
+
+// Returns the first field of a line, which identifies its job even if the rest is malformed
+string firstField(const string& line) {
+    string field;
+    istringstream(line) >> field;
+    return field;
+}
+
+} // namespace
+
+class JobServer::impl {
+public:
+    // Where the results of a stream of jobs go, and how many of its jobs are still running
+    struct Sink {
+        function<void(const string&)> write;
+        mutex lock;
+        condition_variable idle;
+        size_t pending = 0;
+    };
+
+    // A submitted job, collecting the counts of its replicas as they finish
+    struct JobState {
+        JobState(const Job& job, const shared_ptr<Sink>& sink) :
+                job(job),
+                sink(sink),
+                remaining(job.replicas)
+        { }
+
+        const Job job;
+        const shared_ptr<Sink> sink;
+        mutex lock;
+        size_t remaining;
+        uint64_t productCount = 0;
+        uint64_t dropCount = 0;
+        optional<string> error;
+    };
+
+    impl(const size_t& numThreads, const size_t& maxCachedPositions) :
+            maxCachedPositions(maxCachedPositions)
+    {
+        const size_t count = numThreads ? numThreads : max(1U, thread::hardware_concurrency());
+        threads.reserve(count);
+        for (size_t idx = 0; idx < count; idx++) {
+            threads.emplace_back([this, idx] {
+                TraceRecorder::attachThread("job thread " + to_string(idx));
+                work();
+            });
+        }
+    }
+
+    ~impl() {
+        {
+            lock_guard<mutex> guard(queueLock);
+            stopping = true;
+        }
+        queueReady.notify_all();
+        for (auto& worker: threads) {
+            worker.join();
+        }
+    }
+
+    // Parses a line and queues its replicas, or answers it with an error
+    void submit(const string& line, const shared_ptr<Sink>& sink) {
+        const string id = firstField(line);
+        if (id.empty() || id.front() == '#') {
+            return;
+        }
+        shared_ptr<JobState> state;
+        try {
+            const Job job = parseJob(line);
+            state = make_shared<JobState>(job, sink);
+        } catch (const invalid_argument& error) {
+            lock_guard<mutex> guard(sink->lock);
+            sink->write(id + " error " + error.what());
+            return;
+        }
+        {
+            lock_guard<mutex> guard(sink->lock);
+            sink->pending++;
+        }
+        {
+            lock_guard<mutex> guard(queueLock);
+            for (size_t replica = 0; replica < state->job.replicas; replica++) {
+                queue.emplace_back([this, state, replica] { runReplica(*state, replica); });
+            }
+        }
+        queueReady.notify_all();
+    }
+
+    // Waits until every job submitted to a sink has written its result
+    static void drain(Sink& sink) {
+        unique_lock<mutex> guard(sink.lock);
+        sink.idle.wait(guard, [&] { return !sink.pending; });
+    }
+
+    // Reads job lines from a connected socket until its end, and writes their results as they
+    // complete. The pool threads only queue the results, and this thread sends them, so a client
+    // that does not read its results holds up nothing but its own connection.
+    void serveConnection(const int& fd) {
+        const int wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wake < 0) {
+            return;
+        }
+        // Results not taken by this thread yet, guarded by the lock of the sink
+        string outbox;
+        const auto sink = make_shared<Sink>();
+        sink->write = [&outbox, wake](const string& line) {
+            outbox += line + '\n';
+            const uint64_t increment = 1;
+            static_cast<void>(write(wake, &increment, sizeof(increment)));
+        };
+
+        string buffer;
+        string sending;
+        bool reading = true;
+        bool connected = true;
+        array<char, 4096> chunk{};
+        for (;;) {
+            {
+                lock_guard<mutex> guard(sink->lock);
+                if (connected) {
+                    sending += outbox;
+                }
+                outbox.clear();
+                // Every job wrote its result once nothing is pending; only then may the sink,
+                // which writes to locals of this function, be left behind
+                if (!reading && !sink->pending && sending.empty()) {
+                    break;
+                }
+            }
+            // A socket that is neither read nor written would report a hang up over and over
+            pollfd requests[2] = {{reading || !sending.empty() ? fd : -1,
+                                   static_cast<short>((reading ? POLLIN : 0) | (sending.empty() ? 0 : POLLOUT)), 0},
+                                  {wake, POLLIN, 0}};
+            if (poll(requests, 2, -1) < 0) {
+                continue;
+            }
+            if (requests[1].revents & POLLIN) {
+                uint64_t count = 0;
+                static_cast<void>(read(wake, &count, sizeof(count)));
+            }
+            if (reading && (requests[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+                const ssize_t count = read(fd, chunk.data(), chunk.size());
+                if (count > 0) {
+                    buffer.append(chunk.data(), count);
+                    size_t start = 0;
+                    for (size_t end; (end = buffer.find('\n', start)) != string::npos; start = end + 1) {
+                        submit(buffer.substr(start, end - start), sink);
+                    }
+                    buffer.erase(0, start);
+                } else if (count == 0 || errno != EINTR) {
+                    reading = false;
+                    submit(buffer, sink);
+                }
+            }
+            if (!sending.empty() && (requests[0].revents & (POLLOUT | POLLHUP | POLLERR))) {
+                const ssize_t count = send(fd, sending.data(), sending.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (count > 0) {
+                    sending.erase(0, count);
+                } else if (count < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    // The client went away; the rest of its results are dropped
+                    connected = false;
+                    sending.clear();
+                }
+            }
+        }
+        close(wake);
+    }
+
+    atomic<size_t> constructedCount{0};
+
+private:
+    void work() {
+        for (;;) {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(queueLock);
+                TraceScope trace(TracePhase::Wait, true);
+                queueReady.wait(guard, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                task = move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    void runReplica(JobState& state, const size_t& replica) {
+        const Job& job = state.job;
+        uint64_t products = 0;
+        uint64_t drops = 0;
+        optional<string> error;
+        try {
+            auto config = acquire(job, job.seed.has_value() ? optional(getReplicaSeed(job.seed.value(), replica)) : nullopt);
+            // Chunks of about a million position updates, as for the sim mode
+            const uint64_t slotsRun = ChunkedRunner(max<uint64_t>(1, (1U << 20U) / job.capacity))
+                    .run(*config, job.numSlots);
+            products = config->getProductCount();
+            drops = config->getDropCount();
+            release(job, move(config));
+            if (slotsRun < job.numSlots) {
+                error = "stopped after " + to_string(slotsRun) + " of " + to_string(job.numSlots) + " timeslots";
+            }
+        } catch (const exception& exception) {
+            error = exception.what();
+        }
+
+        lock_guard<mutex> guard(state.lock);
+        state.productCount += products;
+        state.dropCount += drops;
+        if (error.has_value() && !state.error.has_value()) {
+            state.error = error;
+        }
+        if (--state.remaining) {
+            return;
+        }
+
+        string line;
+        if (state.error.has_value()) {
+            line = job.id + " error " + state.error.value();
+        } else {
+            const double replicas = job.replicas;
+            const double slots = job.numSlots;
+            line = formatResult({job.id, state.productCount / replicas, state.dropCount / replicas,
+                                 job.numSlots ? state.productCount / replicas / slots : 0,
+                                 job.numSlots ? state.dropCount / replicas / slots : 0});
+        }
+        Sink& sink = *state.sink;
+        {
+            lock_guard<mutex> sinkGuard(sink.lock);
+            sink.write(line);
+            sink.pending--;
+        }
+        sink.idle.notify_all();
+    }
+
+    // Takes an idle configuration of the job's shape and resets it, or constructs one
+    unique_ptr<ABConveyorConfiguration> acquire(const Job& job, const optional<uint64_t>& seed) {
+        unique_ptr<ABConveyorConfiguration> config;
+        {
+            lock_guard<mutex> guard(cacheLock);
+            auto& configs = idle[{job.capacity, job.assemblyDuration}];
+            if (!configs.empty()) {
+                config = move(configs.back());
+                configs.pop_back();
+                idlePositions -= job.capacity;
+            }
+        }
+        if (config) {
+            config->reset(seed);
+            return config;
+        }
+        constructedCount++;
+        return make_unique<ABConveyorConfiguration>(job.capacity, job.assemblyDuration, seed);
+    }
+
+    // Keeps a configuration for reuse, unless the idle ones would hold too many positions
+    void release(const Job& job, unique_ptr<ABConveyorConfiguration> config) {
+        lock_guard<mutex> guard(cacheLock);
+        if (idlePositions + job.capacity <= maxCachedPositions) {
+            idle[{job.capacity, job.assemblyDuration}].push_back(move(config));
+            idlePositions += job.capacity;
+        }
+    }
+
+    vector<thread> threads;
+    mutex queueLock;
+    condition_variable queueReady;
+    deque<function<void()>> queue;
+    bool stopping = false;
+
+    const size_t maxCachedPositions;
+    mutex cacheLock;
+    map<pair<size_t, size_t>, vector<unique_ptr<ABConveyorConfiguration>>> idle;
+    size_t idlePositions = 0;
+};
+
+JobServer::Job JobServer::parseJob(const string& line) {
+    istringstream in(line);
+    string id;
+    string capacity;
+    string duration;
+    string slots;
+    string seed;
+    if (!(in >> id >> capacity >> duration >> slots >> seed)) {
+        throw invalid_argument(string(__func__) + ": expected id capacity duration timeslots seed [replicas]");
+    }
+    Job job{id, parseField(capacity, "capacity"), parseField(duration, "duration"), parseField(slots, "timeslots"),
+            seed == "-" ? nullopt : optional(parseField(seed, "seed")), 1};
+    string replicas;
+    if (in >> replicas) {
+        job.replicas = parseField(replicas, "replicas");
+    }
+    string trailing;
+    if (in >> trailing) {
+        throw invalid_argument(string(__func__) + ": unexpected field '" + trailing + "'");
+    }
+    if (!job.capacity) {
+        throw invalid_argument(string(__func__) + ": the capacity must not be 0");
+    }
+    if (!job.replicas || job.replicas > MaxReplicas) {
+        throw invalid_argument(string(__func__) + ": the replicas must be between 1 and " + to_string(MaxReplicas));
+    }
+    return job;
+}
+
+string JobServer::formatResult(const Result& result) {
+    ostringstream line;
+    line << result.id << " ok " << result.meanProductCount << " " << result.meanDropCount << " "
+         << result.productRate << " " << result.dropRate;
+    return line.str();
+}
+
+JobServer::JobServer(const size_t& numThreads, const size_t& maxCachedPositions) :
+        pImpl(make_unique<impl>(numThreads, maxCachedPositions))
+{ }
+
+JobServer::~JobServer() = default;
+
+uint64_t JobServer::getReplicaSeed(const uint64_t& seed, const size_t& replica) {
+    if (replica == 0) {
+        return seed;
+    }
+    // As for ForkedReplicas, the stream keeps every bit of the seed and every replica index
+    // gives a seed of its own
+    constexpr uint64_t step = 0x9e3779b97f4a7c15ULL;
+    const uint64_t stream = mixBits(seed + (static_cast<uint64_t>(RandomStream::JobReplicas) + 1) * step);
+    return mixBits(stream + static_cast<uint64_t>(replica) * step);
+}
+
+void JobServer::serve(istream& in, ostream& out) {
+    const auto sink = make_shared<impl::Sink>();
+    sink->write = [&out](const string& line) {
+        out << line << endl;
+    };
+    for (string line; getline(in, line);) {
+        pImpl->submit(line, sink);
+    }
+    impl::drain(*sink);
+}
+
+void JobServer::listen(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument(string(__func__) + ": '" + path + "' is not a valid socket path");
+    }
+    copy(path.begin(), path.end(), address.sun_path);
+    struct stat status{};
+    if (!lstat(path.c_str(), &status)) {
+        if (!S_ISSOCK(status.st_mode)) {
+            throw invalid_argument(string(__func__) + ": " + path + " exists and is not a socket");
+        }
+        unlink(path.c_str());
+    }
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot create a socket");
+    }
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || ::listen(listener, SOMAXCONN) < 0) {
+        const int error = errno;
+        close(listener);
+        throw system_error(error, generic_category(), string(__func__) + ": cannot listen on " + path);
+    }
+
+    // Every connection is read by a thread of its own; the socket is closed once that thread
+    // was joined, so that its descriptor cannot be reused while it may still be shut down
+    struct Connection {
+        int fd;
+        shared_ptr<atomic<bool>> finished;
+        thread reader;
+    };
+    list<Connection> connections;
+    const auto closeFinished = [&]() {
+        for (auto connection = connections.begin(); connection != connections.end();) {
+            if (!*connection->finished) {
+                ++connection;
+                continue;
+            }
+            connection->reader.join();
+            close(connection->fd);
+            connection = connections.erase(connection);
+        }
+    };
+
+    while (!ChunkedRunner::stopRequested()) {
+        closeFinished();
+        pollfd request{listener, POLLIN, 0};
+        // Timeouts and signals both come back here to check for a stop
+        if (poll(&request, 1, pollMilliseconds) <= 0) {
+            continue;
+        }
+        const int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        auto finished = make_shared<atomic<bool>>(false);
+        connections.push_back({fd, finished, thread([this, fd, finished] {
+            pImpl->serveConnection(fd);
+            *finished = true;
+        })});
+    }
+
+    close(listener);
+    unlink(path.c_str());
+    // Ends the reads of the open connections; their results still get written
+    for (auto& connection: connections) {
+        shutdown(connection.fd, SHUT_RD);
+    }
+    for (auto& connection: connections) {
+        connection.reader.join();
+        close(connection.fd);
+    }
+}
+
+size_t JobServer::getConstructedCount() const {
+    return pImpl->constructedCount;
+}
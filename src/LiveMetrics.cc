@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LiveMetrics.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace conveyorsim {
+
+/// Layout of the shared memory segment. Every field is an atomic so that concurrent reads of a
+/// field being published are well defined; the seqlock makes the copy as a whole consistent.
+struct LiveMetricsSegment {
+    static constexpr uint64_t Magic = 0x53434f4e56455952ULL;
+    static constexpr uint32_t Version = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    int64_t publisherPid;
+
+    alignas(64) atomic<uint64_t> sequence;
+    atomic<uint64_t> slot;
+    atomic<uint64_t> numSlots;
+    atomic<uint64_t> productCount;
+    atomic<uint64_t> dropCount;
+    atomic<uint64_t> occupiedPositions;
+    atomic<uint64_t> capacity;
+    atomic<double> slotsPerSecond;
+    atomic<bool> finished;
+};
+
+} // conveyorsim
+
+namespace {
+
+static_assert(atomic<uint64_t>::is_always_lock_free && atomic<double>::is_always_lock_free
+              && atomic<bool>::is_always_lock_free,
+              "the segment is shared between processes, which needs lock free atomics");
+
+string segmentName(const string& name) {
+    return name.empty() || name.front() != '/' ? "/" + name : name;
+}
+
+} // namespace
+
+LiveMetricsPublisher::LiveMetricsPublisher(const string& name) :
+        name(segmentName(name))
+{
+    const int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot create " + this->name);
+    }
+    if (ftruncate(fd, sizeof(LiveMetricsSegment)) < 0) {
+        const int error = errno;
+        close(fd);
+        shm_unlink(this->name.c_str());
+        throw system_error(error, generic_category(), string(__func__) + ": cannot size " + this->name);
+    }
+    void* const memory = mmap(nullptr, sizeof(LiveMetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(this->name.c_str());
+        throw system_error(error, generic_category(), string(__func__) + ": cannot map " + this->name);
+    }
+
+    // The fresh segment is zero filled, which is a valid even sequence number and empty metrics
+    segment = static_cast<LiveMetricsSegment*>(memory);
+    segment->publisherPid = getpid();
+    segment->version = LiveMetricsSegment::Version;
+    atomic_thread_fence(memory_order_release);
+    segment->magic = LiveMetricsSegment::Magic;
+}
+
+LiveMetricsPublisher::~LiveMetricsPublisher() {
+    munmap(segment, sizeof(LiveMetricsSegment));
+    shm_unlink(name.c_str());
+}
+
+void LiveMetricsPublisher::publish(const LiveMetrics& metrics) {
+    const uint64_t sequence = segment->sequence.load(memory_order_relaxed);
+    segment->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    segment->slot.store(metrics.slot, memory_order_relaxed);
+    segment->numSlots.store(metrics.numSlots, memory_order_relaxed);
+    segment->productCount.store(metrics.productCount, memory_order_relaxed);
+    segment->dropCount.store(metrics.dropCount, memory_order_relaxed);
+    segment->occupiedPositions.store(metrics.occupiedPositions, memory_order_relaxed);
+    segment->capacity.store(metrics.capacity, memory_order_relaxed);
+    segment->slotsPerSecond.store(metrics.slotsPerSecond, memory_order_relaxed);
+    segment->finished.store(metrics.finished, memory_order_relaxed);
+
+    segment->sequence.store(sequence + 2, memory_order_release);
+}
+
+LiveMetricsReader::LiveMetricsReader(const string& name) {
+    const string path = segmentName(name);
+    const int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot open " + path);
+    }
+    // The publisher may not have sized the segment yet
+    struct stat status{};
+    if (fstat(fd, &status) < 0 || static_cast<size_t>(status.st_size) < sizeof(LiveMetricsSegment)) {
+        close(fd);
+        throw runtime_error(string(__func__) + ": " + path + " is not a live metrics segment");
+    }
+    void* const memory = mmap(nullptr, sizeof(LiveMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw system_error(error, generic_category(), string(__func__) + ": cannot map " + path);
+    }
+    segment = static_cast<const LiveMetricsSegment*>(memory);
+    if (segment->magic != LiveMetricsSegment::Magic || segment->version != LiveMetricsSegment::Version) {
+        munmap(const_cast<LiveMetricsSegment*>(segment), sizeof(LiveMetricsSegment));
+        throw runtime_error(string(__func__) + ": " + path + " is not a live metrics segment");
+    }
+    atomic_thread_fence(memory_order_acquire);
+}
+
+LiveMetricsReader::~LiveMetricsReader() {
+    munmap(const_cast<LiveMetricsSegment*>(segment), sizeof(LiveMetricsSegment));
+}
+
+LiveMetrics LiveMetricsReader::read() const {
+    LiveMetrics metrics;
+    for (size_t attempt = 0; attempt < MaxReadAttempts; attempt++) {
+        const uint64_t before = segment->sequence.load(memory_order_acquire);
+
+        metrics.slot = segment->slot.load(memory_order_relaxed);
+        metrics.numSlots = segment->numSlots.load(memory_order_relaxed);
+        metrics.productCount = segment->productCount.load(memory_order_relaxed);
+        metrics.dropCount = segment->dropCount.load(memory_order_relaxed);
+        metrics.occupiedPositions = segment->occupiedPositions.load(memory_order_relaxed);
+        metrics.capacity = segment->capacity.load(memory_order_relaxed);
+        metrics.slotsPerSecond = segment->slotsPerSecond.load(memory_order_relaxed);
+        metrics.finished = segment->finished.load(memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (before % 2 == 0 && segment->sequence.load(memory_order_relaxed) == before) {
+            return metrics;
+        }
+        // Let a publisher that was preempted in the middle of publishing finish
+        this_thread::yield();
+    }
+    metrics.torn = true;
+    return metrics;
+}
+
+int64_t LiveMetricsReader::getPublisherPid() const {
+    return segment->publisherPid;
+}
@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "Seeding.h"
+#include "LockstepReplicaEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+constexpr uint32_t itemA = static_cast<uint32_t>(PackedItem::A);
+constexpr uint32_t itemP = static_cast<uint32_t>(PackedItem::P);
+constexpr uint32_t holdsA = PackedWorker::HoldsA;
+constexpr uint32_t holdsB = PackedWorker::HoldsB;
+constexpr uint32_t holdsP = PackedWorker::HoldsP;
+constexpr uint32_t busy = PackedWorker::Busy;
+
+// The held flag of an 'A' or 'B' is its own item code
+static_assert(static_cast<uint32_t>(PackedItem::A) == PackedWorker::HoldsA);
+static_assert(static_cast<uint32_t>(PackedItem::B) == PackedWorker::HoldsB);
+
+// 1 for an 'A' or a 'B', 0 otherwise
+inline uint32_t isComponent(const uint32_t& item) {
+    return item - itemA < 2;
+}
+
+// a where mask has all bits set, b where it has none
+inline uint32_t select(const uint32_t& mask, const uint32_t& a, const uint32_t& b) {
+    return (a & mask) | (b & ~mask);
+}
+
+// PackedWorker::step on a single lane, with every action masked instead of branched on
+inline void stepLane(uint32_t& cell, uint32_t& reserved, uint32_t& flags, uint32_t& countdown,
+                     const uint32_t& assemblyDuration) {
+    countdown -= countdown != 0;
+
+    // Try to collect: a free arm, not assembling, and an 'A' or 'B' that is still missing
+    const uint32_t held = cell & (holdsA | holdsB);
+    const uint32_t armsUsed = (flags & holdsA) + ((flags & holdsB) >> 1U) + ((flags & holdsP) >> 2U);
+    const uint32_t collect = isComponent(cell) & !reserved & !(flags & busy) & (armsUsed < 2) & !(flags & held);
+    flags |= held & -collect;
+    cell &= ~-collect;
+    reserved |= collect;
+
+    // Try to initialize assembly
+    const uint32_t start = !(flags & busy) & ((flags & (holdsA | holdsB)) == (holdsA | holdsB));
+    flags |= busy & -start;
+    countdown = select(-start, assemblyDuration, countdown);
+
+    // Try to finalize assembly; the components are discarded and the product takes an arm
+    const uint32_t finish = ((flags & busy) != 0) & (countdown == 0);
+    flags = select(-finish, (flags & ~(holdsA | holdsB | busy)) | holdsP, flags);
+
+    // Try to release the product
+    const uint32_t release = !reserved & (cell == 0) & ((flags & holdsP) != 0);
+    flags &= ~(holdsP & -release);
+    cell |= itemP & -release;
+    reserved |= release;
+}
+
+inline uint32_t rotl(const uint32_t& x, const unsigned& k) {
+    return (x << k) | (x >> (32U - k));
+}
+
+} // namespace
+
+LockstepReplicaEngine::LockstepReplicaEngine(const size_t& convCap, const size_t& assemblyDuration,
+                                             const optional<uint64_t>& seed) :
+        convCap(convCap),
+        assemblyDuration(static_cast<uint32_t>(assemblyDuration)),
+        belt(convCap, LaneVector{}),
+        topFlags(convCap, LaneVector{}),
+        topCountdowns(convCap, LaneVector{}),
+        bottomFlags(convCap, LaneVector{}),
+        bottomCountdowns(convCap, LaneVector{})
+{
+    if (!convCap) {
+        throw invalid_argument(string(__func__) + ": attempt to construct a zero capacity configuration");
+    }
+    if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+    }
+
+    // Every state word of every lane gets its own seed derived from the stream seed
+    const uint64_t streamSeed = seed.has_value() ? deriveSeed(seed.value(), RandomStream::ReplicaLanes)
+                                                 : random_device()();
+    for (size_t word = 0; word < rngState.size(); word++) {
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            rngState[word][lane] = deriveSeed((streamSeed << 32U) | (lane * rngState.size() + word),
+                                              RandomStream::ReplicaLanes);
+        }
+    }
+}
+
+void LockstepReplicaEngine::run(const size_t& numSlots) {
+    auto& [s0, s1, s2, s3] = rngState;
+    for (size_t slot = 0; slot < numSlots; slot++) {
+        // Two xoshiro128+ draws per lane, each mapped to one of three equally likely outcomes
+        // from its upper bits: the generated item (none, 'A' or 'B'), and the priority draw,
+        // which gives the top workers priority one time out of three
+        LaneVector draws[2];
+        for (auto& draw: draws) {
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                const uint32_t result = s0[lane] + s3[lane];
+                const uint32_t t = s1[lane] << 9U;
+                s2[lane] ^= s0[lane];
+                s3[lane] ^= s1[lane];
+                s1[lane] ^= s2[lane];
+                s0[lane] ^= s3[lane];
+                s2[lane] ^= t;
+                s3[lane] = rotl(s3[lane], 11U);
+                draw[lane] = static_cast<uint32_t>((static_cast<uint64_t>(result) * 3) >> 32U);
+            }
+        }
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            draws[1][lane] = draws[1][lane] == 1;
+        }
+        step(draws[0], draws[1]);
+    }
+}
+
+void LockstepReplicaEngine::step(const array<PackedItem, Lanes>& generated, const array<bool, Lanes>& topFirst) {
+    LaneVector items;
+    LaneVector priorities;
+    for (size_t lane = 0; lane < Lanes; lane++) {
+        items[lane] = static_cast<uint32_t>(generated[lane]);
+        priorities[lane] = topFirst[lane];
+    }
+    step(items, priorities);
+}
+
+void LockstepReplicaEngine::step(const LaneVector& generated, const LaneVector& topFirst) {
+    // The last position becomes the first one; its items leave the belts
+    head = head ? head - 1 : convCap - 1;
+    LaneVector& first = belt[head];
+    for (size_t lane = 0; lane < Lanes; lane++) {
+        productCounts[lane] += first[lane] == itemP;
+        dropCounts[lane] += isComponent(first[lane]);
+        first[lane] = generated[lane];
+    }
+
+    // Logical position pos lives at physical index head + pos, wrapping around once. The
+    // workers acting first and second are selected per lane, so that all lanes run the same
+    // code. The lanes are worked on in local copies, which the compiler knows do not alias.
+    const uint32_t duration = assemblyDuration;
+    size_t pos = 0;
+    for (const auto& [begin, end]: {make_pair(head, convCap), make_pair(size_t(0), head)}) {
+        for (size_t idx = begin; idx < end; idx++, pos++) {
+            LaneVector cells = belt[idx];
+            LaneVector tf = topFlags[pos];
+            LaneVector tc = topCountdowns[pos];
+            LaneVector bf = bottomFlags[pos];
+            LaneVector bc = bottomCountdowns[pos];
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                const uint32_t top = -topFirst[lane];
+                uint32_t reserved = 0;
+                uint32_t firstFlags = select(top, tf[lane], bf[lane]);
+                uint32_t firstCountdown = select(top, tc[lane], bc[lane]);
+                uint32_t secondFlags = select(top, bf[lane], tf[lane]);
+                uint32_t secondCountdown = select(top, bc[lane], tc[lane]);
+                stepLane(cells[lane], reserved, firstFlags, firstCountdown, duration);
+                stepLane(cells[lane], reserved, secondFlags, secondCountdown, duration);
+                tf[lane] = select(top, firstFlags, secondFlags);
+                tc[lane] = select(top, firstCountdown, secondCountdown);
+                bf[lane] = select(top, secondFlags, firstFlags);
+                bc[lane] = select(top, secondCountdown, firstCountdown);
+            }
+            belt[idx] = cells;
+            topFlags[pos] = tf;
+            topCountdowns[pos] = tc;
+            bottomFlags[pos] = bf;
+            bottomCountdowns[pos] = bc;
+        }
+    }
+}
+
+size_t LockstepReplicaEngine::physical(const size_t& pos) const {
+    const size_t idx = head + pos;
+    return idx < convCap ? idx : idx - convCap;
+}
+
+size_t LockstepReplicaEngine::getProductCount(const size_t& lane) const {
+    return productCounts.at(lane);
+}
+
+size_t LockstepReplicaEngine::getDropCount(const size_t& lane) const {
+    return dropCounts.at(lane);
+}
+
+PackedItem LockstepReplicaEngine::peekItem(const size_t& lane, const size_t& pos) const {
+    return static_cast<PackedItem>(belt.at(physical(pos)).at(lane));
+}
+
+PackedWorker LockstepReplicaEngine::getTopWorker(const size_t& lane, const size_t& pos) const {
+    PackedWorker worker;
+    worker.countdown = topCountdowns.at(pos).at(lane);
+    worker.flags = static_cast<uint8_t>(topFlags.at(pos).at(lane));
+    return worker;
+}
+
+PackedWorker LockstepReplicaEngine::getBottomWorker(const size_t& lane, const size_t& pos) const {
+    PackedWorker worker;
+    worker.countdown = bottomCountdowns.at(pos).at(lane);
+    worker.flags = static_cast<uint8_t>(bottomFlags.at(pos).at(lane));
+    return worker;
+}
+
+size_t LockstepReplicaEngine::getCapacity() const {
+    return convCap;
+}
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include "LogHistogram.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+size_t LogHistogram::bucketOf(const uint64_t& value) {
+    if (value < SubBucketCount) {
+        return value;
+    }
+    const unsigned msb = 63 - __builtin_clzll(value);
+    const unsigned shift = msb - SubBucketBits;
+    return SubBucketCount + shift * SubBucketCount + ((value >> shift) - SubBucketCount);
+}
+
+uint64_t LogHistogram::bucketLowerBound(const size_t& bucket) {
+    if (bucket < SubBucketCount) {
+        return bucket;
+    }
+    const size_t shift = (bucket - SubBucketCount) / SubBucketCount;
+    const uint64_t sub = (bucket - SubBucketCount) % SubBucketCount;
+    return (SubBucketCount + sub) << shift;
+}
+
+uint64_t LogHistogram::bucketUpperBound(const size_t& bucket) {
+    if (bucket < SubBucketCount) {
+        return bucket;
+    }
+    const size_t shift = (bucket - SubBucketCount) / SubBucketCount;
+    return bucketLowerBound(bucket) + ((uint64_t(1) << shift) - 1);
+}
+
+void LogHistogram::record(const uint64_t& value) {
+    counts[bucketOf(value)]++;
+    count++;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void LogHistogram::merge(const LogHistogram& other) {
+    for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+        counts[bucket] += other.counts[bucket];
+    }
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+uint64_t LogHistogram::getCount() const {
+    return count;
+}
+
+uint64_t LogHistogram::getMin() const {
+    return count ? min : 0;
+}
+
+uint64_t LogHistogram::getMax() const {
+    return max;
+}
+
+double LogHistogram::getMean() const {
+    return count ? static_cast<double>(sum) / count : 0;
+}
+
+uint64_t LogHistogram::getPercentile(const double& fraction) const {
+    if (!count) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(clamp(fraction, 0.0, 1.0) * count)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(bucket), max);
+        }
+    }
+    return max;
+}
+
+namespace conveyorsim {
+
+ostream& operator<<(ostream& os, const LogHistogram& obj) {
+    os << "count: " << obj.getCount();
+    if (obj.getCount()) {
+        os << ", mean: " << obj.getMean()
+           << ", min: " << obj.getMin()
+           << ", p50: " << obj.getPercentile(0.5)
+           << ", p90: " << obj.getPercentile(0.9)
+           << ", p99: " << obj.getPercentile(0.99)
+           << ", max: " << obj.getMax();
+    }
+    return os;
+}
+
+} // conveyorsim
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "PackedABState.h"
+#include "MarkovChainSolver.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// The draws of a timeslot: every generated item is equally likely, and the top workers get
+// priority on one out of three equally likely priority draws (see ABConveyorConfiguration::run)
+struct Draw {
+    PackedItem generated;
+    bool topFirst;
+    double probability;
+};
+
+const Draw draws[] = {
+        {PackedItem::Empty, true, 1.0 / 9}, {PackedItem::Empty, false, 2.0 / 9},
+        {PackedItem::A,     true, 1.0 / 9}, {PackedItem::A,     false, 2.0 / 9},
+        {PackedItem::B,     true, 1.0 / 9}, {PackedItem::B,     false, 2.0 / 9},
+};
+
+/// A sparse matrix in compressed row storage
+struct SparseMatrix {
+    vector<size_t> rowStart;
+    vector<uint32_t> column;
+    vector<double> value;
+};
+
+} // namespace
+
+MarkovChainSolver::MarkovChainSolver(const size_t& convCap, const size_t& assemblyDuration,
+                                     const size_t& maxStates) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        maxStates(maxStates)
+{ }
+
+optional<MarkovChainSolver::Result> MarkovChainSolver::solve(const double& tolerance,
+                                                               const size_t& maxIterations) const {
+    // Breadth first enumeration of the states reachable from the empty belt. States are
+    // numbered in discovery order, which is also the order they are expanded in.
+    PackedABState state(convCap, assemblyDuration);
+    vector<string> keys{state.encode()};
+    unordered_map<string, uint32_t> index{{keys.front(), 0}};
+    vector<PackedItem> lastItem;
+    vector<tuple<uint32_t, uint32_t, double>> transitions;
+
+    for (size_t from = 0; from < keys.size(); from++) {
+        state.decode(keys[from]);
+        lastItem.push_back(state.peekItem(convCap - 1));
+        for (const auto& draw: draws) {
+            PackedABState next = state;
+            static_cast<void>(next.step(draw.generated, draw.topFirst));
+            auto [it, inserted] = index.try_emplace(next.encode(), static_cast<uint32_t>(keys.size()));
+            if (inserted) {
+                if (keys.size() == maxStates) {
+                    return nullopt;
+                }
+                keys.push_back(it->first);
+            }
+            transitions.emplace_back(static_cast<uint32_t>(from), it->second, draw.probability);
+        }
+    }
+    const size_t numStates = keys.size();
+    keys.clear();
+    index.clear();
+
+    // Gauss-Seidel needs the incoming transitions of every state: transpose into rows by target
+    SparseMatrix incoming;
+    incoming.rowStart.assign(numStates + 1, 0);
+    for (const auto& [from, to, p]: transitions) {
+        incoming.rowStart[to + 1]++;
+    }
+    for (size_t row = 0; row < numStates; row++) {
+        incoming.rowStart[row + 1] += incoming.rowStart[row];
+    }
+    incoming.column.resize(transitions.size());
+    incoming.value.resize(transitions.size());
+    vector<size_t> fill(incoming.rowStart.begin(), incoming.rowStart.end() - 1);
+    for (const auto& [from, to, p]: transitions) {
+        incoming.column[fill[to]] = from;
+        incoming.value[fill[to]] = p;
+        fill[to]++;
+    }
+    transitions.clear();
+    transitions.shrink_to_fit();
+
+    // Solve pi = pi * P with sum(pi) = 1
+    vector<double> pi(numStates, 1.0 / numStates);
+    size_t iterations = 0;
+    for (double change = INFINITY; change > tolerance && iterations < maxIterations; iterations++) {
+        change = 0;
+        for (size_t to = 0; to < numStates; to++) {
+            double inflow = 0;
+            double selfLoop = 0;
+            for (size_t entry = incoming.rowStart[to]; entry < incoming.rowStart[to + 1]; entry++) {
+                if (incoming.column[entry] == to) {
+                    selfLoop += incoming.value[entry];
+                } else {
+                    inflow += pi[incoming.column[entry]] * incoming.value[entry];
+                }
+            }
+            const double updated = inflow / (1 - selfLoop);
+            change += fabs(updated - pi[to]);
+            pi[to] = updated;
+        }
+        double total = 0;
+        for (const auto& p: pi) {
+            total += p;
+        }
+        for (auto& p: pi) {
+            p /= total;
+        }
+    }
+
+    Result result{numStates, iterations, 0, 0, 0};
+    for (size_t to = 0; to < numStates; to++) {
+        double inflow = 0;
+        for (size_t entry = incoming.rowStart[to]; entry < incoming.rowStart[to + 1]; entry++) {
+            inflow += pi[incoming.column[entry]] * incoming.value[entry];
+        }
+        result.residual += fabs(inflow - pi[to]);
+        if (lastItem[to] == PackedItem::P) {
+            result.productRate += pi[to];
+        } else if (lastItem[to] != PackedItem::Empty) {
+            result.dropRate += pi[to];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,366 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "ABConveyorConfiguration.h"
+#include "PackedABState.h"
+#include "MeanFieldApproximation.h"
+#include "TimeWarpEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Probability of a position holding nothing, an 'A', a 'B' or a 'P', indexed by PackedItem
+using Occupancy = array<double, 4>;
+
+// Probability of what a worker sees when it acts: the item on the position and whether the
+// position is reserved, indexed by 2 * item + reserved
+using Input = array<double, 8>;
+
+// The six idle states of a worker between timeslots, followed by the assembly
+constexpr size_t NumIdle = 6;
+constexpr size_t AssemblyState = NumIdle;
+constexpr size_t NumStates = NumIdle + 1;
+const uint8_t idleFlags[NumIdle] = {
+        0,
+        PackedWorker::HoldsA,
+        PackedWorker::HoldsB,
+        PackedWorker::HoldsP,
+        PackedWorker::HoldsA | PackedWorker::HoldsP,
+        PackedWorker::HoldsB | PackedWorker::HoldsP,
+};
+
+// What a worker does in a timeslot: the idle states, the last timeslot of an assembly, and
+// the other timeslots of an assembly in which the worker does not touch the belt
+constexpr size_t FinishingClass = NumIdle;
+constexpr size_t AssemblingClass = NumIdle + 1;
+using Behaviour = array<double, NumIdle + 2>;
+
+size_t stateOf(const PackedWorker& worker) {
+    if (worker.flags & PackedWorker::Busy) {
+        return AssemblyState;
+    }
+    for (size_t state = 0; state < NumIdle; state++) {
+        if (idleFlags[state] == worker.flags) {
+            return state;
+        }
+    }
+    throw logic_error(string(__func__) + ": unexpected worker state");
+}
+
+double distance(const double* a, const double* b, const size_t& n) {
+    double sum = 0;
+    for (size_t idx = 0; idx < n; idx++) {
+        sum += fabs(a[idx] - b[idx]);
+    }
+    return sum;
+}
+
+/// The mean-field model of a single worker: its transitions for every input, tabulated once
+/// with PackedWorker::step, and the solution of its stationary distribution for a given input.
+class WorkerModel {
+public:
+    explicit WorkerModel(const uint32_t& assemblyDuration) : assemblyDuration(assemblyDuration) {
+        for (size_t state = 0; state < NumStates; state++) {
+            for (size_t input = 0; input < tuple_size<Input>::value; input++) {
+                PackedWorker worker;
+                if (state == AssemblyState) {
+                    // the last timeslot of the assembly
+                    worker.flags = PackedWorker::HoldsA | PackedWorker::HoldsB | PackedWorker::Busy;
+                    worker.countdown = 1;
+                } else {
+                    worker.flags = idleFlags[state];
+                }
+                auto item = static_cast<PackedItem>(input / 2);
+                bool reserved = input % 2;
+                worker.step(item, reserved, assemblyDuration);
+                next[state][input] = stateOf(worker);
+                output[state][input] = 2 * static_cast<size_t>(item) + reserved;
+            }
+        }
+    }
+
+    /// Returns how likely the worker is to be in every behaviour in a timeslot, when it sees
+    /// independent inputs distributed like *input*. *embedded* is the stationary distribution
+    /// of the embedded jump chain; it is used as the starting point and updated.
+    Behaviour behaviour(const Input& input, array<double, NumStates>& embedded) const {
+        array<array<double, NumStates>, NumStates> jump{};
+        for (size_t state = 0; state < NumStates; state++) {
+            for (size_t in = 0; in < input.size(); in++) {
+                jump[state][next[state][in]] += input[in];
+            }
+        }
+        solveStationary(jump, embedded);
+
+        // Every idle state lasts a timeslot; the assembly lasts assemblyDuration timeslots
+        Behaviour result{};
+        double total = 0;
+        for (size_t state = 0; state < NumIdle; state++) {
+            result[state] = embedded[state];
+            total += embedded[state];
+        }
+        const double assembling = assemblyDuration ? embedded[AssemblyState] * assemblyDuration : 0;
+        total += assembling;
+        for (size_t state = 0; state < NumIdle; state++) {
+            result[state] /= total;
+        }
+        if (assemblyDuration) {
+            result[FinishingClass] = assembling / total / assemblyDuration;
+            result[AssemblingClass] = assembling / total - result[FinishingClass];
+        }
+        return result;
+    }
+
+    /// Returns what the next worker sees after a worker with *behaviour* acted on *input*
+    Input apply(const Behaviour& behaviour, const Input& input) const {
+        Input result{};
+        for (size_t in = 0; in < input.size(); in++) {
+            for (size_t state = 0; state < NumStates; state++) {
+                result[output[state][in]] += behaviour[state] * input[in];
+            }
+            result[in] += behaviour[AssemblingClass] * input[in];
+        }
+        return result;
+    }
+
+private:
+    /// Solves embedded * jump = embedded directly; falls back to lazy power iteration from the
+    /// given starting point when the chain is reducible and the system is singular.
+    static void solveStationary(const array<array<double, NumStates>, NumStates>& jump,
+                                array<double, NumStates>& embedded) {
+        // Rows of (jump^T - I), with the last equation replaced by the normalization
+        array<array<double, NumStates + 1>, NumStates> system{};
+        for (size_t row = 0; row < NumStates; row++) {
+            for (size_t col = 0; col < NumStates; col++) {
+                system[row][col] = row == NumStates - 1 ? 1 : jump[col][row] - (row == col ? 1 : 0);
+            }
+            system[row][NumStates] = row == NumStates - 1 ? 1 : 0;
+        }
+        bool singular = false;
+        for (size_t col = 0; col < NumStates && !singular; col++) {
+            size_t pivot = col;
+            for (size_t row = col + 1; row < NumStates; row++) {
+                if (fabs(system[row][col]) > fabs(system[pivot][col])) {
+                    pivot = row;
+                }
+            }
+            if (fabs(system[pivot][col]) < 1e-12) {
+                singular = true;
+                break;
+            }
+            swap(system[col], system[pivot]);
+            for (size_t row = 0; row < NumStates; row++) {
+                if (row != col) {
+                    const double factor = system[row][col] / system[col][col];
+                    for (size_t k = col; k <= NumStates; k++) {
+                        system[row][k] -= factor * system[col][k];
+                    }
+                }
+            }
+        }
+        if (!singular) {
+            for (size_t state = 0; state < NumStates; state++) {
+                embedded[state] = max(0.0, system[state][NumStates] / system[state][state]);
+            }
+            return;
+        }
+        for (size_t iteration = 0; iteration < 100000; iteration++) {
+            array<double, NumStates> updated{};
+            for (size_t from = 0; from < NumStates; from++) {
+                for (size_t to = 0; to < NumStates; to++) {
+                    updated[to] += 0.5 * embedded[from] * jump[from][to];
+                }
+                updated[from] += 0.5 * embedded[from];
+            }
+            const double change = distance(updated.data(), embedded.data(), NumStates);
+            embedded = updated;
+            if (change < 1e-15) {
+                break;
+            }
+        }
+    }
+
+    const uint32_t assemblyDuration;
+    size_t next[NumStates][tuple_size<Input>::value]{};
+    size_t output[NumStates][tuple_size<Input>::value]{};
+};
+
+/// The density evolution over one belt position. The stationary distributions of the top and
+/// bottom workers are kept between positions, as neighbouring positions have similar ones.
+class PositionModel {
+public:
+    explicit PositionModel(const uint32_t& assemblyDuration) : worker(assemblyDuration) {
+        topEmbedded.fill(0);
+        topEmbedded[0] = 1;
+        bottomEmbedded = topEmbedded;
+    }
+
+    /// Returns the occupancy of the position after both workers acted on an item drawn from
+    /// *occupancy*
+    Occupancy evolve(const Occupancy& occupancy) {
+        Input fresh{};
+        for (size_t item = 0; item < occupancy.size(); item++) {
+            fresh[2 * item] = occupancy[item];
+        }
+
+        // The top workers act first with probability 1/3, the bottom workers with probability 2/3
+        Input topInput = fresh;
+        Input bottomInput = fresh;
+        Behaviour top{};
+        Behaviour bottom{};
+        for (size_t iteration = 0; iteration < 200; iteration++) {
+            top = worker.behaviour(topInput, topEmbedded);
+            bottom = worker.behaviour(bottomInput, bottomEmbedded);
+            const Input afterBottom = worker.apply(bottom, fresh);
+            const Input afterTop = worker.apply(top, fresh);
+            Input nextTop{};
+            Input nextBottom{};
+            for (size_t in = 0; in < fresh.size(); in++) {
+                nextTop[in] = fresh[in] / 3 + 2 * afterBottom[in] / 3;
+                nextBottom[in] = 2 * fresh[in] / 3 + afterTop[in] / 3;
+            }
+            const double change = distance(nextTop.data(), topInput.data(), fresh.size())
+                                  + distance(nextBottom.data(), bottomInput.data(), fresh.size());
+            topInput = nextTop;
+            bottomInput = nextBottom;
+            if (change < 1e-13) {
+                break;
+            }
+        }
+
+        const Input topFirst = worker.apply(bottom, worker.apply(top, fresh));
+        const Input bottomFirst = worker.apply(top, worker.apply(bottom, fresh));
+        Occupancy result{};
+        double total = 0;
+        for (size_t in = 0; in < fresh.size(); in++) {
+            result[in / 2] += topFirst[in] / 3 + 2 * bottomFirst[in] / 3;
+            total += topFirst[in] / 3 + 2 * bottomFirst[in] / 3;
+        }
+        for (auto& p: result) {
+            p /= total;
+        }
+        return result;
+    }
+
+private:
+    const WorkerModel worker;
+    array<double, NumStates> topEmbedded{};
+    array<double, NumStates> bottomEmbedded{};
+};
+
+// Ratio of the changes of consecutive positions above which the recurrence is considered to
+// converge too slowly to be evaluated position by position
+constexpr double slowContraction = 0.9;
+
+Occupancy advance(const Occupancy& occupancy, const Occupancy& drift, const double& positions) {
+    Occupancy result{};
+    double total = 0;
+    for (size_t item = 0; item < occupancy.size(); item++) {
+        result[item] = max(0.0, occupancy[item] + positions * drift[item]);
+        total += result[item];
+    }
+    for (auto& p: result) {
+        p /= total;
+    }
+    return result;
+}
+
+Occupancy driftOf(PositionModel& model, const Occupancy& occupancy) {
+    const Occupancy next = model.evolve(occupancy);
+    Occupancy drift{};
+    for (size_t item = 0; item < occupancy.size(); item++) {
+        drift[item] = next[item] - occupancy[item];
+    }
+    return drift;
+}
+
+} // namespace
+
+MeanFieldApproximation::MeanFieldApproximation(const size_t& convCap, const size_t& assemblyDuration) :
+        convCap(convCap),
+        assemblyDuration(static_cast<uint32_t>(assemblyDuration))
+{
+    if (!convCap) {
+        throw invalid_argument(string(__func__) + ": attempt to approximate a zero capacity configuration");
+    }
+    if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+    }
+}
+
+MeanFieldApproximation::Result MeanFieldApproximation::solve(const double& fluidThreshold,
+                                                             const double& stepTolerance) const {
+    PositionModel model(assemblyDuration);
+    Occupancy occupancy{1.0 / 3, 1.0 / 3, 1.0 / 3, 0};
+    Result result{0, 0, 0, 0};
+
+    size_t pos = 0;
+    double previousChange = INFINITY;
+    while (pos < convCap) {
+        const Occupancy drift = driftOf(model, occupancy);
+        const Occupancy none{};
+        const double change = distance(drift.data(), none.data(), drift.size());
+        if (change < numeric_limits<double>::epsilon()) {
+            // a fixed point: every remaining position is the same
+            break;
+        }
+        // While the change shrinks geometrically, the fixed point is only a few positions away
+        // and evaluating them is both cheaper and exact. Fluid steps never more than double the
+        // number of positions covered so far, and never change the occupancy by more than
+        // stepTolerance.
+        const bool slow = change > slowContraction * previousChange;
+        previousChange = change;
+        const double steps = min<double>({static_cast<double>(convCap - pos),
+                                          floor(stepTolerance / change),
+                                          static_cast<double>(max<size_t>(pos, 1))});
+        if (change > fluidThreshold || !slow || steps < 2) {
+            occupancy = advance(occupancy, drift, 1);
+            pos++;
+            result.exactPositions++;
+            continue;
+        }
+        const Occupancy predicted = advance(occupancy, drift, steps);
+        const Occupancy predictedDrift = driftOf(model, predicted);
+        Occupancy averageDrift{};
+        for (size_t item = 0; item < occupancy.size(); item++) {
+            averageDrift[item] = (drift[item] + predictedDrift[item]) / 2;
+        }
+        occupancy = advance(occupancy, averageDrift, steps);
+        pos += static_cast<size_t>(steps);
+        result.fluidSteps++;
+    }
+
+    result.productRate = occupancy[static_cast<size_t>(PackedItem::P)];
+    result.dropRate = occupancy[static_cast<size_t>(PackedItem::A)] + occupancy[static_cast<size_t>(PackedItem::B)];
+    return result;
+}
+
+vector<MeanFieldApproximation::ValidationPoint> MeanFieldApproximation::validate(const size_t& numSlots,
+                                                                                 const uint64_t& seed) {
+    // The grid starts at MinCapacity, as shorter belts are not approximated, and reaches towards
+    // the long belts the approximation is for as far as simulating them stays affordable. The
+    // packed engine reproduces a seeded ABConveyorConfiguration several times faster, and the
+    // rates are measured once the first items have made it through the belt.
+    TimeWarpEngine::Settings settings;
+    settings.optimistic = false;
+    vector<ValidationPoint> points;
+    for (const size_t capacity: {MinCapacity, 10 * MinCapacity, 100 * MinCapacity}) {
+        for (const size_t duration: {0, 1, 4, 16}) {
+            const TimeWarpEngine engine(capacity, duration, 1, seed, settings);
+            const auto filled = engine.run(capacity);
+            const auto full = engine.run(capacity + numSlots);
+            points.push_back({capacity, duration, MeanFieldApproximation(capacity, duration).solve(),
+                              static_cast<double>(full.productCount - filled.productCount) / numSlots,
+                              static_cast<double>(full.dropCount - filled.dropCount) / numSlots});
+        }
+    }
+    return points;
+}
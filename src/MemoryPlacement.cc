@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "MemoryPlacement.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Allocations are rare, so the settings and the log are simply locked
+mutex placementMutex;
+MemoryPlacementSettings placementSettings;
+
+void log(const string& message) {
+    lock_guard<mutex> lock(placementMutex);
+    if (placementSettings.log) {
+        *placementSettings.log << "placement: " << message << endl;
+    }
+}
+
+size_t roundUp(const size_t& bytes) {
+    return (bytes + MemoryPlacement::HugePageSize - 1) / MemoryPlacement::HugePageSize * MemoryPlacement::HugePageSize;
+}
+
+string describe(const size_t& bytes) {
+    ostringstream description;
+    description.precision(1);
+    description << fixed << static_cast<double>(bytes) / (1U << 20U) << " MiB";
+    return description.str();
+}
+
+// Maps memory aligned to a huge page, trimming what mapping more than asked for takes to align it
+void* mapAligned(const size_t& length) {
+    void* const mapped = mmap(nullptr, length + MemoryPlacement::HugePageSize, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw bad_alloc();
+    }
+    const auto address = reinterpret_cast<uintptr_t>(mapped);
+    const uintptr_t aligned = roundUp(address);
+    if (aligned > address) {
+        munmap(mapped, aligned - address);
+    }
+    munmap(reinterpret_cast<void*>(aligned + length), address + MemoryPlacement::HugePageSize - aligned);
+    return reinterpret_cast<void*>(aligned);
+}
+
+} // namespace
+
+void MemoryPlacement::configure(const MemoryPlacementSettings& settings) {
+    lock_guard<mutex> lock(placementMutex);
+    placementSettings = settings;
+}
+
+MemoryPlacementSettings MemoryPlacement::getSettings() {
+    lock_guard<mutex> lock(placementMutex);
+    return placementSettings;
+}
+
+void* MemoryPlacement::allocate(const size_t& bytes) {
+    if (bytes < HugePageSize) {
+        return ::operator new(bytes);
+    }
+    const size_t length = roundUp(bytes);
+    if (!getSettings().hugePages) {
+        log(describe(length) + " on regular pages, huge pages are off");
+        return mapAligned(length);
+    }
+    void* const memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                              -1, 0);
+    if (memory != MAP_FAILED) {
+        log(describe(length) + " on explicit huge pages");
+        return memory;
+    }
+    const string hugetlbError = strerror(errno);
+    void* const aligned = mapAligned(length);
+    if (madvise(aligned, length, MADV_HUGEPAGE)) {
+        log(describe(length) + " on regular pages; no explicit huge pages (" + hugetlbError
+            + ") and no transparent huge pages (" + strerror(errno) + ")");
+    } else {
+        log(describe(length) + " on transparent huge pages; no explicit huge pages (" + hugetlbError + ")");
+    }
+    return aligned;
+}
+
+void MemoryPlacement::deallocate(void* memory, const size_t& bytes) {
+    if (bytes < HugePageSize) {
+        ::operator delete(memory);
+        return;
+    }
+    munmap(memory, roundUp(bytes));
+}
+
+void MemoryPlacement::placeThread(const size_t& idx, const string& name) {
+    if (getSettings().pinThreads) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+            log("cannot pin " + name + ": " + strerror(errno));
+        } else {
+            // The idx-th allowed CPU, wrapping around
+            size_t remaining = idx % static_cast<size_t>(CPU_COUNT(&allowed));
+            int cpu = 0;
+            for (; !CPU_ISSET(cpu, &allowed) || remaining; cpu++) {
+                remaining -= CPU_ISSET(cpu, &allowed) ? 1 : 0;
+            }
+            cpu_set_t pinned;
+            CPU_ZERO(&pinned);
+            CPU_SET(cpu, &pinned);
+            const int error = pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+            if (error) {
+                log("cannot pin " + name + " to CPU " + to_string(cpu) + ": " + strerror(error));
+            } else {
+                log(name + " pinned to CPU " + to_string(cpu));
+            }
+        }
+    }
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (!syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        log(name + " runs on CPU " + to_string(cpu) + ", NUMA node " + to_string(node));
+    }
+}
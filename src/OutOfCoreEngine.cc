@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <future>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+#include "OutOfCoreEngine.h"
+#include "PackedABState.h"
+#include "Seeding.h"
+#include "TraceRecorder.h"
+#include "UniformRandomItemGenerator.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+class OutOfCoreEngine::impl {
+public:
+    impl(const size_t& convCap, const size_t& assemblyDuration, const uint64_t& seed, const string& path,
+         const Settings& settings) :
+            convCap(convCap),
+            assemblyDuration(assemblyDuration),
+            path(path),
+            settings(settings),
+            numSegments(settings.segmentPositions ? (convCap + settings.segmentPositions - 1) / settings.segmentPositions
+                                                  : 0),
+            generator({ItemPN('A'), ItemPN('B')}, true, deriveSeed(seed, RandomStream::ItemGeneration)),
+            rng(deriveSeed(seed, RandomStream::WorkerPriority)),
+            udst(0, 2)
+    {
+        if (!convCap || !settings.segmentPositions || !settings.chunkSlots) {
+            throw invalid_argument(string(__func__) + ": the capacity, the segment positions and the chunk timeslots "
+                                                      "must not be 0");
+        }
+        if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+            throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+        }
+        // The file is removed when the engine is done, so it must be one the engine created
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw system_error(errno, generic_category(), string(__func__) + ": cannot create " + path);
+        }
+        // All zero bytes are an empty belt with idle workers; the file stays sparse until written
+        if (ftruncate(fd, static_cast<off_t>(convCap * PackedABState::EncodedBytesPerPosition))) {
+            const int error = errno;
+            close(fd);
+            unlink(path.c_str());
+            throw system_error(error, generic_category(), string(__func__) + ": cannot size " + path);
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    ~impl() {
+        // Reads ahead must be done before the file goes away
+        if (reading.valid()) {
+            reading.wait();
+        }
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    // Runs every segment, in turn, for a chunk of timeslots
+    void runChunk(const size_t& numSlots) {
+        // The items arriving on the segment being run, replaced by the items leaving it as it runs
+        vector<PackedItem> boundary(numSlots);
+        vector<uint8_t> priorities(numSlots);
+        for (size_t slot = 0; slot < numSlots; slot++) {
+            const auto item = generator.get_next_item();
+            boundary[slot] = !item.has_value() ? PackedItem::Empty
+                             : item.value().getPN() == ItemPN('A') ? PackedItem::A : PackedItem::B;
+            priorities[slot] = udst(rng) % 2;
+        }
+
+        future<void> writing;
+        size_t writingIdx = 0;
+        if (!reading.valid()) {
+            readAhead(0);
+        }
+        for (size_t idx = 0; idx < numSegments; idx++) {
+            string bytes;
+            {
+                TraceScope trace(TracePhase::Wait, true);
+                bytes = reading.get();
+            }
+            result.bytesRead += bytes.size();
+            // The next segment is read while this one runs. The write behind of the previous
+            // segment may still be in flight, and with two segments that is the next one, so it
+            // must land first. With one segment, the next chunk reads it after the last write.
+            if (numSegments > 1) {
+                const size_t next = (idx + 1) % numSegments;
+                if (writing.valid() && writingIdx == next) {
+                    TraceScope trace(TracePhase::Wait, true);
+                    writing.get();
+                }
+                readAhead(next);
+            }
+
+            const size_t segmentCap = getSegmentCap(idx);
+            if (!state.has_value() || state->getCapacity() != segmentCap) {
+                state.emplace(segmentCap, assemblyDuration);
+            }
+            state->decode(bytes);
+            for (size_t slot = 0; slot < numSlots; slot++) {
+                boundary[slot] = state->step(boundary[slot], priorities[slot]);
+            }
+            bytes = state->encode();
+            result.bytesWritten += bytes.size();
+
+            if (writing.valid()) {
+                TraceScope trace(TracePhase::Wait, true);
+                writing.get();
+            }
+            writing = async(launch::async, [this, idx, bytes = move(bytes)] { writeSegment(idx, bytes); });
+            writingIdx = idx;
+        }
+        {
+            TraceScope trace(TracePhase::Wait, true);
+            writing.get();
+        }
+
+        for (const auto& exited: boundary) {
+            result.productCount += exited == PackedItem::P;
+            result.dropCount += exited == PackedItem::A || exited == PackedItem::B;
+        }
+        result.passes++;
+    }
+
+    const size_t convCap;
+    const size_t assemblyDuration;
+    const string path;
+    const Settings settings;
+    const size_t numSegments;
+    int fd = -1;
+    UniformRandomItemGenerator generator;
+    mt19937 rng;
+    uniform_int_distribution<size_t> udst;
+    Result result{};
+
+private:
+    [[nodiscard]] size_t getSegmentCap(const size_t& idx) const {
+        return min(settings.segmentPositions, convCap - idx * settings.segmentPositions);
+    }
+
+    [[nodiscard]] off_t getOffset(const size_t& idx) const {
+        return static_cast<off_t>(idx * settings.segmentPositions * PackedABState::EncodedBytesPerPosition);
+    }
+
+    void readAhead(const size_t& idx) {
+        reading = async(launch::async, [this, idx] { return readSegment(idx); });
+    }
+
+    [[nodiscard]] string readSegment(const size_t& idx) const {
+        string bytes(getSegmentCap(idx) * PackedABState::EncodedBytesPerPosition, '\0');
+        for (size_t done = 0; done < bytes.size();) {
+            const ssize_t count = pread(fd, bytes.data() + done, bytes.size() - done,
+                                        getOffset(idx) + static_cast<off_t>(done));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                throw system_error(count < 0 ? errno : EIO, generic_category(), string(__func__) + ": cannot read "
+                                                                                 + path);
+            }
+            done += count;
+        }
+        return bytes;
+    }
+
+    void writeSegment(const size_t& idx, const string& bytes) const {
+        for (size_t done = 0; done < bytes.size();) {
+            const ssize_t count = pwrite(fd, bytes.data() + done, bytes.size() - done,
+                                         getOffset(idx) + static_cast<off_t>(done));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                throw system_error(errno, generic_category(), string(__func__) + ": cannot write " + path);
+            }
+            done += count;
+        }
+    }
+
+    // The segment being read ahead, and the state of the segment being run
+    future<string> reading;
+    optional<PackedABState> state;
+};
+
+OutOfCoreEngine::OutOfCoreEngine(const size_t& convCap, const size_t& assemblyDuration, const uint64_t& seed,
+                                 const string& path, const Settings& settings) :
+        pImpl(make_unique<impl>(convCap, assemblyDuration, seed, path, settings))
+{ }
+
+OutOfCoreEngine::OutOfCoreEngine(const size_t& convCap, const size_t& assemblyDuration, const uint64_t& seed,
+                                 const string& path) :
+        OutOfCoreEngine(convCap, assemblyDuration, seed, path, Settings())
+{ }
+
+OutOfCoreEngine::~OutOfCoreEngine() = default;
+
+OutOfCoreEngine::Result OutOfCoreEngine::run(const size_t& numSlots) {
+    const auto start = chrono::steady_clock::now();
+    for (size_t slot = 0; slot < numSlots; slot += pImpl->settings.chunkSlots) {
+        pImpl->runChunk(min(pImpl->settings.chunkSlots, numSlots - slot));
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    pImpl->result.seconds += elapsed.count();
+    return pImpl->result;
+}
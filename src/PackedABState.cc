@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+#include <string>
+#include "PackedABState.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+bool PackedWorker::operator==(const PackedWorker& other) const {
+    return countdown == other.countdown && flags == other.flags;
+}
+
+PackedABState::PackedABState(const size_t& convCap, const size_t& assemblyDuration) :
+        assemblyDuration(static_cast<uint32_t>(assemblyDuration)),
+        belt(convCap, PackedItem::Empty),
+        topWorkers(convCap),
+        bottomWorkers(convCap)
+{
+    if (!convCap) {
+        throw invalid_argument(string(__func__) + ": attempt to construct a zero capacity configuration");
+    }
+    if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+    }
+}
+
+PackedItem PackedABState::step(const PackedItem& generated, const bool& topFirst) {
+    const size_t cap = belt.size();
+
+    // The last position becomes the first one; its item leaves the belt
+    head = head ? head - 1 : cap - 1;
+    const PackedItem exited = belt[head];
+    belt[head] = generated;
+
+    // Logical position pos lives at physical index head + pos, wrapping around once
+    size_t pos = 0;
+    for (const auto& [first, last]: {make_pair(head, cap), make_pair(size_t(0), head)}) {
+        for (size_t idx = first; idx < last; idx++, pos++) {
+            bool reserved = false;
+            if (topFirst) {
+                topWorkers[pos].step(belt[idx], reserved, assemblyDuration);
+                bottomWorkers[pos].step(belt[idx], reserved, assemblyDuration);
+            } else {
+                bottomWorkers[pos].step(belt[idx], reserved, assemblyDuration);
+                topWorkers[pos].step(belt[idx], reserved, assemblyDuration);
+            }
+        }
+    }
+    return exited;
+}
+
+size_t PackedABState::physical(const size_t& pos) const {
+    const size_t idx = head + pos;
+    return idx < belt.size() ? idx : idx - belt.size();
+}
+
+PackedItem PackedABState::peekItem(const size_t& pos) const {
+    return belt.at(physical(pos));
+}
+
+const PackedWorker& PackedABState::getTopWorker(const size_t& pos) const {
+    return topWorkers.at(pos);
+}
+
+const PackedWorker& PackedABState::getBottomWorker(const size_t& pos) const {
+    return bottomWorkers.at(pos);
+}
+
+size_t PackedABState::getCapacity() const {
+    return belt.size();
+}
+
+uint32_t PackedABState::getAssemblyDuration() const {
+    return assemblyDuration;
+}
+
+namespace {
+    void encodeWorker(char* out, const PackedWorker& worker) {
+        out[0] = static_cast<char>(worker.flags);
+        memcpy(out + 1, &worker.countdown, sizeof(worker.countdown));
+    }
+
+    void decodeWorker(const char* in, PackedWorker& worker) {
+        worker.flags = static_cast<uint8_t>(in[0]);
+        memcpy(&worker.countdown, in + 1, sizeof(worker.countdown));
+    }
+}
+
+string PackedABState::encode() const {
+    string key(belt.size() * EncodedBytesPerPosition, '\0');
+    for (size_t pos = 0; pos < belt.size(); pos++) {
+        char* out = key.data() + pos * EncodedBytesPerPosition;
+        out[0] = static_cast<char>(belt[physical(pos)]);
+        encodeWorker(out + 1, topWorkers[pos]);
+        encodeWorker(out + 1 + 1 + sizeof(uint32_t), bottomWorkers[pos]);
+    }
+    return key;
+}
+
+void PackedABState::decode(const string& key) {
+    if (key.size() != belt.size() * EncodedBytesPerPosition) {
+        throw invalid_argument(string(__func__) + ": serialized state does not match the capacity of the belt");
+    }
+    head = 0;
+    for (size_t pos = 0; pos < belt.size(); pos++) {
+        const char* in = key.data() + pos * EncodedBytesPerPosition;
+        belt[pos] = static_cast<PackedItem>(in[0]);
+        decodeWorker(in + 1, topWorkers[pos]);
+        decodeWorker(in + 1 + 1 + sizeof(uint32_t), bottomWorkers[pos]);
+    }
+}
+
+bool PackedABState::operator==(const PackedABState& other) const {
+    if (belt.size() != other.belt.size() || assemblyDuration != other.assemblyDuration
+        || topWorkers != other.topWorkers || bottomWorkers != other.bottomWorkers) {
+        return false;
+    }
+    for (size_t pos = 0; pos < belt.size(); pos++) {
+        if (peekItem(pos) != other.peekItem(pos)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <ostream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+#include "PerfCounters.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const Event HardwareEvents[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+const Event SoftwareEvents[] = {
+        {"task-clock [ns]", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {"cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+};
+
+// Opens a counter of the calling thread, stopped, in the group of *leader* or as a leader if
+// it is -1
+int openEvent(const Event& event, const int& leader) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = leader < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters(const bool& hardware) {
+    int error = 0;
+    if (hardware) {
+        // Events the CPU or the kernel does not provide are left out
+        for (const auto& event: HardwareEvents) {
+            const int fd = openEvent(event, fds.empty() ? -1 : fds.front());
+            if (fd < 0) {
+                error = errno;
+                continue;
+            }
+            fds.push_back(fd);
+            names.push_back(event.name);
+        }
+        this->hardware = !fds.empty();
+    }
+    if (fds.empty()) {
+        for (const auto& event: SoftwareEvents) {
+            const int fd = openEvent(event, fds.empty() ? -1 : fds.front());
+            if (fd < 0) {
+                error = errno;
+                continue;
+            }
+            fds.push_back(fd);
+            names.push_back(event.name);
+        }
+    }
+    if (fds.empty()) {
+        throw system_error(error, generic_category(), string(__func__) + ": cannot open performance counters");
+    }
+    ioctl(fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    // Members are closed before the leader
+    for (auto fd = fds.rbegin(); fd != fds.rend(); fd++) {
+        close(*fd);
+    }
+}
+
+bool PerfCounters::isHardware() const {
+    return hardware;
+}
+
+void PerfCounters::start() {
+    ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::stop() {
+    ioctl(fds.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+vector<PerfCounters::Value> PerfCounters::read() const {
+    // The group read format: the number of counters, the times the group was enabled and
+    // running, and the value of every counter
+    vector<uint64_t> buffer(3 + fds.size());
+    const ssize_t size = ::read(fds.front(), buffer.data(), buffer.size() * sizeof(uint64_t));
+    if (size < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot read performance counters");
+    }
+    const uint64_t enabled = buffer[1];
+    const uint64_t running = buffer[2];
+    vector<Value> values;
+    for (size_t idx = 0; idx < fds.size(); idx++) {
+        uint64_t value = buffer[3 + idx];
+        if (running && running < enabled) {
+            value = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+        }
+        values.push_back({names[idx], value});
+    }
+    return values;
+}
+
+void PerfCounters::report(ostream& os, const uint64_t& numSlots, const uint64_t& numUpdates) const {
+    const auto values = read();
+    os << "Counters: " << (hardware ? "hardware" : "software") << endl;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    for (const auto& value: values) {
+        os << value.name << ": " << value.value;
+        if (numSlots) {
+            os << ", " << static_cast<double>(value.value) / numSlots << " per timeslot";
+        }
+        if (numUpdates) {
+            os << ", " << static_cast<double>(value.value) / numUpdates << " per position update";
+        }
+        os << endl;
+        if (!strcmp(value.name, "cycles")) {
+            cycles = value.value;
+        } else if (!strcmp(value.name, "instructions")) {
+            instructions = value.value;
+        }
+    }
+    if (cycles && instructions) {
+        os << "Instructions per cycle: " << static_cast<double>(instructions) / cycles << endl;
+    }
+}
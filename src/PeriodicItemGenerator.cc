@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <ostream>
+#include <stdexcept>
+#include "PeriodicItemGenerator.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+PeriodicItemGenerator::PeriodicItemGenerator(const vector<optional<ItemPN>>& pattern) :
+        pattern(pattern)
+{
+    if (pattern.empty()) {
+        throw invalid_argument(string(__func__) + ": attempt to construct a generator with an empty pattern");
+    }
+}
+
+vector<optional<Item>> PeriodicItemGenerator::get_next_items(const size_t& quantity) const {
+    vector<optional<Item>> ret;
+    ret.reserve(quantity);
+    for (size_t idx = 0; idx < quantity; idx++) {
+        const auto& pn = pattern[phase];
+        ret.emplace_back(pn.has_value() ? optional(Item(pn.value())) : nullopt);
+        phase = phase + 1 == pattern.size() ? 0 : phase + 1;
+    }
+    return ret;
+}
+
+optional<Item> PeriodicItemGenerator::get_next_item() const {
+    return get_next_items(1)[0];
+}
+
+const vector<optional<ItemPN>>& PeriodicItemGenerator::getPattern() const {
+    return pattern;
+}
+
+size_t PeriodicItemGenerator::getPhase() const {
+    return phase;
+}
+
+void PeriodicItemGenerator::print(ostream& os) const {
+    os << "[ ";
+    for (const auto& pn: pattern) {
+        if (pn.has_value()) {
+            os << pn.value() << ", ";
+        } else {
+            os << "-, ";
+        }
+    }
+    os << " ]";
+}
+
+namespace conveyorsim {
+
+optional<vector<optional<ItemPN>>> parseItemPattern(const string& text) {
+    if (text.empty()) {
+        return nullopt;
+    }
+    vector<optional<ItemPN>> pattern;
+    for (const char& symbol: text) {
+        pattern.push_back(symbol == '-' ? nullopt : optional(ItemPN(static_cast<unsigned char>(symbol))));
+    }
+    return pattern;
+}
+
+} // conveyorsim
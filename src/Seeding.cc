@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include "Seeding.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace conveyorsim {
+
+uint64_t mixBits(const uint64_t& value) {
+    uint64_t z = value;
+    z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31U);
+}
+
+uint32_t deriveSeed(const uint64_t& masterSeed, const RandomStream& stream) {
+    const uint64_t z = mixBits(masterSeed + (static_cast<uint64_t>(stream) + 1) * 0x9e3779b97f4a7c15ULL);
+    return static_cast<uint32_t>(z ^ (z >> 32U));
+}
+
+} // conveyorsim
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "BeltShard.h"
+#include "ChunkedRunner.h"
+#include "MemoryPlacement.h"
+#include "ShmSpscChannel.h"
+#include "ShardLauncher.h"
+#include "TraceRecorder.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Written by a shard process before it exits successfully
+struct ShardCounts {
+    uint64_t productCount;
+    uint64_t dropCount;
+};
+
+// Shared by the launcher and all shard processes
+struct ShardControl {
+    // Set by the launcher when a stop was requested
+    atomic<bool> stop{false};
+    // The timeslots every shard runs, lowered by the first shard on a stop
+    atomic<uint64_t> endSlot;
+};
+
+void killAll(const vector<pid_t>& pids) {
+    for (const auto& pid: pids) {
+        kill(pid, SIGKILL);
+    }
+    for (const auto& pid: pids) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+} // namespace
+
+ShardLauncher::ShardLauncher(const size_t& convCap, const size_t& assemblyDuration, const size_t& numShards,
+                             const uint64_t& seed, const size_t& channelCapacity) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        numShards(numShards),
+        seed(seed),
+        channelCapacity(channelCapacity)
+{
+    if (!numShards || numShards > convCap) {
+        throw invalid_argument(string(__func__) + ": every shard needs at least one belt position");
+    }
+    if (!channelCapacity) {
+        throw invalid_argument(string(__func__) + ": attempt to connect shards with zero capacity channels");
+    }
+}
+
+ShardLauncher::Result ShardLauncher::run(const size_t& numSlots) const {
+    vector<unique_ptr<ShmSpscChannel>> channels;
+    for (size_t shard = 0; shard + 1 < numShards; shard++) {
+        channels.push_back(make_unique<ShmSpscChannel>(channelCapacity));
+    }
+
+    static_assert(atomic<uint64_t>::is_always_lock_free, "the end of the run is shared between processes, which needs lock free atomics");
+    const size_t countsBytes = sizeof(ShardControl) + numShards * sizeof(ShardCounts);
+    void* const memory = mmap(nullptr, countsBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot map the shard counts");
+    }
+    const unique_ptr<void, function<void(void*)>> countsMapping(memory, [&](void* mapped) {
+        munmap(mapped, countsBytes);
+    });
+    auto* const control = new(memory) ShardControl;
+    control->endSlot = numSlots;
+    auto* const counts = reinterpret_cast<ShardCounts*>(control + 1);
+
+    vector<pid_t> pids;
+    for (size_t shard = 0; shard < numShards; shard++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            const int error = errno;
+            killAll(pids);
+            throw system_error(error, generic_category(), string(__func__) + ": cannot fork shard " + to_string(shard));
+        }
+        if (!pid) {
+            // The shard process only allocates its own segment, which it is the first to touch, and
+            // never returns to the caller
+            try {
+                TraceRecorder::restartAfterFork("shard " + to_string(shard));
+                MemoryPlacement::placeThread(shard, "shard " + to_string(shard));
+                const size_t begin = shard * convCap / numShards;
+                const size_t end = (shard + 1) * convCap / numShards;
+                BeltShard segment(end - begin, assemblyDuration, seed,
+                                  shard ? channels[shard - 1].get() : nullptr,
+                                  shard + 1 < numShards ? channels[shard].get() : nullptr);
+                // The timeslots are run one at a time, so that a stop ends all shards at the same
+                // one. Shard k waits for the item the shard upstream sends at the start of each
+                // timeslot, so it is at most k - 1 timeslots ahead of the first shard: none has
+                // passed the end the first shard sets, and the items sent after it carry it on.
+                uint64_t slot = 0;
+                for (; slot < control->endSlot.load(memory_order_acquire); slot++) {
+                    if (!shard && control->stop.load(memory_order_relaxed)) {
+                        control->endSlot.store(min<uint64_t>(control->endSlot.load(memory_order_relaxed),
+                                                             slot + numShards), memory_order_release);
+                    }
+                    segment.run(1);
+                }
+                counts[shard] = {segment.getProductCount(), segment.getDropCount()};
+                TraceRecorder::flush();
+            } catch (...) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    // A failed shard leaves its neighbours waiting on their channels forever, so the first
+    // failure takes all shards down. The shards are polled rather than waited for with
+    // waitpid(-1, ...), which could reap children of the caller that are not shards.
+    vector<pid_t> running = pids;
+    while (!running.empty()) {
+        for (auto it = running.begin(); it != running.end();) {
+            int status = 0;
+            const pid_t pid = waitpid(*it, &status, WNOHANG);
+            if (!pid || (pid < 0 && errno == EINTR)) {
+                ++it;
+                continue;
+            }
+            const size_t shard = find(pids.begin(), pids.end(), *it) - pids.begin();
+            it = running.erase(it);
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+                killAll(running);
+                throw runtime_error(string(__func__) + ": shard " + to_string(shard) + " failed");
+            }
+        }
+        if (!running.empty()) {
+            if (ChunkedRunner::stopRequested()) {
+                control->stop.store(true, memory_order_relaxed);
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    return {counts[numShards - 1].productCount, counts[numShards - 1].dropCount, control->endSlot.load()};
+}
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <sys/mman.h>
+#include "ShmSpscChannel.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace conveyorsim {
+
+/// Head of the shared memory: the consumer index and the producer index. The items follow it,
+/// encoded as the part number plus one, with 0 for no item.
+struct ShmSpscRing {
+    alignas(64) atomic<uint64_t> head;
+    alignas(64) atomic<uint64_t> tail;
+};
+
+} // conveyorsim
+
+namespace {
+
+static_assert(atomic<uint64_t>::is_always_lock_free,
+              "the ring is shared between processes, which needs lock free atomics");
+
+// Spins for a while before yielding, so that a waiting peer on the same core gets to run
+void backOff(size_t& attempts) {
+    if (++attempts > 64) {
+        this_thread::yield();
+    }
+}
+
+} // namespace
+
+ShmSpscChannel::ShmSpscChannel(const size_t& capacity) {
+    if (!capacity) {
+        throw invalid_argument(string(__func__) + ": attempt to construct a zero capacity channel");
+    }
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+    mask = rounded - 1;
+    mappedBytes = sizeof(ShmSpscRing) + rounded * sizeof(uint64_t);
+
+    // Anonymous shared mappings are zero filled, which is an empty ring
+    void* const memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot map the ring");
+    }
+    ring = static_cast<ShmSpscRing*>(memory);
+    items = reinterpret_cast<uint64_t*>(static_cast<char*>(memory) + sizeof(ShmSpscRing));
+}
+
+ShmSpscChannel::~ShmSpscChannel() {
+    munmap(ring, mappedBytes);
+}
+
+void ShmSpscChannel::send(const optional<ItemPN>& item) {
+    const uint64_t tail = ring->tail.load(memory_order_relaxed);
+    for (size_t attempts = 0; tail - cachedHead > mask; backOff(attempts)) {
+        cachedHead = ring->head.load(memory_order_acquire);
+    }
+    items[tail & mask] = item.has_value() ? item.value().getPN() + 1 : 0;
+    ring->tail.store(tail + 1, memory_order_release);
+}
+
+optional<ItemPN> ShmSpscChannel::receive() {
+    const uint64_t head = ring->head.load(memory_order_relaxed);
+    for (size_t attempts = 0; head == cachedTail; backOff(attempts)) {
+        cachedTail = ring->tail.load(memory_order_acquire);
+    }
+    const uint64_t encoded = items[head & mask];
+    ring->head.store(head + 1, memory_order_release);
+    return encoded ? optional(ItemPN(encoded - 1)) : nullopt;
+}
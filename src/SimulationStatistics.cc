@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <exception>
+#include <ostream>
+#include <string>
+#include "SimulationStatistics.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+SimulationStatistics::SimulationStatistics(const size_t& capacity, const size_t& numSegments) :
+        capacity(capacity),
+        numSegments(min(capacity, numSegments)),
+        collectionLatency(min(capacity, numSegments)),
+        releaseWait(min(capacity, numSegments)),
+        busySlots(2 * capacity, 0),
+        productReadySlots(2 * capacity, 0)
+{
+    if (!capacity || !numSegments) {
+        throw invalid_argument(string(__func__) + ": attempt to construct statistics with no belt positions or "
+                                                  "no segments");
+    }
+}
+
+void SimulationStatistics::startSlot() {
+    slot++;
+}
+
+uint64_t SimulationStatistics::getSlot() const {
+    return slot;
+}
+
+void SimulationStatistics::recordCollection(const size_t& workerIdx, const Item& item) {
+    collectionLatency[segmentOf(workerIdx / 2)].record(slot - item.getEnqueueSlot());
+}
+
+void SimulationStatistics::recordProductReady(const size_t& workerIdx) {
+    productReadySlots[workerIdx] = slot;
+}
+
+void SimulationStatistics::recordRelease(const size_t& workerIdx) {
+    releaseWait[segmentOf(workerIdx / 2)].record(slot - productReadySlots[workerIdx]);
+}
+
+void SimulationStatistics::recordBusy(const size_t& workerIdx) {
+    busySlots[workerIdx]++;
+}
+
+void SimulationStatistics::recordExit(const Item& item, const bool& product) {
+    (product ? productTransit : dropTransit).record(slot - item.getEnqueueSlot());
+}
+
+size_t SimulationStatistics::getNumSegments() const {
+    return numSegments;
+}
+
+size_t SimulationStatistics::segmentOf(const size_t& pos) const {
+    return pos * numSegments / capacity;
+}
+
+const LogHistogram& SimulationStatistics::getCollectionLatency(const size_t& segment) const {
+    return collectionLatency.at(segment);
+}
+
+const LogHistogram& SimulationStatistics::getReleaseWait(const size_t& segment) const {
+    return releaseWait.at(segment);
+}
+
+const LogHistogram& SimulationStatistics::getProductTransit() const {
+    return productTransit;
+}
+
+const LogHistogram& SimulationStatistics::getDropTransit() const {
+    return dropTransit;
+}
+
+double SimulationStatistics::getBusyFraction(const size_t& pos) const {
+    return slot ? static_cast<double>(busySlots.at(2 * pos) + busySlots.at(2 * pos + 1)) / (2 * slot) : 0;
+}
+
+LogHistogram SimulationStatistics::busyPercentages(const size_t& first, const size_t& last) const {
+    LogHistogram percentages;
+    for (size_t pos = first; pos < last; pos++) {
+        percentages.record(static_cast<uint64_t>(100 * getBusyFraction(pos) + 0.5));
+    }
+    return percentages;
+}
+
+namespace conveyorsim {
+
+ostream& operator<<(ostream& os, const SimulationStatistics& obj) {
+    LogHistogram collection;
+    LogHistogram release;
+    size_t first = 0;
+    for (size_t segment = 0; segment < obj.numSegments; segment++) {
+        // the first position of the next segment is the smallest one that maps to it
+        const size_t last = (segment + 1) * obj.capacity / obj.numSegments
+                            + (((segment + 1) * obj.capacity) % obj.numSegments ? 1 : 0);
+        os << "*** Segment " << segment << ": positions [" << first << ", " << last << ") ***" << endl;
+        os << "Collection latency [timeslots]: " << obj.collectionLatency[segment] << endl;
+        os << "Release wait [timeslots]: " << obj.releaseWait[segment] << endl;
+        os << "Busy fraction [%]: " << obj.busyPercentages(first, last) << endl;
+        collection.merge(obj.collectionLatency[segment]);
+        release.merge(obj.releaseWait[segment]);
+        first = last;
+    }
+    os << "*** Overall ***" << endl;
+    os << "Collection latency [timeslots]: " << collection << endl;
+    os << "Release wait [timeslots]: " << release << endl;
+    os << "Busy fraction [%]: " << obj.busyPercentages(0, obj.capacity) << endl;
+    os << "Product transit [timeslots]: " << obj.productTransit << endl;
+    os << "Drop transit [timeslots]: " << obj.dropTransit;
+    return os;
+}
+
+} // conveyorsim
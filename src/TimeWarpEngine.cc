@@ -0,0 +1,390 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "ChunkedRunner.h"
+#include "MemoryPlacement.h"
+#include "PackedABState.h"
+#include "Seeding.h"
+#include "TraceRecorder.h"
+#include "TimeWarpEngine.h"
+#include "UniformRandomItemGenerator.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// A timeslot counter a segment publishes to its neighbours, on a cache line of its own so that
+// publishing one does not slow down reading another
+struct alignas(64) Frontier {
+    atomic<uint64_t> slot{0};
+};
+
+// A saved state of a segment, before the timeslot it was saved at
+struct Checkpoint {
+    uint64_t slot;
+    string state;
+    uint64_t productCount;
+    uint64_t dropCount;
+};
+
+// One segment of the belt and the thread running it
+class Segment {
+public:
+    Segment(const size_t& segmentCap, const size_t& assemblyDuration, const uint64_t& seed,
+            const TimeWarpEngine::Settings& settings, atomic<uint64_t>& endSlot) :
+            out(settings.window),
+            snapshot(segmentCap),
+            settings(settings),
+            endSlot(endSlot),
+            logSize(settings.window + settings.checkpointInterval),
+            state(segmentCap, assemblyDuration),
+            rng(deriveSeed(seed, RandomStream::WorkerPriority)),
+            udst(0, 2),
+            arrivals(logSize),
+            priorities(logSize)
+    { }
+
+    // Wires the segment up; the first segment generates its arrivals from *seed*
+    void connect(Segment* upstreamSegment, const Segment* lastSegment, const bool& hasDownstream,
+                 const uint64_t& seed) {
+        upstream = upstreamSegment;
+        last = lastSegment ? lastSegment : this;
+        publishesSnapshots = hasDownstream && settings.optimistic;
+        speculative = upstream && settings.optimistic;
+        if (!upstream) {
+            generator = make_unique<UniformRandomItemGenerator>(unordered_set<ItemPN>{ItemPN('A'), ItemPN('B')}, true,
+                                                                deriveSeed(seed, RandomStream::ItemGeneration));
+        }
+    }
+
+    void run() {
+        publishSnapshot();
+        // Spans of failed attempts to advance are traced as waits
+        uint64_t waitBegin = 0;
+        while (committedSlots < endSlot.load(memory_order_acquire)) {
+            if (speculative) {
+                verify();
+            }
+            // On a stop, the run ends where the first segment is; no other segment has committed
+            // a timeslot it has not run
+            if (!upstream && ChunkedRunner::stopRequested()) {
+                endSlot.store(min(endSlot.load(memory_order_relaxed), executed), memory_order_release);
+            }
+            if (advance()) {
+                if (waitBegin) {
+                    TraceRecorder::record(TracePhase::Wait, waitBegin, TraceRecorder::now());
+                    waitBegin = 0;
+                }
+            } else {
+                if (!waitBegin && TraceRecorder::isRecording(true)) {
+                    waitBegin = TraceRecorder::now();
+                }
+                this_thread::yield();
+            }
+        }
+        // Timeslots run ahead of an early end are undone, so that the counts are those of the
+        // timeslots run
+        if (executed > committedSlots) {
+            rollback(committedSlots);
+        }
+    }
+
+    // Published to the neighbours
+    Frontier produced;
+    Frontier committed;
+    Frontier snapshotSlot;
+    vector<atomic<uint8_t>> out;
+    PlacedVector<atomic<uint8_t>> snapshot;
+
+    // Read once every thread was joined
+    uint64_t productCount = 0;
+    uint64_t dropCount = 0;
+    uint64_t executedSlots = 0;
+    uint64_t predictedSlots = 0;
+    uint64_t rollbacks = 0;
+    uint64_t rolledBackSlots = 0;
+
+private:
+    // Commits the timeslots whose arrivals match the ones committed upstream, up to the first
+    // straggler, which is rolled back to
+    void verify() {
+        const uint64_t upstreamCommitted = upstream->committed.slot.load(memory_order_acquire);
+        const uint64_t limit = min(executed, upstreamCommitted);
+        uint64_t slot = committedSlots;
+        for (; slot < limit; slot++) {
+            if (arrivals[slot % logSize] != upstream->out[slot % settings.window].load(memory_order_relaxed)) {
+                rollback(slot);
+                break;
+            }
+        }
+        if (slot == committedSlots) {
+            return;
+        }
+        committedSlots = slot;
+        committed.slot.store(slot, memory_order_release);
+
+        // Fossil collection: only the last saved state at or before the commit can still be
+        // rolled back to
+        while (checkpoints.size() > 1 && checkpoints[1].slot <= committedSlots) {
+            checkpoints.pop_front();
+        }
+    }
+
+    // Runs a batch of timeslots, as far as the window and, when running conservatively, the
+    // segment upstream allow
+    bool advance() {
+        const uint64_t gvt = last->committed.slot.load(memory_order_acquire);
+        uint64_t end = min({endSlot.load(memory_order_acquire), executed + settings.batchSlots,
+                            gvt + settings.window});
+        uint64_t upstreamProduced = 0;
+        if (upstream) {
+            upstreamProduced = upstream->produced.slot.load(memory_order_acquire);
+            if (!settings.optimistic) {
+                end = min(end, upstreamProduced);
+            }
+        }
+        if (end <= executed) {
+            return false;
+        }
+
+        for (uint64_t slot = executed; slot < end; slot++) {
+            TraceRecorder::nextSlot();
+            if (speculative && !(slot % settings.checkpointInterval)
+                && (checkpoints.empty() || checkpoints.back().slot != slot)) {
+                TraceScope trace(TracePhase::Checkpoint);
+                checkpoints.push_back({slot, state.encode(), productCount, dropCount});
+            }
+            PackedItem arriving;
+            {
+                TraceScope trace(TracePhase::Generation);
+                if (!upstream) {
+                    arriving = generate();
+                } else if (slot < upstreamProduced) {
+                    arriving = static_cast<PackedItem>(upstream->out[slot % settings.window]
+                                                               .load(memory_order_relaxed));
+                } else {
+                    arriving = predict(slot);
+                    predictedSlots++;
+                }
+                if (slot == drawnSlots) {
+                    priorities[slot % logSize] = udst(rng) % 2;
+                    drawnSlots++;
+                }
+            }
+            arrivals[slot % logSize] = static_cast<uint8_t>(arriving);
+            TraceScope trace(TracePhase::WorkerSweep);
+            const PackedItem exited = state.step(arriving, priorities[slot % logSize]);
+            out[slot % settings.window].store(static_cast<uint8_t>(exited), memory_order_relaxed);
+            count(exited);
+        }
+        executedSlots += end - executed;
+        executed = end;
+        produced.slot.store(end, memory_order_release);
+        publishSnapshot();
+        if (!speculative) {
+            committedSlots = end;
+            committed.slot.store(end, memory_order_release);
+        }
+        return true;
+    }
+
+    // Restores the last saved state before a straggler and runs the logged timeslots up to it
+    void rollback(const uint64_t& slot) {
+        TraceScope trace(TracePhase::Rollback, true);
+        while (checkpoints.back().slot > slot) {
+            checkpoints.pop_back();
+        }
+        const Checkpoint& checkpoint = checkpoints.back();
+        state.decode(checkpoint.state);
+        productCount = checkpoint.productCount;
+        dropCount = checkpoint.dropCount;
+        for (uint64_t replayed = checkpoint.slot; replayed < slot; replayed++) {
+            count(state.step(static_cast<PackedItem>(arrivals[replayed % logSize]), priorities[replayed % logSize]));
+        }
+        rollbacks++;
+        rolledBackSlots += executed - slot;
+        executedSlots += slot - checkpoint.slot;
+        executed = slot;
+        produced.slot.store(slot, memory_order_release);
+    }
+
+    // The item the segment upstream will send, as the item that many positions before the end
+    // of its belt in its last snapshot
+    [[nodiscard]] PackedItem predict(const uint64_t& slot) const {
+        const uint64_t base = upstream->snapshotSlot.slot.load(memory_order_acquire);
+        if (slot < base) {
+            return static_cast<PackedItem>(upstream->out[slot % settings.window].load(memory_order_relaxed));
+        }
+        const uint64_t ahead = slot - base;
+        if (ahead >= upstream->snapshot.size()) {
+            return PackedItem::Empty;
+        }
+        return static_cast<PackedItem>(upstream->snapshot[upstream->snapshot.size() - 1 - ahead]
+                                               .load(memory_order_relaxed));
+    }
+
+    void publishSnapshot() {
+        if (!publishesSnapshots) {
+            return;
+        }
+        for (size_t pos = 0; pos < snapshot.size(); pos++) {
+            snapshot[pos].store(static_cast<uint8_t>(state.peekItem(pos)), memory_order_relaxed);
+        }
+        snapshotSlot.slot.store(executed, memory_order_release);
+    }
+
+    PackedItem generate() {
+        const auto item = generator->get_next_item();
+        if (!item.has_value()) {
+            return PackedItem::Empty;
+        }
+        return item.value().getPN() == ItemPN('A') ? PackedItem::A : PackedItem::B;
+    }
+
+    // Only the items leaving the last segment leave the belt
+    void count(const PackedItem& exited) {
+        if (last != this) {
+            return;
+        }
+        productCount += exited == PackedItem::P;
+        dropCount += exited == PackedItem::A || exited == PackedItem::B;
+    }
+
+    const TimeWarpEngine::Settings& settings;
+    // The timeslots to run, lowered by the first segment on a stop
+    atomic<uint64_t>& endSlot;
+    // Logs cover the timeslots from the oldest saved state to the end of the window
+    const size_t logSize;
+    PackedABState state;
+    Segment* upstream = nullptr;
+    const Segment* last = nullptr;
+    bool publishesSnapshots = false;
+    bool speculative = false;
+    unique_ptr<UniformRandomItemGenerator> generator;
+    mt19937 rng;
+    uniform_int_distribution<size_t> udst;
+    uint64_t executed = 0;
+    uint64_t committedSlots = 0;
+    uint64_t drawnSlots = 0;
+    deque<Checkpoint> checkpoints;
+    vector<uint8_t> arrivals;
+    vector<uint8_t> priorities;
+};
+
+} // namespace
+
+TimeWarpEngine::TimeWarpEngine(const size_t& convCap, const size_t& assemblyDuration, const size_t& numSegments,
+                               const uint64_t& seed, const Settings& settings) :
+        convCap(convCap),
+        assemblyDuration(assemblyDuration),
+        numSegments(numSegments),
+        seed(seed),
+        settings(settings)
+{
+    if (!numSegments || numSegments > convCap) {
+        throw invalid_argument(string(__func__) + ": every segment needs at least one belt position");
+    }
+    if (assemblyDuration > numeric_limits<uint32_t>::max()) {
+        throw invalid_argument(string(__func__) + ": assembly duration does not fit in 32 bits");
+    }
+    if (!settings.checkpointInterval || !settings.window || !settings.batchSlots) {
+        throw invalid_argument(string(__func__) + ": the checkpoint interval, window and batch must not be 0");
+    }
+}
+
+TimeWarpEngine::TimeWarpEngine(const size_t& convCap, const size_t& assemblyDuration, const size_t& numSegments,
+                               const uint64_t& seed) :
+        TimeWarpEngine(convCap, assemblyDuration, numSegments, seed, Settings())
+{ }
+
+TimeWarpEngine::Result TimeWarpEngine::run(const size_t& numSlots) const {
+    // Every thread builds the segment it runs, so that the memory of the segment is first
+    // touched, and placed, on the NUMA node of the thread; the segments are wired up once all
+    // of them are built
+    vector<unique_ptr<Segment>> segments(numSegments);
+    atomic<uint64_t> endSlot{numSlots};
+    vector<exception_ptr> errors(numSegments);
+    mutex setupMutex;
+    condition_variable setupChanged;
+    size_t built = 0;
+    bool started = false;
+    bool failed = false;
+
+    vector<thread> threads;
+    for (size_t idx = 0; idx < numSegments; idx++) {
+        threads.emplace_back([&, idx] {
+            const string name = "segment " + to_string(idx);
+            TraceRecorder::attachThread(name);
+            MemoryPlacement::placeThread(idx, name);
+            try {
+                // Segment sizes differ by at most one position
+                const size_t segmentCap = convCap / numSegments + (idx < convCap % numSegments);
+                segments[idx] = make_unique<Segment>(segmentCap, assemblyDuration, seed, settings, endSlot);
+            } catch (...) {
+                errors[idx] = current_exception();
+            }
+            unique_lock<mutex> lock(setupMutex);
+            built++;
+            setupChanged.notify_all();
+            setupChanged.wait(lock, [&] { return started; });
+            if (!failed) {
+                lock.unlock();
+                segments[idx]->run();
+            }
+        });
+    }
+    {
+        unique_lock<mutex> lock(setupMutex);
+        setupChanged.wait(lock, [&] { return built == numSegments; });
+    }
+    failed = any_of(errors.begin(), errors.end(), [](const exception_ptr& error) { return error != nullptr; });
+    if (!failed) {
+        for (size_t idx = 0; idx < numSegments; idx++) {
+            segments[idx]->connect(idx ? segments[idx - 1].get() : nullptr, segments.back().get(),
+                                   idx + 1 < numSegments, seed);
+        }
+    }
+
+    const auto start = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> lock(setupMutex);
+        started = true;
+    }
+    setupChanged.notify_all();
+    for (auto& segmentThread: threads) {
+        segmentThread.join();
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    for (const auto& error: errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    Result result{segments.back()->productCount, segments.back()->dropCount, endSlot.load(), 0, 0, 0, 0,
+                  elapsed.count()};
+    for (const auto& segment: segments) {
+        result.executedSlots += segment->executedSlots;
+        result.predictedSlots += segment->predictedSlots;
+        result.rollbacks += segment->rollbacks;
+        result.rolledBackSlots += segment->rolledBackSlots;
+    }
+    return result;
+}
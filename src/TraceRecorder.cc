@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <cerrno>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/file.h>
+#include <system_error>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "TraceRecorder.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace conveyorsim {
+
+// One recorded phase
+struct TraceEvent {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t slot;
+    TracePhase phase;
+};
+
+// The events of a thread, in a ring that is allocated once, when the thread is attached
+struct TraceBuffer {
+    TraceBuffer(const string& name, const size_t& tid, const size_t& capacity) :
+            name(name),
+            tid(tid),
+            events(capacity)
+    { }
+
+    string name;
+    const size_t tid;
+    vector<TraceEvent> events;
+    uint64_t recorded = 0;
+};
+
+} // conveyorsim
+
+namespace {
+
+// The threads of this process and the trace file; only attaching and writing take the lock,
+// never recording
+mutex registryMutex;
+vector<unique_ptr<TraceBuffer>> buffers;
+size_t eventsPerThread = TraceRecorder::DefaultEventsPerThread;
+string tracePath;
+
+const char* phaseName(const TracePhase& phase) {
+    switch (phase) {
+        case TracePhase::Generation:
+            return "generation";
+        case TracePhase::Rotation:
+            return "rotation";
+        case TracePhase::WorkerSweep:
+            return "worker sweep";
+        case TracePhase::Wait:
+            return "wait";
+        case TracePhase::IO:
+            return "io";
+        case TracePhase::Checkpoint:
+            return "checkpoint";
+        case TracePhase::Rollback:
+            return "rollback";
+    }
+    return "unknown";
+}
+
+// Escapes a thread name for a JSON string
+string escape(const string& text) {
+    string escaped;
+    for (const char& character: text) {
+        if (character == '"' || character == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(character) >= ' ') {
+            escaped += character;
+        }
+    }
+    return escaped;
+}
+
+// Appends text to the trace file, locked against the other processes appending to it
+void appendToFile(const string& path, const string& text) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot open " + path);
+    }
+    flock(fd, LOCK_EX);
+    for (size_t written = 0; written < text.size();) {
+        const ssize_t count = write(fd, text.data() + written, text.size() - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            const int error = errno;
+            ::close(fd);
+            throw system_error(error, generic_category(), string(__func__) + ": cannot write " + path);
+        }
+        written += count;
+    }
+    ::close(fd);
+}
+
+string takeEvents() {
+    ostringstream events;
+    TraceRecorder::writeEvents(events);
+    return events.str();
+}
+
+} // namespace
+
+void TraceRecorder::enable(const size_t& samplePeriod, const size_t& eventsPerThread) {
+    if (!samplePeriod || !eventsPerThread) {
+        throw invalid_argument(string(__func__) + ": the sample period and the events per thread must not be 0");
+    }
+    {
+        lock_guard<mutex> lock(registryMutex);
+        ::eventsPerThread = eventsPerThread;
+    }
+    TraceRecorder::samplePeriod.store(samplePeriod, memory_order_relaxed);
+    enabled.store(true, memory_order_relaxed);
+}
+
+void TraceRecorder::disable() {
+    enabled.store(false, memory_order_relaxed);
+}
+
+bool TraceRecorder::isEnabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+void TraceRecorder::attachThread(const string& name) {
+    if (!isEnabled()) {
+        return;
+    }
+    lock_guard<mutex> lock(registryMutex);
+    if (currentThread.buffer) {
+        currentThread.buffer->name = name;
+        return;
+    }
+    buffers.push_back(make_unique<TraceBuffer>(name, buffers.size() + 1, eventsPerThread));
+    currentThread = {buffers.back().get(), 0, false};
+}
+
+void TraceRecorder::restartAfterFork(const string& name) {
+    // The threads of the parent do not exist in the child, and one of them may have held the
+    // lock or been changing the registry when the parent forked. Locking could then wait
+    // forever, so the lock and the registry are constructed anew over the inherited ones. The
+    // inherited buffers are leaked: they may be half updated, and are only copy-on-write pages.
+    new (&registryMutex) mutex();
+    new (&buffers) vector<unique_ptr<TraceBuffer>>();
+    currentThread = {};
+    attachThread(name);
+}
+
+uint64_t TraceRecorder::now() {
+    timespec clockTime{};
+    clock_gettime(CLOCK_MONOTONIC, &clockTime);
+    return static_cast<uint64_t>(clockTime.tv_sec) * 1000000000ULL + clockTime.tv_nsec;
+}
+
+void TraceRecorder::record(const TracePhase& phase, const uint64_t& begin, const uint64_t& end) {
+    TraceBuffer* const buffer = currentThread.buffer;
+    // nextSlot() already counted the current timeslot
+    const uint64_t slot = currentThread.slot ? currentThread.slot - 1 : 0;
+    buffer->events[buffer->recorded % buffer->events.size()] = {begin, end, slot, phase};
+    buffer->recorded++;
+}
+
+void TraceRecorder::writeEvents(ostream& os) {
+    lock_guard<mutex> lock(registryMutex);
+    const pid_t pid = getpid();
+    const auto flags = os.flags();
+    os << fixed;
+    os.precision(3);
+    for (const auto& buffer: buffers) {
+        os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+           << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+        const uint64_t capacity = buffer->events.size();
+        const uint64_t first = buffer->recorded > capacity ? buffer->recorded - capacity : 0;
+        for (uint64_t idx = first; idx < buffer->recorded; idx++) {
+            const TraceEvent& event = buffer->events[idx % capacity];
+            // Chrome trace timestamps are in microseconds
+            os << ",\n{\"name\":\"" << phaseName(event.phase) << "\",\"cat\":\"conveyor_sim\",\"ph\":\"X\",\"ts\":"
+               << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << ",\"pid\":" << pid
+               << ",\"tid\":" << buffer->tid << ",\"args\":{\"slot\":" << event.slot << "}}";
+        }
+        buffer->recorded = 0;
+    }
+    os.flags(flags);
+}
+
+void TraceRecorder::open(const string& path) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), string(__func__) + ": cannot create " + path);
+    }
+    ::close(fd);
+    // The first element names the process; every other one is appended after a comma
+    appendToFile(path, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + to_string(getpid())
+                       + ",\"args\":{\"name\":\"conveyor_sim\"}}");
+    lock_guard<mutex> lock(registryMutex);
+    tracePath = path;
+}
+
+void TraceRecorder::flush() {
+    string path;
+    {
+        lock_guard<mutex> lock(registryMutex);
+        path = tracePath;
+    }
+    if (!path.empty()) {
+        appendToFile(path, takeEvents());
+    }
+}
+
+void TraceRecorder::close() {
+    string path;
+    {
+        lock_guard<mutex> lock(registryMutex);
+        path = tracePath;
+        tracePath.clear();
+    }
+    if (!path.empty()) {
+        appendToFile(path, takeEvents() + "\n]\n");
+    }
+}
@@ -12,21 +12,21 @@ using namespace conveyorsim;
 
 class UniformRandomItemGenerator::impl {
 public:
-    explicit impl(const size_t& numOutcomes) :
-            rng(rd()),
+    impl(const size_t& numOutcomes, const optional<uint32_t>& seed) :
+            rng(seed.has_value() ? seed.value() : random_device()()),
             udst(0, numOutcomes - 1)
     {
         if(!numOutcomes) {
             throw invalid_argument("Attempt to construct UniformRandomItemGenerator object with no outcomes.");
         }
     }
-    mutable std::random_device rd;
     mutable std::mt19937 rng;
     mutable std::uniform_int_distribution<size_t> udst;
 };
 
-UniformRandomItemGenerator::UniformRandomItemGenerator(const unordered_set<ItemPN>& PNSet, const bool& emptyPossible) :
-        pImpl(make_unique<impl>(PNSet.size() + (emptyPossible ? 1 : 0))), // one more position if empty generation is possible
+UniformRandomItemGenerator::UniformRandomItemGenerator(const unordered_set<ItemPN>& PNSet, const bool& emptyPossible,
+                                                       const optional<uint32_t>& seed) :
+        pImpl(make_unique<impl>(PNSet.size() + (emptyPossible ? 1 : 0), seed)), // one more position if empty generation is possible
         PNSet(PNSet.begin(), PNSet.end())
 {}
 
@@ -54,6 +54,11 @@ UniformRandomItemGenerator::get_next_item() const
     return get_next_items(1)[0];
 }
 
+void UniformRandomItemGenerator::reseed(const optional<uint32_t>& seed) {
+    pImpl->rng.seed(seed.has_value() ? seed.value() : random_device()());
+    pImpl->udst.reset();
+}
+
 void UniformRandomItemGenerator::print(ostream& os) const {
     os << "[ ";
     for (const auto &pn : PNSet) {
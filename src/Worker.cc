@@ -2,178 +2,121 @@
 // Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
 //
 
-#include <exception>
+#include <cstdint>
 #include <ostream>
+#include <stdexcept>
+#include <string>
 #include "Worker.h"
 
 using namespace std;
 using namespace conveyorsim;
 
-Worker::Worker(const ConveyorPositionControllerIF& controller, const size_t& armsN,
-               const unordered_map<ItemPN, size_t>& neededPNQuotas,
-               const ItemPN& productPN, const size_t& assemblyDuration) :
-        controller(controller),
-        armsN(armsN),
-        neededPNQuotas(neededPNQuotas),
-        productPN(productPN),
-        assemblyDuration(assemblyDuration),
-        assemblyCountdown(0),
-        busyArms(0),
-        busy(false)
-{
-    if (!armsN) {
-        throw invalid_argument(string(__func__) + ": Attempt to construct a worker object with no arms");
-    }
-    for(const auto &[pn, quota]: neededPNQuotas) {
-        neededItemsCount += quota;
-        heldItemCounts[pn] = 0;
+// Configurations build two Workers per belt position, by the million
+static_assert(sizeof(Worker) <= 8, "a Worker should only hold its state and countdown");
+
+void Worker::act(const WorkerContext& context, const ConveyorPositionControllerIF& controller,
+                 const size_t& workerIdx, const uint8_t& actions) {
+    SimulationStatistics* const statistics = context.statistics;
+    if (actions & WorkerAutomaton::Collect) {
+        // TODO: actual item will be destroyed here since its only relevant state (pn) is now stored.
+        //       In a future implementation where more state is added, we may need a DS to store the
+        //       items held by the worker (e.g weight of the object, quality, serial numbers etc)
+        const auto item = controller.collectItem();
+        if (statistics) {
+            statistics->recordCollection(workerIdx, item);
+        }
     }
-    heldItemCounts[productPN] = 0;
-
-    if(armsN < neededItemsCount) {
-        throw invalid_argument(string(__func__) + ": Attempt to construct a worker object with less arms than the "
-                                                  "number of needed items");
+    if ((actions & WorkerAutomaton::Finish) && statistics) {
+        statistics->recordProductReady(workerIdx);
     }
-}
-
-bool
-Worker::tryCollect()
-{
-    const auto& peek = controller.peekItem();
-    if(!peek.has_value()) {
-        return false;
-    }
-    if( !(canPickItem(peek.value()) && canUseItem(peek.value())) ) {
-        return false;
+    if (actions & WorkerAutomaton::Release) {
+        if (statistics) {
+            statistics->recordRelease(workerIdx);
+            controller.emplaceItem(Item(context.spec.getProductPN(), statistics->getSlot()));
+        } else {
+            controller.emplaceItem(Item(context.spec.getProductPN()));
+        }
     }
-
-    const auto item = controller.collectItem();
-    const auto& pn = item.getPN();
-    heldItemCounts.at(pn)++;
-    neededItemsCount--;
-    busyArms++;
-
-    // TODO: actual item will be destroyed here since its only relevant state (pn) is now stored.
-    //       In a future implementation where more state is added, we may need a DS to store the
-    //       items held by the worker (e.g weight of the object, quality, serial numbers etc)
-    return true;
 }
 
-bool Worker::tryInitializeAssembly()
-{
-    // If you are still busy with a current assembly, do nothing:
-    if (busy) {
-        return false;
-    }
-
-    // If you don't have enough items, do nothing:
-    if (neededItemsCount) {
-        return false;
+void Worker::run(const WorkerContext& context, const ConveyorPositionControllerIF& controller,
+                 const size_t& workerIdx) {
+    if (assemblyCountdown) {
+        assemblyCountdown--;
     }
-
-    busy = true;
-    assemblyCountdown = assemblyDuration;
-    return true;
-}
-
-bool
-Worker::tryFinalizeAssembly()
-{
-    // If you are still busy with a current assembly, or haven't started yet, do nothing:
-    if ( !(busy && !assemblyCountdown)) {
-        return false;
+    const size_t content = WorkerAutomaton::classify(context.spec, controller.peekItem());
+    const auto& transition = context.automaton.transition(automatonState, content, controller.isReserved(),
+                                                          !assemblyCountdown);
+    automatonState = transition.next;
+    if (transition.actions & WorkerAutomaton::Start) {
+        assemblyCountdown = static_cast<uint32_t>(context.spec.getAssemblyDuration());
     }
-    busy = false;
-    for(const auto& [key, quota]: neededPNQuotas) {
-        size_t& count = heldItemCounts.at(key);
-        count -= quota;
-        neededItemsCount += (quota >= count) ? quota - count : 0;
-        busyArms -= quota;
+    if (transition.actions) {
+        act(context, controller, workerIdx, transition.actions);
     }
-    heldItemCounts.at(productPN)++;
-    busyArms++;
-    return true;
-}
-
-bool
-Worker::tryReleaseProduct()
-{
-    if (!(!controller.isReserved() && controller.isEmpty() && heldItemCounts.at(productPN))) {
-        return false;
+    if (context.statistics && context.automaton.getState(automatonState).busy) {
+        context.statistics->recordBusy(workerIdx);
     }
-    heldItemCounts.at(productPN)--;
-    busyArms--;
-    controller.emplaceItem(Item(productPN));
-    return true;
 }
 
-bool
-Worker::canUseItem(const Item& item) const
-{
-    const ItemPN& pn = item.getPN();
-
-    // Item not needed:
-    if (!neededPNQuotas.count(pn)) {
-        return false;
-    }
-
-    // Missing needed item:
-    if(heldItemCounts.at(pn) < neededPNQuotas.at(pn)) {
-        return true;
-    } else {
-
-        // Surplus needed item. Can be used only if there is room for the remaining
-        // non surplus items that are needed. This is to prevent deadlocks.
-        if ( (armsN - busyArms) <= neededItemsCount) {
-            return false;
-        }
-        return true;
-    }
+void Worker::reset() {
+    automatonState = 0;
+    assemblyCountdown = 0;
 }
 
-bool
-Worker::canPickItem(const Item& item) const
-{
-    return !controller.isReserved() && !busy && (busyArms < armsN);
+PackedWorker Worker::pack(const WorkerContext& context) const {
+    const WorkerSpec& spec = context.spec;
+    const size_t partA = spec.findPart(ItemPN('A')).value();
+    const size_t partB = spec.findPart(ItemPN('B')).value();
+    const WorkerState& held = context.automaton.getState(automatonState);
+    PackedWorker packed;
+    packed.countdown = assemblyCountdown;
+    packed.flags = static_cast<uint8_t>((held.heldItemCounts[partA] ? PackedWorker::HoldsA : 0)
+                                        | (held.heldItemCounts[partB] ? PackedWorker::HoldsB : 0)
+                                        | (held.heldProductCount ? PackedWorker::HoldsP : 0)
+                                        | (held.busy ? PackedWorker::Busy : 0));
+    return packed;
 }
 
-void Worker::run(const size_t &numSlots) {
-    for(size_t slot = 0; slot < numSlots; slot++) {
-
-        if (assemblyCountdown) {
-            assemblyCountdown--;
-        }
-        tryCollect();
-        tryInitializeAssembly();
-        tryFinalizeAssembly();
-        tryReleaseProduct();
+void Worker::unpack(const WorkerContext& context, const PackedWorker& packed) {
+    const WorkerSpec& spec = context.spec;
+    const size_t partA = spec.findPart(ItemPN('A')).value();
+    const size_t partB = spec.findPart(ItemPN('B')).value();
+    WorkerState unpacked;
+    unpacked.heldItemCounts[partA] = (packed.flags & PackedWorker::HoldsA) ? 1 : 0;
+    unpacked.heldItemCounts[partB] = (packed.flags & PackedWorker::HoldsB) ? 1 : 0;
+    unpacked.heldProductCount = (packed.flags & PackedWorker::HoldsP) ? 1 : 0;
+    unpacked.busyArms = unpacked.heldItemCounts[partA] + unpacked.heldItemCounts[partB] + unpacked.heldProductCount;
+    unpacked.neededItemsCount = spec.getNeededItemsCount() - unpacked.heldItemCounts[partA]
+                                - unpacked.heldItemCounts[partB];
+    unpacked.busy = packed.flags & PackedWorker::Busy;
+    const auto found = context.automaton.findState(unpacked);
+    if (!found.has_value()) {
+        throw invalid_argument(string(__func__) + ": the packed state is not a state of the worker");
     }
+    automatonState = found.value();
+    assemblyCountdown = packed.countdown;
 }
 
-namespace conveyorsim {
-
-ostream& operator<<(ostream& os, const Worker& obj) {
-
+void Worker::print(ostream& os, const WorkerContext& context, const ConveyorPositionControllerIF& controller) const {
+    const WorkerSpec& spec = context.spec;
+    const WorkerState& held = context.automaton.getState(automatonState);
     os << "[ ";
-    os << obj.productPN << ", ";
-    os << "numProducts : " << obj.heldItemCounts.at(obj.productPN) << ", ";
-    os << "controller : " << obj.controller << ", ";
+    os << spec.getProductPN() << ", ";
+    os << "numProducts : " << to_string(held.heldProductCount) << ", ";
+    os << "controller : " << controller << ", ";
     os << "heldItemCounts : { ";
-    for (const auto& [pn, quota]: obj.neededPNQuotas) {
-        os << "{ pn : " << pn << ", ";
-        os << "count : " << obj.heldItemCounts.at(pn) << ", ";
-        os << "quota : " << quota << "}, ";
+    for (size_t part = 0; part < spec.getNumParts(); part++) {
+        os << "{ pn : " << spec.getPartPN(part) << ", ";
+        os << "count : " << to_string(held.heldItemCounts[part]) << ", ";
+        os << "quota : " << spec.getQuota(part) << "}, ";
     }
     os << " }, ";
-    os << "armsN : " << to_string(obj.armsN) << ", ";
-    os << "busyArms : " << to_string(obj.busyArms) << ", ";
-    os << "neededItemsCount : " << to_string(obj.neededItemsCount) << ", ";
-    os << "assemblyDuration : " << to_string(obj.assemblyDuration) << ", ";
-    os << "assemblyCountdown : " << to_string(obj.assemblyCountdown) << ", ";
-    os << "busy : " << boolalpha << obj.busy << noboolalpha << " ";
+    os << "armsN : " << to_string(spec.getArmsN()) << ", ";
+    os << "busyArms : " << to_string(held.busyArms) << ", ";
+    os << "neededItemsCount : " << to_string(held.neededItemsCount) << ", ";
+    os << "assemblyDuration : " << to_string(spec.getAssemblyDuration()) << ", ";
+    os << "assemblyCountdown : " << to_string(assemblyCountdown) << ", ";
+    os << "busy : " << boolalpha << held.busy << noboolalpha << " ";
     os << "]";
-
-    return os;
 }
-
-} // conveyorsim
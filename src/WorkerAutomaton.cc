@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include "WorkerAutomaton.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+bool WorkerState::operator==(const WorkerState& other) const {
+    return heldItemCounts == other.heldItemCounts && heldProductCount == other.heldProductCount
+           && busyArms == other.busyArms && neededItemsCount == other.neededItemsCount && busy == other.busy;
+}
+
+WorkerAutomaton::WorkerAutomaton(const size_t& numContents) :
+        numContents(numContents)
+{ }
+
+WorkerState WorkerAutomaton::initialState(const WorkerSpec& spec) {
+    WorkerState state;
+    state.neededItemsCount = static_cast<uint8_t>(spec.getNeededItemsCount());
+    return state;
+}
+
+size_t WorkerAutomaton::classify(const WorkerSpec& spec, const optional<Item>& item) {
+    if (!item.has_value()) {
+        return 0;
+    }
+    const auto part = spec.findPart(item.value().getPN());
+    return part.has_value() ? part.value() + 1 : spec.getNumParts() + 1;
+}
+
+uint8_t WorkerAutomaton::apply(const WorkerSpec& spec, WorkerState& state, const size_t& content,
+                               const bool& reserved, const bool& expired) {
+    uint8_t actions = 0;
+    bool taken = reserved;
+    bool empty = !content;
+
+    // Try to collect: a free arm, not assembling, and a needed item. A surplus item can be used
+    // only if there is room for the remaining non surplus items that are needed; this is to
+    // prevent deadlocks. Only a missing item brings the assembly closer
+    if (content && content <= spec.getNumParts() && !taken && !state.busy && state.busyArms < spec.getArmsN()) {
+        const size_t part = content - 1;
+        const bool missing = state.heldItemCounts[part] < spec.getQuota(part);
+        if (missing || spec.getArmsN() - state.busyArms > state.neededItemsCount) {
+            state.heldItemCounts[part]++;
+            state.neededItemsCount -= missing;
+            state.busyArms++;
+            actions |= Collect;
+            taken = true;
+            empty = true;
+        }
+    }
+
+    // Try to initialize assembly if the quotas are met
+    bool countdownDone = expired;
+    if (!state.busy && !state.neededItemsCount) {
+        state.busy = true;
+        countdownDone = !spec.getAssemblyDuration();
+        actions |= Start;
+    }
+
+    // Try to finalize assembly; the components are discarded and the product takes an arm
+    if (state.busy && countdownDone) {
+        state.busy = false;
+        for (size_t part = 0; part < spec.getNumParts(); part++) {
+            const size_t quota = spec.getQuota(part);
+            uint8_t& count = state.heldItemCounts[part];
+            count -= quota;
+            state.neededItemsCount += (quota >= count) ? quota - count : 0;
+            state.busyArms -= quota;
+        }
+        state.heldProductCount++;
+        state.busyArms++;
+        actions |= Finish;
+    }
+
+    // Try to release a product
+    if (!taken && empty && state.heldProductCount) {
+        state.heldProductCount--;
+        state.busyArms--;
+        actions |= Release;
+    }
+    return actions;
+}
+
+WorkerAutomaton::Key WorkerAutomaton::key(const WorkerState& state) {
+    Key stateKey{};
+    copy(state.heldItemCounts.begin(), state.heldItemCounts.end(), stateKey.begin());
+    stateKey[WorkerSpec::MaxParts] = state.heldProductCount;
+    stateKey[WorkerSpec::MaxParts + 1] = state.busyArms;
+    stateKey[WorkerSpec::MaxParts + 2] = state.neededItemsCount;
+    stateKey[WorkerSpec::MaxParts + 3] = state.busy;
+    return stateKey;
+}
+
+unique_ptr<const WorkerAutomaton> WorkerAutomaton::build(const WorkerSpec& spec) {
+    unique_ptr<WorkerAutomaton> automaton(new WorkerAutomaton(spec.getNumParts() + 2));
+    const auto add = [&automaton](const WorkerState& state) {
+        const auto [entry, added] = automaton->index.emplace(key(state), automaton->states.size());
+        if (added) {
+            automaton->states.push_back(state);
+        }
+        return entry->second;
+    };
+    add(initialState(spec));
+
+    // Breadth first over the reachable states; the transitions of a state are appended in the
+    // order transition() looks them up
+    for (size_t state = 0; state < automaton->states.size(); state++) {
+        for (size_t content = 0; content < automaton->numContents; content++) {
+            for (const bool& reserved: {false, true}) {
+                for (const bool& expired: {false, true}) {
+                    WorkerState next = automaton->states[state];
+                    const uint8_t actions = apply(spec, next, content, reserved, expired);
+                    const uint16_t nextState = add(next);
+                    if (automaton->states.size() > MaxStates) {
+                        return nullptr;
+                    }
+                    automaton->table.push_back({nextState, actions});
+                }
+            }
+        }
+    }
+    return automaton;
+}
+
+size_t WorkerAutomaton::getNumStates() const {
+    return states.size();
+}
+
+const WorkerState& WorkerAutomaton::getState(const uint16_t& state) const {
+    return states[state];
+}
+
+optional<uint16_t> WorkerAutomaton::findState(const WorkerState& state) const {
+    const auto entry = index.find(key(state));
+    if (entry == index.end()) {
+        return nullopt;
+    }
+    return entry->second;
+}
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <stdexcept>
+#include <string>
+#include "WorkerSpec.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+WorkerSpec::WorkerSpec(const size_t& armsN, const unordered_map<ItemPN, size_t>& neededPNQuotas,
+                       const ItemPN& productPN, const size_t& assemblyDuration) :
+        armsN(armsN),
+        assemblyDuration(assemblyDuration),
+        productPN(productPN)
+{
+    if (!armsN) {
+        throw invalid_argument(string(__func__) + ": Attempt to construct a worker object with no arms");
+    }
+    if (armsN > MaxArms) {
+        throw invalid_argument(string(__func__) + ": A worker has at most " + to_string(MaxArms) + " arms");
+    }
+    if (neededPNQuotas.size() > MaxParts) {
+        throw invalid_argument(string(__func__) + ": A worker needs at most " + to_string(MaxParts)
+                               + " part numbers");
+    }
+    if (assemblyDuration > MaxAssemblyDuration) {
+        throw invalid_argument(string(__func__) + ": Assembly duration exceeds " + to_string(MaxAssemblyDuration));
+    }
+    for (const auto& [pn, quota]: neededPNQuotas) {
+        partPNs.push_back(pn);
+        quotas.push_back(quota);
+        neededItemsCount += quota;
+    }
+    if (armsN < neededItemsCount) {
+        throw invalid_argument(string(__func__) + ": Attempt to construct a worker object with less arms than the "
+                                                  "number of needed items");
+    }
+}
+
+size_t WorkerSpec::getArmsN() const {
+    return armsN;
+}
+
+size_t WorkerSpec::getAssemblyDuration() const {
+    return assemblyDuration;
+}
+
+const ItemPN& WorkerSpec::getProductPN() const {
+    return productPN;
+}
+
+size_t WorkerSpec::getNumParts() const {
+    return partPNs.size();
+}
+
+const ItemPN& WorkerSpec::getPartPN(const size_t& part) const {
+    return partPNs[part];
+}
+
+size_t WorkerSpec::getQuota(const size_t& part) const {
+    return quotas[part];
+}
+
+size_t WorkerSpec::getNeededItemsCount() const {
+    return neededItemsCount;
+}
+
+optional<size_t> WorkerSpec::findPart(const ItemPN& pn) const {
+    for (size_t part = 0; part < partPNs.size(); part++) {
+        if (partPNs[part] == pn) {
+            return part;
+        }
+    }
+    return nullopt;
+}
@@ -2,16 +2,153 @@
 // Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
 //
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <getopt.h>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <unistd.h>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include "ABConveyorConfiguration.h"
+#include "ArbitrationPolicies.h"
+#include "CapacityOptimizer.h"
+#include "ChunkedRunner.h"
+#include "CommonRandomNumbersComparison.h"
+#include "CycleDetectingEngine.h"
+#include "EngineCalibration.h"
+#include "ForkedReplicas.h"
+#include "JobServer.h"
+#include "LiveMetrics.h"
+#include "LockstepReplicaEngine.h"
+#include "MarkovChainSolver.h"
+#include "MeanFieldApproximation.h"
+#include "MemoryPlacement.h"
+#include "OutOfCoreEngine.h"
+#include "PeriodicItemGenerator.h"
+#include "PerfCounters.h"
+#include "ShardLauncher.h"
+#include "SimulationStatistics.h"
+#include "TimeWarpEngine.h"
+#include "TraceRecorder.h"
+#include "WorkerSpec.h"
 
 using namespace std;
 using namespace conveyorsim;
 
+namespace {
+
+// getopt_long() value of the options that only have a long name
+constexpr int PerfCountersOption = 256;
+constexpr int NoHugePagesOption = 257;
+constexpr int PinThreadsOption = 258;
+constexpr int PlacementLogOption = 259;
+constexpr int CalibrateOption = 260;
+constexpr int NoCycleDetectionOption = 261;
+
+// Position updates below which the auto mode runs the sim mode rather than calibrating; probing
+// the engines takes a second or so
+constexpr double AutoMinUpdates = 1U << 30U;
+
+const option LongOptions[] = {
+        {"perf-counters", no_argument, nullptr, PerfCountersOption},
+        {"no-huge-pages", no_argument, nullptr, NoHugePagesOption},
+        {"pin-threads", no_argument, nullptr, PinThreadsOption},
+        {"placement-log", no_argument, nullptr, PlacementLogOption},
+        {"calibrate", no_argument, nullptr, CalibrateOption},
+        {"no-cycle-detection", no_argument, nullptr, NoCycleDetectionOption},
+        {nullptr, 0, nullptr, 0},
+};
+
+// Parses a decimal unsigned 64 bit integer, rejecting signs, trailing characters and overflow
+bool parseUnsigned(const string& text, uint64_t& value) {
+    if (text.empty() || text.front() < '0' || text.front() > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Parses a positive finite decimal number, rejecting trailing characters
+bool parsePositive(const string& text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    const double parsed = strtod(text.c_str(), &end);
+    if (text.empty() || errno == ERANGE || *end != '\0' || !isfinite(parsed) || !(parsed > 0)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Reports an option value parseUnsigned() rejected
+int invalidValue(const char& option, const char* value) {
+    cerr << "conveyor_sim: -" << option << " expects an unsigned 64 bit integer, got '" << value << "'" << endl;
+    return 1;
+}
+
+// Parses a comma separated list of capacity:duration pairs
+optional<vector<CommonRandomNumbersComparison::Variant>> parseVariants(const string& list) {
+    vector<CommonRandomNumbersComparison::Variant> variants;
+    istringstream in(list);
+    for (string entry; getline(in, entry, ',');) {
+        const size_t separator = entry.find(':');
+        uint64_t capacity = 0;
+        uint64_t duration = 0;
+        if (separator == string::npos || !parseUnsigned(entry.substr(0, separator), capacity)
+            || !parseUnsigned(entry.substr(separator + 1), duration) || !capacity
+            || duration > WorkerSpec::MaxAssemblyDuration) {
+            return nullopt;
+        }
+        variants.push_back({capacity, duration});
+    }
+    return variants;
+}
+
+// Traces the run into the file of -T, and ends the file when main returns, whichever mode ran
+class TraceFile {
+public:
+    TraceFile(const string& path, const uint64_t& samplePeriod) {
+        TraceRecorder::enable(samplePeriod);
+        TraceRecorder::open(path);
+        TraceRecorder::attachThread("main");
+    }
+
+    ~TraceFile() {
+        try {
+            TraceRecorder::close();
+        } catch (const exception& error) {
+            cerr << "conveyor_sim: " << error.what() << endl;
+        }
+    }
+
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+};
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     string usage = ""
-                   "usage: conveyor_sim [-h] [-n timeslots] [-c capacity] [-d duration] [-v]\n"
+                   "usage: conveyor_sim [-h] [-n timeslots] [-c capacity] [-d duration] [-s seed] [-S segments] [-m mode]\n"
+                   "                    [-L states] [-V variants] [-B batches] [-P name] [-p seconds] [-o path]\n"
+                   "                    [-k shards] [-r replicas] [-w timeslots] [-a policy] [-t target] [-u path]\n"
+                   "                    [-g pattern] [-T path] [-K period]\n"
+                   "                    [--perf-counters] [--no-huge-pages] [--pin-threads] [--placement-log]\n"
+                   "                    [--calibrate] [--no-cycle-detection] [-v]\n"
                    "\n"
                    "A simulation of a conveyor belt that conveys items which workers on either\n"
                    "side of the belt can collect and assemble products. At the beginning of each\n"
@@ -35,31 +172,262 @@ int main(int argc, char* argv[]) {
                    "-h              show this help message and exit\n"
                    "-n timeslots    number of timeslots to run the simulation (default = 1)\n"
                    "-c capacity     capacity of the conveyor belt; how many items it can carry (default = 1)\n"
-                   "-d duration     assembly duration in timeslots (default = 0)\n"
+                   "-d duration     assembly duration in timeslots, at most 2^32 - 1 (default = 0)\n"
+                   "-s seed         seed the simulation for reproducible runs (default = random)\n"
+                   "-S segments     report latency and utilization distributions over this many belt segments\n"
+                   "-m mode         auto: simulate the given number of timeslots on the engine that is fastest on this\n"
+                   "                        machine for the capacity and the duration (default); the engines are\n"
+                   "                        probed once per machine and configuration, and their rates are kept in\n"
+                   "                        $XDG_CACHE_HOME/conveyor_sim/calibration. Runs of fewer than 2^30 position\n"
+                   "                        updates, and runs with -v, -S, -P, -p, -a or --perf-counters, are run by\n"
+                   "                        the sim mode\n"
+                   "                sim: simulate the given number of timeslots\n"
+                   "                markov: compute the exact steady-state product and drop rates per timeslot\n"
+                   "                        from the Markov chain of the configuration; falls back to sim when\n"
+                   "                        the state space is larger than the state limit\n"
+                   "                meanfield: approximate the steady-state product and drop rates per\n"
+                   "                        timeslot with a mean-field density evolution along the belt; needs\n"
+                   "                        a capacity of at least 100, below which it is inaccurate\n"
+                   "                meanfield-validate: compare the meanfield approximation with simulations of\n"
+                   "                        the given number of timeslots, after the belt fills, over a grid of\n"
+                   "                        durations and of capacities from 100 to 10000\n"
+                   "                replicas: simulate 16 independent replicas of the configuration in lockstep\n"
+                   "                        for the given number of timeslots\n"
+                   "                crn: compare the configuration given by -c and -d with the variants given by\n"
+                   "                        -V over the given number of timeslots, driving all of them with the\n"
+                   "                        same generated items and worker priorities (common random numbers)\n"
+                   "                        and reporting paired differences with 95% confidence intervals\n"
+                   "                forked: simulate the configuration through the warm-up given by -w once, then fork\n"
+                   "                        the number of replicas given by -r from it, which continue from the\n"
+                   "                        warmed-up state with random streams of their own for the given number of\n"
+                   "                        timeslots\n"
+                   "                sharded: simulate the given number of timeslots with the belt split into\n"
+                   "                        contiguous segments, each run by its own process\n"
+                   "                timewarp: simulate the given number of timeslots with the belt split into\n"
+                   "                        contiguous segments, each run by its own thread, first optimistically\n"
+                   "                        (Time Warp) and then conservatively, and compare the two runs\n"
+                   "                outofcore: simulate the given number of timeslots with the state of the belt and\n"
+                   "                        its workers kept in the file given by -o, for belts too large for memory\n"
+                   "                periodic: simulate the given number of timeslots with the items repeating the pattern\n"
+                   "                        given by -g and the top and bottom workers acting first on alternate\n"
+                   "                        timeslots; once the state of the belt repeats, the counts of the\n"
+                   "                        remaining timeslots are extrapolated from the cycle\n"
+                   "                optimize: find the smallest capacity up to the one given by -c whose product\n"
+                   "                        rate meets the target given by -t, deciding every candidate with a\n"
+                   "                        sequential test over parallel replicas\n"
+                   "                serve: run jobs read from the standard input, one per line, on a thread pool and\n"
+                   "                        write their results to the standard output as they complete; a job is\n"
+                   "                        'id capacity duration timeslots seed [replicas]' with seed '-' for random\n"
+                   "                        seeds, and its result 'id ok mean-products mean-drops product-rate\n"
+                   "                        drop-rate' or 'id error message'. -c, -d, -n and -s are ignored\n"
+                   "-L states       state limit of the markov mode (default = 1000000)\n"
+                   "-V variants     variants of the crn mode as a comma separated list of capacity:duration pairs\n"
+                   "-B batches      number of batches the crn mode splits the timeslots into (default = 30)\n"
+                   "-P name         publish live metrics of the sim mode to the shared memory segment /name;\n"
+                   "                watch them with conveyor_sim_top name\n"
+                   "-o path         new state file of the outofcore mode, removed when it is done\n"
+                   "-k shards       number of segments of the sharded and timewarp modes (default = 2)\n"
+                   "-r replicas     number of replicas of the forked mode (default = 16)\n"
+                   "-w timeslots    warm-up timeslots of the forked mode (default = the capacity)\n"
+                   "-g pattern      items of the periodic mode, a character per timeslot: 'A', 'B', or '-' for no item,\n"
+                   "                as in AB-\n"
+                   "-t target       product rate per timeslot the optimize mode searches for\n"
+                   "-u path         serve jobs over connections to a Unix domain socket at this path instead of the\n"
+                   "                standard input, until SIGINT or SIGTERM\n"
+                   "-a policy       worker arbitration of the sim mode; decides which worker of a position acts first\n"
+                   "                global-random: one random draw per timeslot for the whole belt (default)\n"
+                   "                position-random: an independent random draw per position\n"
+                   "                round-robin: every position alternates between its workers\n"
+                   "                least-recently-served: the worker of a position served less recently acts first\n"
+                   "-p seconds      print the progress, throughput and remaining time of the sim mode every\n"
+                   "                this many seconds; SIGINT or SIGTERM stop the sim mode early with the statistics\n"
+                   "                of the timeslots run so far\n"
+                   "-T path         write a timeline of the phases of the timeslots every thread and shard runs to this\n"
+                   "                file, as Chrome trace events; open it in ui.perfetto.dev or chrome://tracing\n"
+                   "-K period       trace one timeslot out of this many (default = 1000)\n"
+                   "--perf-counters\n"
+                   "                count cycles, instructions, cache misses and branch misses of the timeslots of the\n"
+                   "                sim mode, and report them per timeslot and per position update; counts CPU time,\n"
+                   "                page faults, context switches and CPU migrations instead where hardware events are\n"
+                   "                not available\n"
+                   "--no-huge-pages\n"
+                   "                do not back the state arrays of large belts with huge pages\n"
+                   "--pin-threads   pin the threads of the timewarp mode, the processes of the sharded mode and the sim\n"
+                   "                mode to CPUs, one each, so that they stay on the NUMA node their segment was placed on\n"
+                   "--placement-log\n"
+                   "                log where the state arrays and threads are placed, and why, to the standard error\n"
+                   "--no-cycle-detection\n"
+                   "                run every timeslot of the periodic mode\n"
+                   "--calibrate     probe the engines of the auto mode even if their rates are kept, and keep the new\n"
+                   "                rates; probes even runs the auto mode would leave to the sim mode\n"
                    "-v              verbose; print information about the simulation at the end of each timeslot\n";
 
-    size_t numSlots = 1;
-    size_t convSize = 1;
-    size_t assemblyDuration = 0;
+    uint64_t numSlots = 1;
+    uint64_t convSize = 1;
+    uint64_t assemblyDuration = 0;
+    optional<uint64_t> seed = nullopt;
+    uint64_t numSegments = 0;
+    string mode = "auto";
+    uint64_t maxStates = 1000000;
+    vector<CommonRandomNumbersComparison::Variant> variants;
+    uint64_t numBatches = 30;
+    string metricsName;
+    uint64_t progressInterval = 0;
+    uint64_t numShards = 2;
+    uint64_t numReplicas = 16;
+    optional<uint64_t> warmupSlots;
+    ArbitrationPolicy arbitration = ArbitrationPolicy::GlobalRandom;
+    double targetRate = 0;
+    string socketPath;
+    string tracePath;
+    string statePath;
+    uint64_t tracePeriod = 1000;
+    bool perfCounters = false;
+    MemoryPlacementSettings placement;
+    bool calibrate = false;
+    string itemPattern;
+    bool detectCycles = true;
 
     bool verbose = false;
 
     for(;;) {
-        switch(getopt(argc, argv, "hn:c:d:v")) {
+        switch(getopt_long(argc, argv, "hn:c:d:s:S:m:L:V:B:P:p:k:r:w:g:a:t:u:T:K:o:v", LongOptions, nullptr)) {
             case 'h':
                 cout << usage << endl;
                 return 0;
             case 'n':
-                numSlots = atoi(optarg);
+                if (!parseUnsigned(optarg, numSlots)) {
+                    return invalidValue('n', optarg);
+                }
                 continue;
             case 'c':
-                convSize = atoi(optarg);
+                if (!parseUnsigned(optarg, convSize)) {
+                    return invalidValue('c', optarg);
+                }
                 continue;
             case 'v':
                 verbose = true;
                 continue;
             case 'd':
-                assemblyDuration = atoi(optarg);
+                if (!parseUnsigned(optarg, assemblyDuration)) {
+                    return invalidValue('d', optarg);
+                }
+                if (assemblyDuration > WorkerSpec::MaxAssemblyDuration) {
+                    cerr << "conveyor_sim: -d must not exceed " << WorkerSpec::MaxAssemblyDuration << endl;
+                    return 1;
+                }
+                continue;
+            case 's':
+                seed = 0;
+                if (!parseUnsigned(optarg, seed.value())) {
+                    return invalidValue('s', optarg);
+                }
+                continue;
+            case 'S':
+                if (!parseUnsigned(optarg, numSegments)) {
+                    return invalidValue('S', optarg);
+                }
+                continue;
+            case 'm':
+                mode = optarg;
+                continue;
+            case 'L':
+                if (!parseUnsigned(optarg, maxStates)) {
+                    return invalidValue('L', optarg);
+                }
+                continue;
+            case 'V': {
+                const auto parsed = parseVariants(optarg);
+                if (!parsed.has_value()) {
+                    cerr << "conveyor_sim: -V expects a comma separated list of capacity:duration pairs, got '"
+                         << optarg << "'" << endl;
+                    return 1;
+                }
+                variants = parsed.value();
+                continue;
+            }
+            case 'B':
+                if (!parseUnsigned(optarg, numBatches)) {
+                    return invalidValue('B', optarg);
+                }
+                continue;
+            case 'P':
+                metricsName = optarg;
+                continue;
+            case 'k':
+                if (!parseUnsigned(optarg, numShards)) {
+                    return invalidValue('k', optarg);
+                }
+                continue;
+            case 'r':
+                if (!parseUnsigned(optarg, numReplicas)) {
+                    return invalidValue('r', optarg);
+                }
+                continue;
+            case 'w':
+                warmupSlots = 0;
+                if (!parseUnsigned(optarg, warmupSlots.value())) {
+                    return invalidValue('w', optarg);
+                }
+                continue;
+            case 'g':
+                itemPattern = optarg;
+                continue;
+            case 'a': {
+                const auto parsed = parseArbitrationPolicy(optarg);
+                if (!parsed.has_value()) {
+                    cerr << "conveyor_sim: unknown arbitration policy '" << optarg << "'" << endl;
+                    return 1;
+                }
+                arbitration = parsed.value();
+                continue;
+            }
+            case 't':
+                if (!parsePositive(optarg, targetRate)) {
+                    cerr << "conveyor_sim: -t expects a positive number, got '" << optarg << "'" << endl;
+                    return 1;
+                }
+                continue;
+            case 'u':
+                socketPath = optarg;
+                continue;
+            case 'T':
+                tracePath = optarg;
+                continue;
+            case 'o':
+                statePath = optarg;
+                continue;
+            case 'K':
+                if (!parseUnsigned(optarg, tracePeriod)) {
+                    return invalidValue('K', optarg);
+                }
+                if (!tracePeriod) {
+                    cerr << "conveyor_sim: -K must not be 0" << endl;
+                    return 1;
+                }
+                continue;
+            case 'p':
+                if (!parseUnsigned(optarg, progressInterval)) {
+                    return invalidValue('p', optarg);
+                }
+                continue;
+            case PerfCountersOption:
+                perfCounters = true;
+                continue;
+            case NoHugePagesOption:
+                placement.hugePages = false;
+                continue;
+            case PinThreadsOption:
+                placement.pinThreads = true;
+                continue;
+            case PlacementLogOption:
+                placement.log = &cerr;
+                continue;
+            case CalibrateOption:
+                calibrate = true;
+                continue;
+            case NoCycleDetectionOption:
+                detectCycles = false;
                 continue;
             default:
                 cout << usage << endl;
@@ -70,23 +438,393 @@ int main(int argc, char* argv[]) {
         break;
     }
 
+    MemoryPlacement::configure(placement);
+
+    optional<TraceFile> trace;
+    if (!tracePath.empty()) {
+        try {
+            trace.emplace(tracePath, tracePeriod);
+        } catch (const system_error& error) {
+            cerr << "conveyor_sim: " << error.what() << endl;
+            return 1;
+        }
+    }
+
+    if (mode == "serve") {
+        JobServer server;
+        if (socketPath.empty()) {
+            server.serve(cin, cout);
+        } else {
+            ChunkedRunner::installSignalHandlers();
+            server.listen(socketPath);
+        }
+        return 0;
+    }
+
     if(!numSlots || !convSize) {
         return 0;
     }
 
-    ABConveyorConfiguration sim(convSize, assemblyDuration);
+    if (mode == "auto") {
+        // Only the sim mode reports per timeslot, statistics and live metrics, and arbitrates
+        // other than with a global random draw
+        const bool simOnly = verbose || numSegments || !metricsName.empty() || progressInterval || perfCounters
+                             || arbitration != ArbitrationPolicy::GlobalRandom;
+        if (simOnly || (!calibrate && static_cast<double>(numSlots) * convSize < AutoMinUpdates)) {
+            mode = "sim";
+        }
+    }
+
+    if (mode == "markov") {
+        const auto result = MarkovChainSolver(convSize, assemblyDuration, maxStates).solve();
+        if (result.has_value()) {
+            cout << "States: " << result->numStates << endl;
+            cout << "Iterations: " << result->iterations << " (residual " << result->residual << ")" << endl;
+            cout << "Product rate: " << result->productRate << " per timeslot" << endl;
+            cout << "Drop rate: " << result->dropRate << " per timeslot" << endl;
+            cout << "Expected product count: " << result->productRate * numSlots << endl;
+            cout << "Expected drop count: " << result->dropRate * numSlots << endl;
+            return 0;
+        }
+        cout << "State space exceeds " << maxStates << " states; falling back to simulation" << endl;
+    } else if (mode == "meanfield") {
+        if (convSize < MeanFieldApproximation::MinCapacity) {
+            cerr << "conveyor_sim: -m meanfield needs a capacity of at least " << MeanFieldApproximation::MinCapacity
+                 << "; use -m markov or sim for shorter belts" << endl;
+            return 1;
+        }
+        const auto result = MeanFieldApproximation(convSize, assemblyDuration).solve();
+        cout << "Positions: " << result.exactPositions << " evaluated, " << result.fluidSteps << " fluid steps"
+             << endl;
+        cout << "Product rate: " << result.productRate << " per timeslot" << endl;
+        cout << "Drop rate: " << result.dropRate << " per timeslot" << endl;
+        cout << "Expected product count: " << result.productRate * numSlots << endl;
+        cout << "Expected drop count: " << result.dropRate * numSlots << endl;
+        return 0;
+    } else if (mode == "meanfield-validate") {
+        cout << "capacity duration product(mf) product(sim) error drop(mf) drop(sim) error" << endl;
+        for (const auto& point: MeanFieldApproximation::validate(numSlots, seed.value_or(random_device()()))) {
+            const auto& mf = point.approximation;
+            cout << point.capacity << " " << point.assemblyDuration << " "
+                 << mf.productRate << " " << point.simulatedProductRate << " "
+                 << mf.productRate - point.simulatedProductRate << " "
+                 << mf.dropRate << " " << point.simulatedDropRate << " "
+                 << mf.dropRate - point.simulatedDropRate << endl;
+        }
+        return 0;
+    } else if (mode == "sharded") {
+        if (!numShards || numShards > convSize) {
+            cerr << "conveyor_sim: -k must be between 1 and the capacity of the belt" << endl;
+            return 1;
+        }
+        // All shards must draw the same worker priorities, so they need a seed in common
+        const auto result = ShardLauncher(convSize, assemblyDuration, numShards, seed.value_or(random_device()()))
+                .run(numSlots);
+        cout << "Product count: " << result.productCount << endl;
+        cout << "Drop count: " << result.dropCount << endl;
+        return 0;
+    } else if (mode == "timewarp") {
+        if (!numShards || numShards > convSize) {
+            cerr << "conveyor_sim: -k must be between 1 and the capacity of the belt" << endl;
+            return 1;
+        }
+        const uint64_t runSeed = seed.value_or(random_device()());
+        for (const bool& optimistic: {true, false}) {
+            TimeWarpEngine::Settings settings;
+            settings.optimistic = optimistic;
+            const auto result = TimeWarpEngine(convSize, assemblyDuration, numShards, runSeed, settings)
+                    .run(numSlots);
+            cout << (optimistic ? "Optimistic" : "Conservative") << ": product count: " << result.productCount
+                 << ", drop count: " << result.dropCount << ", " << result.seconds << " s" << endl;
+            cout << "    executed timeslots: " << result.executedSlots << " (" << result.predictedSlots
+                 << " predicted), rollbacks: " << result.rollbacks << " (" << result.rolledBackSlots
+                 << " timeslots)";
+            if (result.executedSlots) {
+                cout << ", efficiency: " << static_cast<double>(numSlots * numShards) / result.executedSlots;
+            }
+            cout << endl;
+        }
+        return 0;
+    } else if (mode == "outofcore") {
+        if (statePath.empty()) {
+            cerr << "conveyor_sim: the outofcore mode needs a state file (-o)" << endl;
+            return 1;
+        }
+        try {
+            OutOfCoreEngine engine(convSize, assemblyDuration, seed.value_or(random_device()()), statePath);
+            // Stopping between passes leaves the engine to remove its file
+            ChunkedRunner::installSignalHandlers();
+            const size_t passSlots = OutOfCoreEngine::Settings().chunkSlots;
+            uint64_t slotsRun = 0;
+            OutOfCoreEngine::Result result = engine.run(0);
+            while (slotsRun < numSlots && !ChunkedRunner::stopRequested()) {
+                result = engine.run(min<uint64_t>(passSlots, numSlots - slotsRun));
+                slotsRun += min<uint64_t>(passSlots, numSlots - slotsRun);
+            }
+            if (slotsRun < numSlots) {
+                cout << "Stopped after " << slotsRun << " of " << numSlots << " timeslots" << endl;
+            }
+            cout << "Product count: " << result.productCount << endl;
+            cout << "Drop count: " << result.dropCount << endl;
+            cout << "Passes: " << result.passes << ", read: " << result.bytesRead / (1U << 20U) << " MiB, written: "
+                 << result.bytesWritten / (1U << 20U) << " MiB, " << result.seconds << " s" << endl;
+        } catch (const invalid_argument& error) {
+            cerr << "conveyor_sim: " << error.what() << endl;
+            return 1;
+        } catch (const system_error& error) {
+            cerr << "conveyor_sim: " << error.what() << endl;
+            return 1;
+        }
+        return ChunkedRunner::getStopSignal() ? 128 + ChunkedRunner::getStopSignal() : 0;
+    } else if (mode == "auto") {
+        const auto profilePath = EngineCalibration::getDefaultProfilePath();
+        const auto selection = EngineCalibration(convSize, assemblyDuration, max(1U, thread::hardware_concurrency()),
+                                                 profilePath.value_or("")).select(calibrate);
+        const auto describe = [](const EngineChoice& engine) {
+            return EngineCalibration::getName(engine.kind) + ", " + to_string(engine.threads)
+                   + (engine.threads == 1 ? " thread" : " threads");
+        };
+        cerr << "Engine: " << describe(selection.engine) << " (" << (selection.cached ? "kept" : "measured")
+             << " rates";
+        if (profilePath.has_value()) {
+            cerr << ", " << profilePath.value();
+        }
+        cerr << ")" << endl;
+        for (const auto& probe: selection.probes) {
+            cerr << "    " << describe(probe.engine) << ": " << probe.updatesPerSecond << " position updates/s"
+                 << endl;
+        }
+        // The sim mode runs the Worker objects
+        if (selection.engine.kind != EngineKind::Objects) {
+            // The engines end all segments at the same timeslot on a stop
+            ChunkedRunner::installSignalHandlers();
+            // All segments must draw the same worker priorities, so they need a seed in common
+            const auto result = EngineCalibration::run(selection.engine, convSize, assemblyDuration,
+                                                       seed.value_or(random_device()()), numSlots);
+            if (result.numSlots < numSlots) {
+                cout << "Stopped after " << result.numSlots << " of " << numSlots << " timeslots" << endl;
+            }
+            cout << "Product count: " << result.productCount << endl;
+            cout << "Drop count: " << result.dropCount << endl;
+            return ChunkedRunner::getStopSignal() ? 128 + ChunkedRunner::getStopSignal() : 0;
+        }
+    } else if (mode == "forked") {
+        if (!numReplicas) {
+            cerr << "conveyor_sim: -r must not be 0" << endl;
+            return 1;
+        }
+        // By default, until the first items made it through the belt
+        const auto result = ForkedReplicas(convSize, assemblyDuration, numReplicas, seed.value_or(random_device()()))
+                .run(warmupSlots.value_or(convSize), numSlots);
+        uint64_t products = 0;
+        uint64_t drops = 0;
+        for (size_t replica = 0; replica < result.replicas.size(); replica++) {
+            cout << "Replica " << replica << ": product count: " << result.replicas[replica].productCount
+                 << ", drop count: " << result.replicas[replica].dropCount << endl;
+            products += result.replicas[replica].productCount;
+            drops += result.replicas[replica].dropCount;
+        }
+        cout << "Mean product count: " << static_cast<double>(products) / numReplicas << endl;
+        cout << "Mean drop count: " << static_cast<double>(drops) / numReplicas << endl;
+        cout << "Warm-up: " << warmupSlots.value_or(convSize) << " timeslots, " << result.warmupSeconds
+             << " s; replicas: " << result.replicaSeconds << " s" << endl;
+        return 0;
+    } else if (mode == "periodic") {
+        const auto pattern = parseItemPattern(itemPattern);
+        if (!pattern.has_value() || itemPattern.find_first_not_of("AB-") != string::npos) {
+            cerr << "conveyor_sim: the periodic mode needs a pattern of 'A', 'B' and '-' (-g)" << endl;
+            return 1;
+        }
+        const auto result = CycleDetectingEngine(convSize, assemblyDuration, PeriodicItemGenerator(pattern.value()),
+                                                 {true, false}, detectCycles).run(numSlots);
+        cout << "Product count: " << result.productCount << endl;
+        cout << "Drop count: " << result.dropCount << endl;
+        if (result.cycleLength) {
+            cout << "Cycle: " << result.cycleLength << " timeslots, found after " << result.detectionSlot
+                 << " timeslots; " << result.simulatedSlots << " timeslots simulated, " << result.seconds << " s"
+                 << endl;
+        } else {
+            cout << (detectCycles ? "No cycle; " : "") << result.simulatedSlots << " timeslots simulated, "
+                 << result.seconds << " s" << endl;
+        }
+        return 0;
+    } else if (mode == "optimize") {
+        if (!targetRate) {
+            cerr << "conveyor_sim: the optimize mode needs a target rate (-t)" << endl;
+            return 1;
+        }
+        const auto result = CapacityOptimizer(assemblyDuration, targetRate, convSize, seed).run();
+        cout << "capacity product-rate decision observations timeslots" << endl;
+        for (const auto& decision: result.decisions) {
+            cout << decision.capacity << " " << decision.productRate << " "
+                 << (decision.meetsTarget ? "meets" : "misses") << (decision.truncated ? "(truncated)" : "") << " "
+                 << decision.observations << " " << decision.slots << endl;
+        }
+        if (result.capacity.has_value()) {
+            cout << "Minimal capacity: " << result.capacity.value() << endl;
+        } else {
+            cout << "No capacity up to " << convSize << " meets the target" << endl;
+        }
+        cout << "Confidence: " << result.confidence << endl;
+        cout << "Total timeslots: " << result.totalSlots << " over all replicas" << endl;
+        return 0;
+    } else if (mode == "replicas") {
+        LockstepReplicaEngine engine(convSize, assemblyDuration, seed);
+        engine.run(numSlots);
+        size_t products = 0;
+        size_t drops = 0;
+        for (size_t lane = 0; lane < LockstepReplicaEngine::Lanes; lane++) {
+            cout << "Replica " << lane << ": product count: " << engine.getProductCount(lane)
+                 << ", drop count: " << engine.getDropCount(lane) << endl;
+            products += engine.getProductCount(lane);
+            drops += engine.getDropCount(lane);
+        }
+        cout << "Mean product count: " << static_cast<double>(products) / LockstepReplicaEngine::Lanes << endl;
+        cout << "Mean drop count: " << static_cast<double>(drops) / LockstepReplicaEngine::Lanes << endl;
+        return 0;
+    } else if (mode == "crn") {
+        variants.insert(variants.begin(), {convSize, assemblyDuration});
+        // Warm up until the first items made it through the longest belt
+        size_t warmupSlots = 0;
+        for (const auto& variant: variants) {
+            warmupSlots = max(warmupSlots, variant.capacity);
+        }
+        if (numBatches < 2 || numSlots < warmupSlots + numBatches) {
+            cout << "The crn mode needs at least 2 batches and a timeslot per batch after " << warmupSlots
+                 << " warm-up timeslots" << endl;
+            return 0;
+        }
+        const auto result = CommonRandomNumbersComparison(variants, seed).run(numSlots, numBatches, warmupSlots);
+        cout << "Timeslots: " << result.warmupSlots << " warm-up, " << result.numBatches << " batches of "
+             << result.batchSlots << endl;
+        cout << "capacity duration products drops product-rate +/- drop-rate +/-" << endl;
+        for (const auto& variant: result.variants) {
+            cout << variant.variant.capacity << " " << variant.variant.assemblyDuration << " "
+                 << variant.productCount << " " << variant.dropCount << " "
+                 << variant.productRate.mean << " " << variant.productRate.halfWidth << " "
+                 << variant.dropRate.mean << " " << variant.dropRate.halfWidth << endl;
+        }
+        if (!result.differences.empty()) {
+            cout << "Paired differences against capacity " << convSize << " duration " << assemblyDuration
+                 << " (reduction: times fewer timeslots than independent runs for the same precision):" << endl;
+            cout << "capacity duration product-rate +/- reduction drop-rate +/- reduction" << endl;
+            for (const auto& difference: result.differences) {
+                cout << difference.variant.capacity << " " << difference.variant.assemblyDuration << " "
+                     << difference.productRate.mean << " " << difference.productRate.halfWidth << " "
+                     << difference.productVarianceReduction << " "
+                     << difference.dropRate.mean << " " << difference.dropRate.halfWidth << " "
+                     << difference.dropVarianceReduction << endl;
+            }
+        }
+        return 0;
+    } else if (mode != "sim") {
+        cout << usage << endl;
+        return 0;
+    }
+
+    MemoryPlacement::placeThread(0, "main");
+    ABConveyorConfiguration sim(convSize, assemblyDuration, seed, arbitration);
+    if (numSegments) {
+        sim.enableStatistics(numSegments);
+    }
+
+    unique_ptr<LiveMetricsPublisher> publisher;
+    if (!metricsName.empty()) {
+        publisher = make_unique<LiveMetricsPublisher>(metricsName);
+    }
+
+    // Chunks of about a million position updates make the work between chunks negligible;
+    // verbose runs print every timeslot anyway
+    const uint64_t chunkSlots = verbose ? 1 : max<uint64_t>(1, (1U << 20U) / convSize);
+    const auto start = chrono::steady_clock::now();
+    auto lastPublished = start;
+    auto lastProgress = start;
+    uint64_t lastPublishedSlot = 0;
+
+    const auto publish = [&](const uint64_t& slot, const chrono::steady_clock::time_point& now,
+                             const bool& finished) {
+        const chrono::duration<double> elapsed = now - lastPublished;
+        LiveMetrics metrics;
+        metrics.slot = slot;
+        metrics.numSlots = numSlots;
+        metrics.productCount = sim.getProductCount();
+        metrics.dropCount = sim.getDropCount();
+        metrics.occupiedPositions = sim.getOccupiedPositions();
+        metrics.capacity = convSize;
+        metrics.slotsPerSecond = elapsed.count() > 0 ? (slot - lastPublishedSlot) / elapsed.count() : 0;
+        metrics.finished = finished;
+        publisher->publish(metrics);
+        lastPublished = now;
+        lastPublishedSlot = slot;
+    };
 
-    if (verbose) {
-        for (size_t slot = 0; slot < numSlots; slot++) {
-            sim.run(1);
+    const auto afterChunk = [&](const uint64_t& slot) {
+        if (verbose) {
             cout << sim << endl;
         }
-    } else {
-        sim.run(numSlots);
+        if (!publisher && !progressInterval) {
+            return;
+        }
+        const auto now = chrono::steady_clock::now();
+        if (publisher) {
+            publish(slot, now, false);
+        }
+        if (progressInterval && now - lastProgress >= chrono::seconds(progressInterval)) {
+            const chrono::duration<double> elapsed = now - start;
+            const double slotsPerSecond = slot / elapsed.count();
+            cerr << "Progress: " << slot << " of " << numSlots << " timeslots ("
+                 << 100.0 * slot / numSlots << "%), " << slotsPerSecond << " timeslots/s, ETA "
+                 << (numSlots - slot) / slotsPerSecond << " s" << endl;
+            lastProgress = now;
+        }
+    };
+
+    optional<PerfCounters> counters;
+    if (perfCounters) {
+        try {
+            counters.emplace();
+            if (!counters->isHardware()) {
+                cerr << "conveyor_sim: hardware events are not available, counting software events" << endl;
+            }
+        } catch (const system_error& error) {
+            cerr << "conveyor_sim: performance counters are not available: " << error.what() << endl;
+        }
+    }
+
+    ChunkedRunner::installSignalHandlers();
+    // Only the chunks are counted, not the reporting in between
+    if (counters) {
+        counters->start();
+    }
+    const uint64_t slotsRun = ChunkedRunner(chunkSlots).run(sim, numSlots, [&](const uint64_t& slot) {
+        if (counters) {
+            counters->stop();
+        }
+        afterChunk(slot);
+        if (counters) {
+            counters->start();
+        }
+    });
+    if (counters) {
+        counters->stop();
+    }
+    if (publisher) {
+        publish(slotsRun, chrono::steady_clock::now(), true);
+    }
+    if (slotsRun < numSlots) {
+        cout << "Stopped after " << slotsRun << " of " << numSlots << " timeslots" << endl;
     }
 
     cout << "Product count: " << sim.getProductCount() << endl;
     cout << "Drop count: " << sim.getDropCount() << endl;
+    if (sim.getStatistics()) {
+        cout << "***** Latency and Utilization: *****" << endl;
+        cout << *sim.getStatistics() << endl;
+    }
+    if (counters) {
+        cout << "***** Performance Counters: *****" << endl;
+        counters->report(cout, slotsRun, slotsRun * convSize);
+    }
 
-    return 0;
+    return ChunkedRunner::getStopSignal() ? 128 + ChunkedRunner::getStopSignal() : 0;
 }
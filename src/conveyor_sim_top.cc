@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <signal.h>
+#include <unistd.h>
+#include "LiveMetrics.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+int main(int argc, char* argv[]) {
+    string usage = ""
+                   "usage: conveyor_sim_top [-h] [-i milliseconds] [-1] name\n"
+                   "\n"
+                   "Watches the live metrics that a conveyor_sim run started with \"-P name\"\n"
+                   "publishes: the timeslots run so far, timeslots per second, the product and\n"
+                   "drop counts and the occupancy of the belt. Reading the metrics does not\n"
+                   "interfere with the simulation. Exits once the simulation finishes.\n"
+                   "\n"
+                   "optional arguments:\n"
+                   "-h              show this help message and exit\n"
+                   "-i milliseconds refresh interval (default = 1000)\n"
+                   "-1              print the current metrics once and exit\n";
+
+    size_t interval = 1000;
+    bool once = false;
+
+    for(;;) {
+        switch(getopt(argc, argv, "hi:1")) {
+            case 'h':
+                cout << usage << endl;
+                return 0;
+            case 'i':
+                interval = atoi(optarg);
+                continue;
+            case '1':
+                once = true;
+                continue;
+            default:
+                cout << usage << endl;
+                return 2;
+            case -1:
+                break;
+        }
+        break;
+    }
+    if (optind + 1 != argc) {
+        cout << usage << endl;
+        return 2;
+    }
+
+    try {
+        const LiveMetricsReader reader(argv[optind]);
+        cout << setw(14) << "slot" << setw(8) << "done" << setw(14) << "slots/s" << setw(10) << "eta(s)"
+             << setw(14) << "products" << setw(12) << "drops" << setw(10) << "occupied" << endl;
+        for (;;) {
+            const LiveMetrics metrics = reader.read();
+            const double done = metrics.numSlots ? 100.0 * metrics.slot / metrics.numSlots : 0;
+            const double eta = metrics.slotsPerSecond > 0 ? (metrics.numSlots - metrics.slot) / metrics.slotsPerSecond : 0;
+            const double occupied = metrics.capacity ? 100.0 * metrics.occupiedPositions / metrics.capacity : 0;
+            cout << fixed << setprecision(1)
+                 << setw(14) << metrics.slot << setw(7) << done << "%" << setw(14) << setprecision(0)
+                 << metrics.slotsPerSecond << setw(10) << eta << setw(14) << metrics.productCount
+                 << setw(12) << metrics.dropCount << setw(9) << setprecision(1) << occupied << "%"
+                 << (metrics.torn ? " (torn)" : "") << endl;
+            if (once || metrics.finished) {
+                return 0;
+            }
+            // The publisher removes the segment when it exits, but a crashed one leaves it behind
+            if (kill(static_cast<pid_t>(reader.getPublisherPid()), 0) < 0 && errno == ESRCH) {
+                cout << "The simulation exited before finishing" << endl;
+                return 1;
+            }
+            this_thread::sleep_for(chrono::milliseconds(interval));
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "ABConveyorConfiguration.h"
+#include "conveyorsim.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+struct conveyorsim_config {
+    ABConveyorConfiguration sim;
+    uint64_t slots;
+};
+
+namespace {
+
+// Sizes of the structures of every ABI version the library accepts
+constexpr size_t ParamsSizes[] = {sizeof(conveyorsim_params)};
+constexpr size_t BatchEntrySizes[] = {sizeof(conveyorsim_batch_entry)};
+
+template <size_t N>
+bool isKnownSize(const size_t& size, const size_t (&sizes)[N]) {
+    return find(begin(sizes), end(sizes), size) != end(sizes);
+}
+
+optional<uint64_t> seedOf(const uint64_t& seed, const int32_t& seeded) {
+    return seeded ? optional(seed) : nullopt;
+}
+
+// Runs a function and turns whatever it throws into a status, so that no exception crosses
+// the C interface
+template <typename Function>
+conveyorsim_status guarded(const Function& function) {
+    try {
+        function();
+        return CONVEYORSIM_OK;
+    } catch (const invalid_argument&) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    } catch (const bad_alloc&) {
+        return CONVEYORSIM_OUT_OF_MEMORY;
+    } catch (...) {
+        return CONVEYORSIM_ERROR;
+    }
+}
+
+void readCounters(const conveyorsim_config& config, conveyorsim_counters& counters) {
+    counters.slots = config.slots;
+    counters.product_count = config.sim.getProductCount();
+    counters.drop_count = config.sim.getDropCount();
+    counters.occupied_positions = config.sim.getOccupiedPositions();
+}
+
+void runEntry(conveyorsim_batch_entry& entry) {
+    entry.counters = conveyorsim_counters{};
+    if (!isKnownSize(entry.struct_size, BatchEntrySizes)) {
+        entry.status = CONVEYORSIM_INVALID_ARGUMENT;
+        return;
+    }
+    conveyorsim_config* config = nullptr;
+    entry.status = conveyorsim_create(&entry.params, &config);
+    if (entry.status == CONVEYORSIM_OK) {
+        entry.status = conveyorsim_run(config, entry.num_slots);
+    }
+    if (entry.status == CONVEYORSIM_OK) {
+        entry.status = conveyorsim_read(config, &entry.counters);
+    }
+    conveyorsim_destroy(config);
+}
+
+} // namespace
+
+uint32_t conveyorsim_abi_version() {
+    return CONVEYORSIM_ABI_VERSION;
+}
+
+const char* conveyorsim_status_string(conveyorsim_status status) {
+    switch (status) {
+        case CONVEYORSIM_OK:
+            return "success";
+        case CONVEYORSIM_INVALID_ARGUMENT:
+            return "invalid argument";
+        case CONVEYORSIM_OUT_OF_MEMORY:
+            return "out of memory";
+        case CONVEYORSIM_ERROR:
+            break;
+    }
+    return "error";
+}
+
+conveyorsim_status conveyorsim_create(const conveyorsim_params* params, conveyorsim_config** config) {
+    if (!params || !config || !isKnownSize(params->struct_size, ParamsSizes) || !params->capacity) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        *config = new conveyorsim_config{
+                ABConveyorConfiguration(params->capacity, params->assembly_duration,
+                                        seedOf(params->seed, params->seeded)),
+                0};
+    });
+}
+
+void conveyorsim_destroy(conveyorsim_config* config) {
+    delete config;
+}
+
+conveyorsim_status conveyorsim_run(conveyorsim_config* config, uint64_t num_slots) {
+    if (!config) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        config->sim.run(num_slots);
+        config->slots += num_slots;
+    });
+}
+
+conveyorsim_status conveyorsim_read(const conveyorsim_config* config, conveyorsim_counters* counters) {
+    if (!config || !counters) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        readCounters(*config, *counters);
+    });
+}
+
+conveyorsim_status conveyorsim_reset(conveyorsim_config* config, uint64_t seed, int32_t seeded) {
+    if (!config) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    return guarded([&]() {
+        config->sim.reset(seedOf(seed, seeded));
+        config->slots = 0;
+    });
+}
+
+conveyorsim_status conveyorsim_run_batch(conveyorsim_batch_entry* entries, size_t count, uint32_t num_threads) {
+    if (!entries && count) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    // Entries of an unknown size cannot even be stepped through
+    if (count && !isKnownSize(entries[0].struct_size, BatchEntrySizes)) {
+        return CONVEYORSIM_INVALID_ARGUMENT;
+    }
+    const size_t hardwareThreads = max(1U, thread::hardware_concurrency());
+    const size_t numThreads = min<size_t>(num_threads ? num_threads : hardwareThreads, count);
+
+    atomic<size_t> next(0);
+    const auto work = [&]() {
+        for (size_t idx = next++; idx < count; idx = next++) {
+            runEntry(entries[idx]);
+        }
+    };
+
+    // The calling thread is one of the workers; if fewer threads can be started than asked
+    // for, the ones that did start share the entries
+    vector<thread> threads;
+    for (size_t idx = 1; idx < numThreads; idx++) {
+        try {
+            threads.emplace_back(work);
+        } catch (...) {
+            break;
+        }
+    }
+    work();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    return CONVEYORSIM_OK;
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <bitset>
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "ArbitrationPolicies.h"
+#include "Seeding.h"
+#include "UniformRandomItemGenerator.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// The global policy draws what ABConveyorConfiguration always drew and orders the whole belt alike
+TEST(ArbitrationPoliciesTest, GlobalRandomArbitrationTest) {
+    GlobalRandomArbitration policy(5);
+    mt19937 rng(5);
+    uniform_int_distribution<size_t> udst(0, 2);
+    vector<uint64_t> topFirst(3);
+    for (size_t slot = 0; slot < 100; slot++) {
+        policy.arbitrate(topFirst);
+        ASSERT_EQ(topFirst, vector<uint64_t>(3, udst(rng) % 2 ? ~0ULL : 0));
+    }
+}
+
+// Every position gets its own fair coin, from 64 bit words
+TEST(ArbitrationPoliciesTest, PositionRandomArbitrationTest) {
+    PositionRandomArbitration policy(5);
+    vector<uint64_t> topFirst(2);
+    size_t topFirstCount = 0;
+    size_t mixedSlots = 0;
+    const size_t numSlots = 1000;
+    for (size_t slot = 0; slot < numSlots; slot++) {
+        policy.arbitrate(topFirst);
+        const size_t count = bitset<64>(topFirst[0]).count() + bitset<64>(topFirst[1]).count();
+        topFirstCount += count;
+        mixedSlots += count && count < 128;
+    }
+    ASSERT_EQ(mixedSlots, numSlots);
+    ASSERT_NEAR(static_cast<double>(topFirstCount) / (128 * numSlots), 0.5, 0.01);
+}
+
+// Every position alternates, neighbours in opposite phase
+TEST(ArbitrationPoliciesTest, RoundRobinArbitrationTest) {
+    RoundRobinArbitration policy(70);
+    vector<uint64_t> topFirst(2);
+    policy.arbitrate(topFirst);
+    const auto first = topFirst;
+    ASSERT_EQ(first[0] & 3U, 1U);
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst[0], ~first[0]);
+    ASSERT_EQ(topFirst[1], ~first[1]);
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst, first);
+}
+
+// The worker served last waits for the other one
+TEST(ArbitrationPoliciesTest, LeastRecentlyServedArbitrationTest) {
+    LeastRecentlyServedArbitration policy(3);
+    ASSERT_TRUE(policy.tracksService());
+    vector<uint64_t> topFirst(1);
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst[0] & 7U, 7U);
+
+    // The top worker of position 0 and the bottom worker of position 1 were served
+    policy.served({1}, {2});
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst[0] & 7U, 6U);
+
+    // Nobody was served: the order stays
+    policy.served({0}, {0});
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst[0] & 7U, 6U);
+
+    // The bottom worker of position 0 was served
+    policy.served({0}, {1});
+    policy.arbitrate(topFirst);
+    ASSERT_EQ(topFirst[0] & 7U, 7U);
+}
+
+// Every policy runs a seeded configuration reproducibly and lets the workers assemble products
+TEST(ArbitrationPoliciesTest, ArbitrationPolicyConfigurationTest) {
+    for (const auto name: {"global-random", "position-random", "round-robin", "least-recently-served"}) {
+        const auto policy = parseArbitrationPolicy(name);
+        ASSERT_TRUE(policy.has_value());
+        ABConveyorConfiguration first(70, 3, 11, policy.value());
+        ABConveyorConfiguration second(70, 3, 11, policy.value());
+        first.run(5000);
+        second.run(5000);
+        ASSERT_EQ(first.getProductCount(), second.getProductCount());
+        ASSERT_EQ(first.getDropCount(), second.getDropCount());
+        ASSERT_GT(first.getProductCount(), 0);
+    }
+    ASSERT_FALSE(parseArbitrationPolicy("fifo").has_value());
+}
+
+// The default policy is the global one on the worker priority stream
+TEST(ArbitrationPoliciesTest, ArbitrationPolicyDefaultTest) {
+    ABConveyorConfiguration byDefault(9, 2, 4);
+    ABConveyorConfiguration bySlot(9, 2, 4);
+    UniformRandomItemGenerator generator({ItemPN('A'), ItemPN('B')}, true,
+                                         deriveSeed(4, RandomStream::ItemGeneration));
+    GlobalRandomArbitration policy(deriveSeed(4, RandomStream::WorkerPriority));
+    vector<uint64_t> topFirst(1);
+    for (size_t slot = 0; slot < 2000; slot++) {
+        const auto item = generator.get_next_item();
+        policy.arbitrate(topFirst);
+        bySlot.runSlot(item.has_value() ? optional(item.value().getPN()) : nullopt, topFirst);
+    }
+    byDefault.run(2000);
+    ASSERT_EQ(byDefault.getProductCount(), bySlot.getProductCount());
+    ASSERT_EQ(byDefault.getDropCount(), bySlot.getDropCount());
+}
@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "BeltShard.h"
+#include "ChunkedRunner.h"
+#include "ShardLauncher.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// An unbounded in-process transport, which lets the segments run one after the other
+class QueueChannel : public BoundaryChannelIF {
+public:
+    void send(const optional<ItemPN>& item) override {
+        items.push_back(item);
+    }
+    [[nodiscard]] optional<ItemPN> receive() override {
+        const auto item = items.front();
+        items.pop_front();
+        return item;
+    }
+private:
+    deque<optional<ItemPN>> items;
+};
+
+// Segments connected by any transport must reproduce the unsharded run with the same seed
+TEST(BeltShardTest, BeltShardQueueChannelTest) {
+    const vector<size_t> segments = {3, 1, 4};
+    const size_t numSlots = 4000;
+
+    vector<unique_ptr<QueueChannel>> channels;
+    for (size_t idx = 0; idx + 1 < segments.size(); idx++) {
+        channels.push_back(make_unique<QueueChannel>());
+    }
+    size_t products = 0;
+    size_t drops = 0;
+    for (size_t idx = 0; idx < segments.size(); idx++) {
+        BeltShard shard(segments[idx], 2, 31, idx ? channels[idx - 1].get() : nullptr,
+                        idx + 1 < segments.size() ? channels[idx].get() : nullptr);
+        shard.run(numSlots);
+        products = shard.getProductCount();
+        drops = shard.getDropCount();
+    }
+
+    ABConveyorConfiguration sim(8, 2, 31);
+    sim.run(numSlots);
+    ASSERT_EQ(products, sim.getProductCount());
+    ASSERT_EQ(drops, sim.getDropCount());
+}
+
+// Shard processes connected by shared memory must reproduce the unsharded run as well
+TEST(BeltShardTest, ShardLauncherTest) {
+    const size_t numSlots = 20000;
+    const auto result = ShardLauncher(23, 3, 4, 12, 16).run(numSlots);
+
+    ABConveyorConfiguration sim(23, 3, 12);
+    sim.run(numSlots);
+    ASSERT_EQ(result.productCount, sim.getProductCount());
+    ASSERT_EQ(result.dropCount, sim.getDropCount());
+    ASSERT_EQ(result.numSlots, numSlots);
+    ASSERT_THROW(ShardLauncher(3, 3, 4, 12), invalid_argument);
+}
+
+// A stop must end all shards at the same timeslot, with the counts of the unsharded run of it
+TEST(BeltShardTest, ShardLauncherStopTest) {
+    const size_t numSlots = 100000000;
+    thread stopper([] {
+        this_thread::sleep_for(chrono::milliseconds(50));
+        ChunkedRunner::requestStop();
+    });
+    const auto result = ShardLauncher(23, 3, 4, 12, 16).run(numSlots);
+    stopper.join();
+    ChunkedRunner::clearStopRequest();
+
+    ASSERT_LT(result.numSlots, numSlots);
+    ABConveyorConfiguration sim(23, 3, 12);
+    sim.run(result.numSlots);
+    ASSERT_EQ(result.productCount, sim.getProductCount());
+    ASSERT_EQ(result.dropCount, sim.getDropCount());
+}
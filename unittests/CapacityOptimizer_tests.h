@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "CapacityOptimizer.h"
+#include "LockstepReplicaEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// With an assembly duration of 4, one position makes about 0.17 products per timeslot and two
+// positions about 0.26, so a target of 0.22 is clearly met from a capacity of 2 on
+TEST(CapacityOptimizerTest, CapacityOptimizerSearchTest) {
+    const auto result = CapacityOptimizer(4, 0.22, 40, 3).run();
+    ASSERT_TRUE(result.capacity.has_value());
+    ASSERT_EQ(result.capacity.value(), 2);
+
+    size_t totalSlots = 0;
+    for (const auto& decision: result.decisions) {
+        ASSERT_FALSE(decision.truncated);
+        ASSERT_EQ(decision.meetsTarget, decision.capacity >= 2);
+        totalSlots += decision.slots * LockstepReplicaEngine::Lanes;
+    }
+    ASSERT_EQ(result.decisions.front().capacity, 40);
+    ASSERT_EQ(result.totalSlots, totalSlots);
+    ASSERT_DOUBLE_EQ(result.confidence, 1 - 0.01 * result.decisions.size());
+}
+
+// No belt makes more than a product every three timeslots
+TEST(CapacityOptimizerTest, CapacityOptimizerUnreachableTest) {
+    const auto result = CapacityOptimizer(1, 0.4, 20, 3).run();
+    ASSERT_FALSE(result.capacity.has_value());
+    ASSERT_EQ(result.decisions.size(), 1);
+    ASSERT_FALSE(result.decisions.front().meetsTarget);
+}
+
+// A test that cannot decide within its timeslots is truncated and costs confidence
+TEST(CapacityOptimizerTest, CapacityOptimizerTruncationTest) {
+    CapacityOptimizer::Settings settings;
+    settings.batchSlots = 100;
+    settings.maxSlots = 300;
+    settings.indifference = 0.001;
+    const auto decision = CapacityOptimizer(4, 0.31, 5, 3, settings).test(5);
+    // The warm-up of 5 timeslots counts, so the third batch reaches the limit
+    ASSERT_TRUE(decision.truncated);
+    ASSERT_EQ(decision.slots, 305);
+    ASSERT_EQ(decision.observations, 3 * LockstepReplicaEngine::Lanes);
+}
+
+TEST(CapacityOptimizerTest, CapacityOptimizerFailTest) {
+    ASSERT_THROW(CapacityOptimizer(1, 0, 10), invalid_argument);
+    ASSERT_THROW(CapacityOptimizer(1, 0.2, 0), invalid_argument);
+    CapacityOptimizer::Settings settings;
+    settings.alpha = 0.5;
+    ASSERT_THROW(CapacityOptimizer(1, 0.2, 10, nullopt, settings), invalid_argument);
+}
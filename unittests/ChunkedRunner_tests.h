@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <csignal>
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "ChunkedRunner.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// A chunked run must be the same run as an unchunked one
+TEST(ChunkedRunnerTest, ChunkedRunnerEquivalenceTest) {
+    ABConveyorConfiguration chunked(7, 3, 21);
+    ABConveyorConfiguration whole(7, 3, 21);
+    vector<uint64_t> chunkEnds;
+    ASSERT_EQ(ChunkedRunner(300).run(chunked, 1000, [&](const uint64_t& slot) { chunkEnds.push_back(slot); }), 1000);
+    whole.run(1000);
+    ASSERT_EQ(chunkEnds, vector<uint64_t>({300, 600, 900, 1000}));
+    ASSERT_EQ(chunked.getProductCount(), whole.getProductCount());
+    ASSERT_EQ(chunked.getDropCount(), whole.getDropCount());
+}
+
+// A signal must stop the run at the end of the current chunk
+TEST(ChunkedRunnerTest, ChunkedRunnerSignalStopTest) {
+    ChunkedRunner::installSignalHandlers();
+    ABConveyorConfiguration sim(7, 3, 21);
+    const uint64_t slotsRun = ChunkedRunner(100).run(sim, 1000, [](const uint64_t& slot) {
+        if (slot == 200) {
+            raise(SIGINT);
+        }
+    });
+    ASSERT_EQ(slotsRun, 200);
+    ASSERT_TRUE(ChunkedRunner::stopRequested());
+    ASSERT_EQ(ChunkedRunner::getStopSignal(), SIGINT);
+
+    ChunkedRunner::clearStopRequest();
+    signal(SIGINT, SIG_DFL);
+    ASSERT_EQ(ChunkedRunner(100).run(sim, 300), 300);
+}
@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "CommonRandomNumbersComparison.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Every variant must reproduce the standalone seeded simulation of its configuration
+TEST(CommonRandomNumbersComparisonTest, CommonRandomNumbersReproduceSeededRunsTest) {
+    const size_t numSlots = 3000;
+    const vector<CommonRandomNumbersComparison::Variant> variants = {{3, 2}, {5, 0}, {1, 4}};
+
+    const auto result = CommonRandomNumbersComparison(variants, 11).run(numSlots, 10);
+    ASSERT_EQ(result.variants.size(), variants.size());
+    ASSERT_EQ(result.differences.size(), variants.size() - 1);
+    for (const auto& variant: result.variants) {
+        ABConveyorConfiguration sim(variant.variant.capacity, variant.variant.assemblyDuration, 11);
+        sim.run(numSlots);
+        ASSERT_EQ(variant.productCount, sim.getProductCount());
+        ASSERT_EQ(variant.dropCount, sim.getDropCount());
+    }
+}
+
+// Identical variants see identical draws, so their paired differences vanish
+TEST(CommonRandomNumbersComparisonTest, CommonRandomNumbersIdenticalVariantsTest) {
+    const auto result = CommonRandomNumbersComparison({{4, 3}, {4, 3}}).run(2000, 20, 100);
+    ASSERT_EQ(result.batchSlots, 95);
+    ASSERT_EQ(result.variants[0].productCount, result.variants[1].productCount);
+    ASSERT_EQ(result.differences[0].productRate.mean, 0);
+    ASSERT_EQ(result.differences[0].productRate.halfWidth, 0);
+    ASSERT_EQ(result.differences[0].dropRate.halfWidth, 0);
+}
+
+// Too few batches or measured timeslots cannot give confidence intervals
+TEST(CommonRandomNumbersComparisonTest, CommonRandomNumbersInvalidArgumentsTest) {
+    ASSERT_THROW(CommonRandomNumbersComparison({}), invalid_argument);
+    ASSERT_THROW(CommonRandomNumbersComparison({{0, 1}}), invalid_argument);
+    ASSERT_THROW(static_cast<void>(CommonRandomNumbersComparison({{1, 1}}).run(100, 1)), invalid_argument);
+    ASSERT_THROW(static_cast<void>(CommonRandomNumbersComparison({{1, 1}}).run(100, 10, 95)), invalid_argument);
+}
@@ -34,6 +34,7 @@ TEST_P(ConveyorBeltTestFixture, ConveyorBeltTest) {
         ASSERT_FALSE(belt.isReserved(pos));
         Item itm = Item(ItemPN(pos));
         ASSERT_NO_THROW(belt.emplaceItem(forward<Item>(itm), pos));
+        ASSERT_EQ(belt.getOccupiedPositions(), pos + 1);
         ASSERT_FALSE(belt.isEmpty(pos));
         ASSERT_TRUE(belt.isReserved(pos));
         ASSERT_EQ(itm, belt.peekItem(pos));
@@ -46,11 +47,14 @@ TEST_P(ConveyorBeltTestFixture, ConveyorBeltTest) {
     // Run the belt one timeslot, test that the items are in the correct positions and test
     // collecting all of the items:
     ASSERT_NO_THROW(belt.run(1));
+    // The item on the last position left the belt
+    ASSERT_EQ(belt.getOccupiedPositions(), cap - 1);
     for(size_t pos = 1; pos < cap; pos++) {
         ASSERT_FALSE(belt.isEmpty(pos));
         ASSERT_FALSE(belt.isReserved(pos));
         Item itm = Item(ItemPN(pos-1));
         ASSERT_NO_THROW(static_cast<void>(belt.collectItem(pos)));
+        ASSERT_EQ(belt.getOccupiedPositions(), cap - 1 - pos);
         ASSERT_TRUE(belt.isEmpty(pos));
         ASSERT_TRUE(belt.isReserved(pos));
         ASSERT_EQ(nullopt, belt.peekItem(pos));
@@ -64,6 +68,14 @@ TEST_P(ConveyorBeltTestFixture, ConveyorBeltTest) {
     ASSERT_FALSE(belt.isEmpty(0));
     ASSERT_FALSE(belt.isReserved(0));
     ASSERT_EQ(itm, belt.peekItem(0));
+    ASSERT_EQ(belt.getOccupiedPositions(), 1);
+
+    // Restoring and clearing positions keep the count too
+    belt.restore(0, nullopt, false);
+    belt.restore(cap - 1, Item(ItemPN('A')), false);
+    ASSERT_EQ(belt.getOccupiedPositions(), 1);
+    belt.clear();
+    ASSERT_EQ(belt.getOccupiedPositions(), 0);
 }
 
 vector<ConveyorBeltTestCase> belttc = {
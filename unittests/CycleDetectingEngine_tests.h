@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include "CycleDetectingEngine.h"
+#include "PeriodicItemGenerator.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+TEST(CycleDetectingEngineTest, PeriodicItemGeneratorTest) {
+    const auto pattern = parseItemPattern("AB-");
+    ASSERT_TRUE(pattern.has_value());
+    ASSERT_FALSE(parseItemPattern("").has_value());
+    const unique_ptr<ItemGeneratorIF> generator = make_unique<PeriodicItemGenerator>(pattern.value());
+    const auto items = generator->get_next_items(7);
+    for (size_t idx = 0; idx < items.size(); idx++) {
+        ASSERT_EQ(items[idx].has_value(), idx % 3 != 2) << idx;
+        if (items[idx].has_value()) {
+            ASSERT_EQ(items[idx]->getPN(), ItemPN(idx % 3 ? 'B' : 'A')) << idx;
+        }
+    }
+    ASSERT_EQ(dynamic_cast<const PeriodicItemGenerator&>(*generator).getPhase(), 1);
+    ASSERT_THROW(PeriodicItemGenerator({}), invalid_argument);
+}
+
+// Fast-forwarding over the cycle gives the counts of running every timeslot, whether the run
+// ends within the first cycle, on a cycle boundary or within a later one
+TEST(CycleDetectingEngineTest, CycleDetectingEngineExactnessTest) {
+    for (const auto text: {"AB", "A-B", "AAB-B", "BBBA"}) {
+        for (const size_t convCap: {1, 5, 12}) {
+            for (const size_t duration: {0, 3}) {
+                const PeriodicItemGenerator generator(parseItemPattern(text).value());
+                const CycleDetectingEngine fast(convCap, duration, generator, {true, false, false});
+                const CycleDetectingEngine full(convCap, duration, generator, {true, false, false}, false);
+                for (const uint64_t numSlots: {1, 40, 997, 20000}) {
+                    const auto expected = full.run(numSlots);
+                    const auto result = fast.run(numSlots);
+                    ASSERT_EQ(result.productCount, expected.productCount) << text << " " << convCap << " " << numSlots;
+                    ASSERT_EQ(result.dropCount, expected.dropCount) << text << " " << convCap << " " << numSlots;
+                    ASSERT_EQ(expected.simulatedSlots, numSlots);
+                    ASSERT_EQ(expected.cycleLength, 0);
+                }
+                const auto result = fast.run(20000);
+                ASSERT_GT(result.cycleLength, 0) << text << " " << convCap;
+                ASSERT_EQ(result.cycleLength % (strlen(text) * 3 / gcd<size_t>(strlen(text), 3)), 0);
+                ASSERT_LT(result.simulatedSlots, 20000);
+            }
+        }
+    }
+
+    // A trillion timeslots take as long as finding the cycle
+    const PeriodicItemGenerator generator(parseItemPattern("AB-").value());
+    const auto result = CycleDetectingEngine(100, 2, generator, {true, false}).run(1000000000000ULL);
+    ASSERT_GT(result.cycleLength, 0);
+    ASSERT_LT(result.simulatedSlots, 100000);
+    ASSERT_GT(result.productCount, 0);
+    ASSERT_THROW(CycleDetectingEngine(100, 2, generator, {}), invalid_argument);
+    ASSERT_THROW(CycleDetectingEngine(100, 2, PeriodicItemGenerator(parseItemPattern("AC").value()), {true}),
+                 invalid_argument);
+}
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "EngineCalibration.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Whichever engine is picked, the run is the one of the seeded ABConveyorConfiguration
+TEST(EngineCalibrationTest, EngineCalibrationEnginesTest) {
+    ABConveyorConfiguration sim(21, 3, 17);
+    sim.run(2000);
+    const EngineCalibration calibration(21, 3, 5, "");
+    const auto engines = calibration.candidates();
+    ASSERT_EQ(engines.size(), 8);
+    for (const auto& engine: engines) {
+        const auto counts = EngineCalibration::run(engine, 21, 3, 17, 2000);
+        ASSERT_EQ(counts.productCount, sim.getProductCount()) << EngineCalibration::getName(engine.kind) << " "
+                                                             << engine.threads;
+        ASSERT_EQ(counts.dropCount, sim.getDropCount()) << EngineCalibration::getName(engine.kind) << " "
+                                                        << engine.threads;
+    }
+    ASSERT_THROW(EngineCalibration(0, 1, 1, ""), invalid_argument);
+    ASSERT_THROW(EngineCalibration(1, 1, 0, ""), invalid_argument);
+}
+
+// The first selection probes every candidate and keeps the rates, the next ones of similar
+// configurations read them back, until they are recalibrated
+TEST(EngineCalibrationTest, EngineCalibrationProfileTest) {
+    const string path = "/tmp/conveyor_sim_calibration_" + to_string(getpid());
+    unlink(path.c_str());
+    const auto first = EngineCalibration(40, 1, 2, path).select(false);
+    ASSERT_FALSE(first.cached);
+    ASSERT_EQ(first.probes.size(), 4);
+    for (const auto& probe: first.probes) {
+        ASSERT_GT(probe.updatesPerSecond, 0);
+    }
+
+    // Capacities 32 to 63 and durations 1 and 2 share the rates
+    const auto second = EngineCalibration(63, 2, 2, path).select(false);
+    ASSERT_TRUE(second.cached);
+    ASSERT_EQ(second.engine, first.engine);
+    ASSERT_EQ(second.probes.size(), first.probes.size());
+
+    // Other configurations have their own, and a recalibration replaces them
+    ASSERT_FALSE(EngineCalibration(64, 2, 2, path).select(false).cached);
+    ASSERT_FALSE(EngineCalibration(40, 1, 2, path).select(true).cached);
+    ASSERT_TRUE(EngineCalibration(64, 2, 2, path).select(false).cached);
+    ifstream profile(path);
+    size_t lines = 0;
+    for (string line; getline(profile, line);) {
+        lines++;
+    }
+    ASSERT_EQ(lines, 8);
+    unlink(path.c_str());
+}
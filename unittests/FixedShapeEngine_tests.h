@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include "ABConveyorConfiguration.h"
+#include "FixedShapeEngine.h"
+#include "PackedABState.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// A timeslot of the engine must be one of PackedABState, for any worker order
+TEST(FixedShapeEngineTest, FixedShapeEnginePackedEquivalenceTest) {
+    FixedShapeEngine<5> engine(2);
+    PackedABState state(5, 2);
+    mt19937_64 rng(3);
+    for (size_t slot = 0; slot < 5000; slot++) {
+        const auto generated = static_cast<PackedItem>(rng() % 3);
+        const bool topFirst = rng() % 2;
+        uint64_t topServed = 0;
+        uint64_t bottomServed = 0;
+        ASSERT_EQ(engine.step<false>(generated, topFirst ? ~0ULL : 0, topServed, bottomServed),
+                  state.step(generated, topFirst));
+        for (size_t pos = 0; pos < 5; pos++) {
+            ASSERT_EQ(engine.getItem(pos), state.peekItem(pos));
+            ASSERT_EQ(engine.getTopWorker(pos), state.getTopWorker(pos));
+            ASSERT_EQ(engine.getBottomWorker(pos), state.getBottomWorker(pos));
+        }
+    }
+}
+
+// Dispatching to the engine must not change the results of any arbitration policy; statistics
+// keep a configuration on its generic path
+TEST(FixedShapeEngineTest, FixedShapeEngineDispatchTest) {
+    for (const size_t capacity: {1, 7, 16, 64}) {
+        for (const auto name: {"global-random", "position-random", "round-robin", "least-recently-served"}) {
+            const auto policy = parseArbitrationPolicy(name).value();
+            ABConveyorConfiguration fixed(capacity, 3, 17, policy);
+            ABConveyorConfiguration generic(capacity, 3, 17, policy);
+            generic.enableStatistics(1);
+            ASSERT_TRUE(fixed.usesFixedShapeEngine());
+            ASSERT_FALSE(generic.usesFixedShapeEngine());
+            fixed.run(3000);
+            generic.run(3000);
+            ASSERT_EQ(fixed.getProductCount(), generic.getProductCount());
+            ASSERT_EQ(fixed.getDropCount(), generic.getDropCount());
+            ASSERT_GT(fixed.getProductCount(), 0);
+        }
+    }
+    ASSERT_FALSE(ABConveyorConfiguration(65, 3).usesFixedShapeEngine());
+}
+
+// Between runs, the belt and the workers must look as if the generic path had run them
+TEST(FixedShapeEngineTest, FixedShapeEngineStateTest) {
+    ABConveyorConfiguration fixed(12, 2, 5);
+    ABConveyorConfiguration generic(12, 2, 5);
+    generic.enableStatistics(1);
+    for (const size_t numSlots: {1, 1, 37, 500}) {
+        fixed.run(numSlots);
+        generic.run(numSlots);
+        ostringstream fixedState;
+        ostringstream genericState;
+        fixedState << fixed;
+        genericState << generic;
+        ASSERT_EQ(fixedState.str(), genericState.str());
+        ASSERT_EQ(fixed.peekLastItem(), generic.peekLastItem());
+        ASSERT_EQ(fixed.getOccupiedPositions(), generic.getOccupiedPositions());
+    }
+
+    // Timeslots run one at a time through the generic path continue from the engine's state
+    for (size_t slot = 0; slot < 200; slot++) {
+        fixed.runSlot(ItemPN('A'), slot % 2);
+        generic.runSlot(ItemPN('A'), slot % 2);
+    }
+    fixed.run(1000);
+    generic.run(1000);
+    ASSERT_EQ(fixed.getProductCount(), generic.getProductCount());
+    ASSERT_EQ(fixed.getDropCount(), generic.getDropCount());
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <set>
+#include "ABConveyorConfiguration.h"
+#include "ForkedReplicas.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Every forked replica continues the warmed-up configuration as a reseeded one in the same
+// process would, however many of them run at a time
+TEST(ForkedReplicasTest, ForkedReplicasExactnessTest) {
+    for (const size_t maxRunning: {1, 3}) {
+        const auto result = ForkedReplicas(30, 2, 5, 7, maxRunning).run(300, 2000);
+        ASSERT_EQ(result.replicas.size(), 5);
+        set<pair<uint64_t, uint64_t>> distinct;
+        for (size_t replica = 0; replica < 5; replica++) {
+            ABConveyorConfiguration sim(30, 2, 7);
+            sim.run(300);
+            const size_t products = sim.getProductCount();
+            const size_t drops = sim.getDropCount();
+            sim.reseed(ForkedReplicas::getReplicaSeed(7, replica));
+            sim.run(2000);
+            ASSERT_EQ(result.replicas[replica].productCount, sim.getProductCount() - products) << replica;
+            ASSERT_EQ(result.replicas[replica].dropCount, sim.getDropCount() - drops) << replica;
+            distinct.insert({result.replicas[replica].productCount, result.replicas[replica].dropCount});
+        }
+        // The replicas draw from streams of their own
+        ASSERT_GT(distinct.size(), 1);
+    }
+    ASSERT_THROW(ForkedReplicas(0, 1, 1, 1), invalid_argument);
+    ASSERT_THROW(ForkedReplicas(1, 1, 0, 1), invalid_argument);
+}
+
+// Reseeding keeps the belt and the counts, and only changes the draws from then on
+TEST(ForkedReplicasTest, ForkedReplicasReseedTest) {
+    ABConveyorConfiguration reseeded(12, 1, 3);
+    reseeded.reseed(4);
+    ABConveyorConfiguration fresh(12, 1, 4);
+    reseeded.run(1000);
+    fresh.run(1000);
+    ASSERT_EQ(reseeded.getProductCount(), fresh.getProductCount());
+    ASSERT_EQ(reseeded.getDropCount(), fresh.getDropCount());
+
+    const size_t products = reseeded.getProductCount();
+    const size_t occupied = reseeded.getOccupiedPositions();
+    reseeded.reseed(5);
+    ASSERT_EQ(reseeded.getProductCount(), products);
+    ASSERT_EQ(reseeded.getOccupiedPositions(), occupied);
+}
+
+// The seeds of the replicas are distinct, and depend on every bit of the master seed
+TEST(ForkedReplicasTest, ForkedReplicasSeedTest) {
+    set<uint64_t> seeds;
+    for (const uint64_t seed: {uint64_t{7}, uint64_t{8}, uint64_t{7} | (uint64_t{1} << 63U)}) {
+        for (size_t replica = 0; replica < 1000; replica++) {
+            seeds.insert(ForkedReplicas::getReplicaSeed(seed, replica));
+        }
+    }
+    ASSERT_EQ(seeds.size(), 3000);
+}
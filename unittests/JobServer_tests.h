@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <array>
+#include <map>
+#include <set>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "ChunkedRunner.h"
+#include "JobServer.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Splits result lines by job id, as they come back in the order the jobs complete
+map<string, string> resultsById(const string& output) {
+    map<string, string> results;
+    istringstream in(output);
+    for (string line; getline(in, line);) {
+        const size_t separator = line.find(' ');
+        results[line.substr(0, separator)] = line.substr(separator + 1);
+    }
+    return results;
+}
+
+// The result line of a job, computed with fresh configurations
+string expectedResult(const string& id, const size_t& capacity, const size_t& duration, const size_t& numSlots,
+                      const uint64_t& seed, const size_t& replicas) {
+    double products = 0;
+    double drops = 0;
+    for (size_t replica = 0; replica < replicas; replica++) {
+        ABConveyorConfiguration sim(capacity, duration, JobServer::getReplicaSeed(seed, replica));
+        sim.run(numSlots);
+        products += sim.getProductCount();
+        drops += sim.getDropCount();
+    }
+    products /= replicas;
+    drops /= replicas;
+    const string line = JobServer::formatResult({id, products, drops, products / numSlots, drops / numSlots});
+    return line.substr(id.size() + 1);
+}
+
+// Connects to the socket of a server that may still be starting, or returns -1
+int connectTo(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    copy(path.begin(), path.end(), address.sun_path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    for (size_t attempt = 0; fd >= 0 && attempt < 100; attempt++) {
+        if (!connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address))) {
+            return fd;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+// Reads a socket until its end or a read error
+string readAll(const int& fd) {
+    string output;
+    array<char, 4096> chunk{};
+    for (ssize_t count; (count = read(fd, chunk.data(), chunk.size())) > 0;) {
+        output.append(chunk.data(), count);
+    }
+    return output;
+}
+
+} // namespace
+
+TEST(JobServerTest, JobServerParseTest) {
+    const auto job = JobServer::parseJob("q1 10 2 5000 7 4");
+    ASSERT_EQ(job.id, "q1");
+    ASSERT_EQ(job.capacity, 10);
+    ASSERT_EQ(job.assemblyDuration, 2);
+    ASSERT_EQ(job.numSlots, 5000);
+    ASSERT_EQ(job.seed, optional<uint64_t>(7));
+    ASSERT_EQ(job.replicas, 4);
+
+    const auto defaults = JobServer::parseJob("  q2\t3 0 10 -\r");
+    ASSERT_FALSE(defaults.seed.has_value());
+    ASSERT_EQ(defaults.replicas, 1);
+
+    ASSERT_THROW((void) JobServer::parseJob("q3 10 2 5000"), invalid_argument);
+    ASSERT_THROW((void) JobServer::parseJob("q3 10 2 5000 x"), invalid_argument);
+    ASSERT_THROW((void) JobServer::parseJob("q3 -10 2 5000 1"), invalid_argument);
+    ASSERT_THROW((void) JobServer::parseJob("q3 0 2 5000 1"), invalid_argument);
+    ASSERT_THROW((void) JobServer::parseJob("q3 10 2 5000 1 0"), invalid_argument);
+    ASSERT_THROW((void) JobServer::parseJob("q3 10 2 5000 1 " + to_string(JobServer::MaxReplicas + 1)),
+                 invalid_argument);
+    ASSERT_EQ(JobServer::parseJob("q3 10 2 5000 1 " + to_string(JobServer::MaxReplicas)).replicas,
+              JobServer::MaxReplicas);
+    ASSERT_THROW((void) JobServer::parseJob("q3 10 2 5000 1 2 3"), invalid_argument);
+}
+
+// Replica 0 keeps the seed of its job, and the replicas of jobs with adjacent seeds share none
+TEST(JobServerTest, JobServerSeedTest) {
+    set<uint64_t> seeds;
+    for (const uint64_t seed: {uint64_t{7}, uint64_t{8}, uint64_t{7} | (uint64_t{1} << 63U)}) {
+        ASSERT_EQ(JobServer::getReplicaSeed(seed, 0), seed);
+        for (size_t replica = 0; replica < 1000; replica++) {
+            seeds.insert(JobServer::getReplicaSeed(seed, replica));
+        }
+    }
+    ASSERT_EQ(seeds.size(), 3000);
+}
+
+// Every job gets the result of simulating its replicas with fresh configurations, and bad jobs
+// get errors without stopping the others
+TEST(JobServerTest, JobServerServeTest) {
+    JobServer server(3);
+    istringstream in("# capacity planning\n"
+                     "a 5 1 4000 1 3\n"
+                     "\n"
+                     "b 12 4 3000 9\n"
+                     "c 5 1 oops 1\n"
+                     "d 5 5000000000 10 1\n"
+                     "e 7 2 0 3 2\n");
+    ostringstream out;
+    server.serve(in, out);
+    const auto results = resultsById(out.str());
+    ASSERT_EQ(results.size(), 5);
+    ASSERT_EQ(results.at("a"), expectedResult("a", 5, 1, 4000, 1, 3));
+    ASSERT_EQ(results.at("b"), expectedResult("b", 12, 4, 3000, 9, 1));
+    ASSERT_EQ(results.at("c").rfind("error ", 0), 0);
+    ASSERT_EQ(results.at("d").rfind("error ", 0), 0);
+    ASSERT_EQ(results.at("e"), "ok 0 0 0 0");
+}
+
+// Jobs of the same shape reuse a configuration, which must not change their results
+TEST(JobServerTest, JobServerReuseTest) {
+    JobServer server(1);
+    istringstream in("a 9 3 2000 4\nb 9 3 2500 5 2\nc 9 3 2000 4\nd 6 3 100 1\n");
+    ostringstream out;
+    server.serve(in, out);
+    const auto results = resultsById(out.str());
+    ASSERT_EQ(results.at("a"), expectedResult("a", 9, 3, 2000, 4, 1));
+    ASSERT_EQ(results.at("b"), expectedResult("b", 9, 3, 2500, 5, 2));
+    ASSERT_EQ(results.at("c"), results.at("a"));
+    ASSERT_EQ(server.getConstructedCount(), 2);
+
+    // Nothing is kept beyond the cache limit
+    JobServer uncached(1, 8);
+    istringstream again("a 9 3 10 4\nb 9 3 10 4\n");
+    uncached.serve(again, out);
+    ASSERT_EQ(uncached.getConstructedCount(), 2);
+}
+
+// A client of the socket gets the results of the jobs it sent
+TEST(JobServerTest, JobServerSocketTest) {
+    const string path = "/tmp/conveyor_sim_test_" + to_string(getpid()) + ".sock";
+    JobServer server(2);
+    thread listener([&] { server.listen(path); });
+
+    const int fd = connectTo(path);
+    ASSERT_GE(fd, 0);
+    const string jobs = "x 6 2 3000 11 2\ny 4 0 1000 12";
+    ASSERT_EQ(write(fd, jobs.data(), jobs.size()), static_cast<ssize_t>(jobs.size()));
+    shutdown(fd, SHUT_WR);
+    const string output = readAll(fd);
+    close(fd);
+
+    ChunkedRunner::requestStop();
+    listener.join();
+    ChunkedRunner::clearStopRequest();
+    ASSERT_NE(access(path.c_str(), F_OK), 0);
+
+    const auto results = resultsById(output);
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_EQ(results.at("x"), expectedResult("x", 6, 2, 3000, 11, 2));
+    ASSERT_EQ(results.at("y"), expectedResult("y", 4, 0, 1000, 12, 1));
+}
+
+// A client that does not read its results must not hold up the results of other clients
+TEST(JobServerTest, JobServerSlowClientTest) {
+    const string path = "/tmp/conveyor_sim_test_slow_" + to_string(getpid()) + ".sock";
+    JobServer server(1);
+    thread listener([&] { server.listen(path); });
+
+    // Far more results than the socket buffers, none of them read until the other client is done
+    constexpr size_t numJobs = 20000;
+    const int slow = connectTo(path);
+    const int fast = connectTo(path);
+    string fastOutput;
+    string slowOutput;
+    if (slow >= 0 && fast >= 0) {
+        string jobs;
+        for (size_t job = 0; job < numJobs; job++) {
+            jobs += "s" + to_string(job) + " 1 0 0 1\n";
+        }
+        for (size_t written = 0; written < jobs.size();) {
+            const ssize_t count = write(slow, jobs.data() + written, jobs.size() - written);
+            if (count <= 0) {
+                break;
+            }
+            written += count;
+        }
+        shutdown(slow, SHUT_WR);
+
+        // A pool thread blocked on the slow client would leave this read waiting for good
+        const timeval timeout{10, 0};
+        setsockopt(fast, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        const string job = "f 4 0 1000 12\n";
+        if (write(fast, job.data(), job.size()) == static_cast<ssize_t>(job.size())) {
+            shutdown(fast, SHUT_WR);
+            fastOutput = readAll(fast);
+        }
+        slowOutput = readAll(slow);
+    }
+    close(slow);
+    close(fast);
+    ChunkedRunner::requestStop();
+    listener.join();
+    ChunkedRunner::clearStopRequest();
+
+    ASSERT_EQ(resultsById(fastOutput).size(), 1);
+    ASSERT_EQ(resultsById(fastOutput).at("f"), expectedResult("f", 4, 0, 1000, 12, 1));
+    const auto slowResults = resultsById(slowOutput);
+    ASSERT_EQ(slowResults.size(), numJobs);
+    ASSERT_EQ(slowResults.at("s0"), "ok 0 0 0 0");
+}
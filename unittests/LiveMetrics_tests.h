@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "LiveMetrics.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// A reader racing a publisher must only ever see metrics that were published together
+TEST(LiveMetricsTest, LiveMetricsConsistentReadTest) {
+    const string name = "conveyor_sim_test_" + to_string(getpid());
+    LiveMetricsPublisher publisher(name);
+    const LiveMetricsReader reader(name);
+    ASSERT_EQ(reader.getPublisherPid(), getpid());
+    ASSERT_EQ(reader.read().slot, 0);
+
+    const uint64_t numSlots = 200000;
+    thread writer([&]() {
+        for (uint64_t slot = 1; slot <= numSlots; slot++) {
+            LiveMetrics metrics;
+            metrics.slot = slot;
+            metrics.numSlots = numSlots;
+            metrics.productCount = 2 * slot;
+            metrics.dropCount = 3 * slot;
+            metrics.occupiedPositions = slot % 7;
+            metrics.capacity = 7;
+            metrics.finished = slot == numSlots;
+            publisher.publish(metrics);
+        }
+    });
+    // Failing assertions would return while the writer still runs, so they wait for the join
+    size_t inconsistent = 0;
+    for (LiveMetrics metrics; !metrics.finished || metrics.torn;) {
+        metrics = reader.read();
+        if (!metrics.torn && (metrics.productCount != 2 * metrics.slot || metrics.dropCount != 3 * metrics.slot
+                              || metrics.occupiedPositions != metrics.slot % 7
+                              || metrics.finished != (metrics.slot == numSlots))) {
+            inconsistent++;
+        }
+    }
+    writer.join();
+    ASSERT_EQ(inconsistent, 0);
+}
+
+// A publisher that died in the middle of publishing leaves the reader with a torn copy rather
+// than spinning forever
+TEST(LiveMetricsTest, LiveMetricsDeadPublisherTest) {
+    const string name = "conveyor_sim_test_dead_" + to_string(getpid());
+    LiveMetricsPublisher publisher(name);
+    LiveMetrics published;
+    published.slot = 5;
+    publisher.publish(published);
+    const LiveMetricsReader reader(name);
+    ASSERT_FALSE(reader.read().torn);
+
+    // Leave the sequence number, which starts the second cache line of the segment, odd
+    const int fd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void* const memory = mmap(nullptr, 128, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(memory, MAP_FAILED);
+    reinterpret_cast<atomic<uint64_t>*>(static_cast<char*>(memory) + 64)->fetch_add(1);
+    const LiveMetrics metrics = reader.read();
+    munmap(memory, 128);
+    ASSERT_TRUE(metrics.torn);
+    ASSERT_EQ(metrics.slot, 5);
+}
+
+// Segments that were never published to cannot be read
+TEST(LiveMetricsTest, LiveMetricsMissingSegmentTest) {
+    ASSERT_THROW(LiveMetricsReader("conveyor_sim_test_missing_" + to_string(getpid())), system_error);
+}
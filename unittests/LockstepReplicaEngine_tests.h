@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <random>
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "LockstepReplicaEngine.h"
+#include "PackedABState.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+struct LockstepReplicaEngineTestCase {
+    const size_t capacity;
+    const size_t duration;
+};
+
+class LockstepReplicaEngineTestFixture : public ::testing::TestWithParam<LockstepReplicaEngineTestCase> {
+protected:
+    const size_t numSlots = 2000;
+};
+
+// Given the same draws, every lane must evolve exactly like a PackedABState, which in turn must
+// let exactly the same items through as an ABConveyorConfiguration
+TEST_P(LockstepReplicaEngineTestFixture, LockstepReplicaEngineTest) {
+    const auto testCase = GetParam();
+    constexpr size_t lanes = LockstepReplicaEngine::Lanes;
+
+    LockstepReplicaEngine engine(testCase.capacity, testCase.duration, 5);
+    vector<PackedABState> states(lanes, PackedABState(testCase.capacity, testCase.duration));
+    ABConveyorConfiguration sim(testCase.capacity, testCase.duration, 5);
+    size_t products = 0;
+    size_t drops = 0;
+
+    mt19937 rng(13);
+    uniform_int_distribution<int> udst(0, 2);
+    for (size_t slot = 0; slot < numSlots; slot++) {
+        array<PackedItem, lanes> generated{};
+        array<bool, lanes> topFirst{};
+        for (size_t lane = 0; lane < lanes; lane++) {
+            generated[lane] = static_cast<PackedItem>(udst(rng));
+            topFirst[lane] = udst(rng) == 1;
+        }
+        engine.step(generated, topFirst);
+        for (size_t lane = 0; lane < lanes; lane++) {
+            const auto exited = states[lane].step(generated[lane], topFirst[lane]);
+            if (lane == 0) {
+                products += exited == PackedItem::P;
+                drops += exited == PackedItem::A || exited == PackedItem::B;
+            }
+        }
+        sim.runSlot(generated[0] == PackedItem::Empty ? nullopt
+                                                      : optional(ItemPN(generated[0] == PackedItem::A ? 'A' : 'B')),
+                    topFirst[0]);
+        ASSERT_EQ(sim.getProductCount(), products);
+        ASSERT_EQ(sim.getDropCount(), drops);
+    }
+
+    for (size_t lane = 0; lane < lanes; lane++) {
+        for (size_t pos = 0; pos < testCase.capacity; pos++) {
+            ASSERT_EQ(engine.peekItem(lane, pos), states[lane].peekItem(pos));
+            ASSERT_EQ(engine.getTopWorker(lane, pos), states[lane].getTopWorker(pos));
+            ASSERT_EQ(engine.getBottomWorker(lane, pos), states[lane].getBottomWorker(pos));
+        }
+    }
+    ASSERT_EQ(engine.getProductCount(0), products);
+    ASSERT_EQ(engine.getDropCount(0), drops);
+}
+
+vector<LockstepReplicaEngineTestCase> lretc = {
+        {1, 0},
+        {5, 1},
+        {5, 20},
+        {17, 3},
+};
+
+INSTANTIATE_TEST_CASE_P(
+        LockstepReplicaEngineTest,
+        LockstepReplicaEngineTestFixture,
+        ::testing::ValuesIn(lretc)
+);
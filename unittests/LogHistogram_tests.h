@@ -0,0 +1,48 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "LogHistogram.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Every value must fall in a bucket whose bounds contain it, and the relative width of
+// every bucket must be within the advertised precision
+TEST(LogHistogramTest, LogHistogramBucketTest) {
+    for (uint64_t value: {0UL, 1UL, 31UL, 32UL, 33UL, 63UL, 64UL, 1000UL, 123456789UL, UINT64_MAX}) {
+        const size_t bucket = LogHistogram::bucketOf(value);
+        ASSERT_LT(bucket, LogHistogram::BucketCount);
+        ASSERT_LE(LogHistogram::bucketLowerBound(bucket), value);
+        ASSERT_GE(LogHistogram::bucketUpperBound(bucket), value);
+        const double width = LogHistogram::bucketUpperBound(bucket) - LogHistogram::bucketLowerBound(bucket);
+        ASSERT_LE(width, static_cast<double>(value) / LogHistogram::SubBucketCount);
+    }
+    ASSERT_EQ(LogHistogram::BucketCount - 1, LogHistogram::bucketOf(UINT64_MAX));
+}
+
+TEST(LogHistogramTest, LogHistogramPercentileTest) {
+    LogHistogram hist;
+    ASSERT_EQ(0, hist.getCount());
+    ASSERT_EQ(0, hist.getPercentile(0.5));
+
+    for (uint64_t value = 1; value <= 1000; value++) {
+        hist.record(value);
+    }
+    ASSERT_EQ(1000, hist.getCount());
+    ASSERT_EQ(1, hist.getMin());
+    ASSERT_EQ(1000, hist.getMax());
+    ASSERT_DOUBLE_EQ(500.5, hist.getMean());
+    for (const double fraction: {0.1, 0.5, 0.9, 0.99}) {
+        const double expected = fraction * 1000;
+        ASSERT_NEAR(expected, hist.getPercentile(fraction), expected / LogHistogram::SubBucketCount + 1);
+    }
+    ASSERT_EQ(1000, hist.getPercentile(1));
+
+    // Merging a copy doubles the counts but keeps the distribution
+    LogHistogram merged = hist;
+    merged.merge(hist);
+    ASSERT_EQ(2000, merged.getCount());
+    ASSERT_EQ(hist.getPercentile(0.5), merged.getPercentile(0.5));
+}
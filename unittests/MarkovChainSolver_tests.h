@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "MarkovChainSolver.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+struct MarkovChainSolverTestCase {
+    const size_t capacity;
+    const size_t duration;
+};
+
+class MarkovChainSolverTestFixture : public ::testing::TestWithParam<MarkovChainSolverTestCase> {
+protected:
+    const size_t numSlots = 400000;
+    const double abs_error = 0.005;
+};
+
+// The exact steady-state rates must agree with a long seeded simulation of the same configuration
+TEST_P(MarkovChainSolverTestFixture, MarkovChainSolverTest) {
+    const auto testCase = GetParam();
+
+    const auto result = MarkovChainSolver(testCase.capacity, testCase.duration, 100000).solve();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_LT(result->residual, 1e-9);
+
+    ABConveyorConfiguration sim(testCase.capacity, testCase.duration, 7);
+    sim.run(numSlots);
+    ASSERT_NEAR(result->productRate, static_cast<double>(sim.getProductCount()) / numSlots, abs_error);
+    ASSERT_NEAR(result->dropRate, static_cast<double>(sim.getDropCount()) / numSlots, abs_error);
+}
+
+// The enumeration must give up once the state limit is exceeded
+TEST(MarkovChainSolverLimitTest, MarkovChainSolverLimitTest) {
+    ASSERT_FALSE(MarkovChainSolver(3, 3, 1000).solve().has_value());
+}
+
+vector<MarkovChainSolverTestCase> mcstc = {
+        {1, 0},
+        {1, 4},
+        {2, 1},
+        {2, 3},
+};
+
+INSTANTIATE_TEST_CASE_P(
+        MarkovChainSolverTest,
+        MarkovChainSolverTestFixture,
+        ::testing::ValuesIn(mcstc)
+);
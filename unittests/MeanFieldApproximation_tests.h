@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include "ABConveyorConfiguration.h"
+#include "MarkovChainSolver.h"
+#include "MeanFieldApproximation.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// From MinCapacity positions on, the approximated rates are within MaxRateError of seeded
+// simulations
+TEST(MeanFieldApproximationTest, MeanFieldApproximationAccuracyTest) {
+    constexpr size_t numSlots = 100000;
+    const pair<size_t, size_t> points[] = {{MeanFieldApproximation::MinCapacity, 1},
+                                           {MeanFieldApproximation::MinCapacity, 16},
+                                           {2 * MeanFieldApproximation::MinCapacity, 4}};
+    for (const auto& [capacity, duration]: points) {
+        const auto approximation = MeanFieldApproximation(capacity, duration).solve();
+        ABConveyorConfiguration sim(capacity, duration, 5);
+        sim.run(numSlots);
+        const double productRate = static_cast<double>(sim.getProductCount()) / numSlots;
+        const double dropRate = static_cast<double>(sim.getDropCount()) / numSlots;
+        ASSERT_NEAR(approximation.productRate, productRate, MeanFieldApproximation::MaxRateError)
+                << capacity << " " << duration;
+        ASSERT_NEAR(approximation.dropRate, dropRate, MeanFieldApproximation::MaxRateError)
+                << capacity << " " << duration;
+    }
+}
+
+// Below MinCapacity the approximation underestimates the drops, as the exact solution shows
+TEST(MeanFieldApproximationTest, MeanFieldApproximationShortBeltTest) {
+    for (const size_t capacity: {1, 2}) {
+        const auto exact = MarkovChainSolver(capacity, 1, 1000000).solve();
+        ASSERT_TRUE(exact.has_value()) << capacity;
+        const auto approximation = MeanFieldApproximation(capacity, 1).solve();
+        ASSERT_LT(approximation.dropRate, exact->dropRate) << capacity;
+        ASSERT_GT(approximation.productRate, exact->productRate) << capacity;
+        ASSERT_LT(fabs(approximation.productRate - exact->productRate), 0.05) << capacity;
+    }
+    ASSERT_THROW(MeanFieldApproximation(0, 1), invalid_argument);
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sched.h>
+#include <sstream>
+#include "MemoryPlacement.h"
+#include "TimeWarpEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+// Restores the CPU affinity of the calling thread when it goes out of scope, so that a failed
+// assertion does not leave the remaining tests pinned
+class AffinityGuard {
+public:
+    AffinityGuard() : saved(sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {}
+    ~AffinityGuard() {
+        if (saved) {
+            sched_setaffinity(0, sizeof(allowed), &allowed);
+        }
+    }
+    AffinityGuard(const AffinityGuard&) = delete;
+    AffinityGuard& operator=(const AffinityGuard&) = delete;
+
+    [[nodiscard]] bool isSaved() const { return saved; }
+    [[nodiscard]] const cpu_set_t& getAllowed() const { return allowed; }
+
+private:
+    cpu_set_t allowed{};
+    const bool saved;
+};
+
+} // namespace
+
+// Large allocations are mapped aligned to a huge page, small ones are not, and every decision
+// is logged
+TEST(MemoryPlacementTest, MemoryPlacementAllocationTest) {
+    const auto previous = MemoryPlacement::getSettings();
+    ostringstream log;
+    MemoryPlacementSettings settings;
+    settings.log = &log;
+    MemoryPlacement::configure(settings);
+
+    PlacedVector<uint64_t> small(16, 7);
+    ASSERT_EQ(log.str(), "");
+    PlacedVector<uint64_t> large(MemoryPlacement::HugePageSize / sizeof(uint64_t) + 1, 7);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(large.data()) % MemoryPlacement::HugePageSize, 0);
+    ASSERT_EQ(large.back(), 7);
+    ASSERT_EQ(log.str().rfind("placement: 4.0 MiB on ", 0), 0);
+    ASSERT_NE(log.str().find("huge pages"), string::npos);
+
+    settings.hugePages = false;
+    MemoryPlacement::configure(settings);
+    log.str("");
+    large = PlacedVector<uint64_t>(MemoryPlacement::HugePageSize, 3);
+    ASSERT_EQ(log.str(), "placement: 16.0 MiB on regular pages, huge pages are off\n");
+    MemoryPlacement::configure(previous);
+}
+
+// Pinned segment threads build and run their segments with the same results
+TEST(MemoryPlacementTest, MemoryPlacementPinningTest) {
+    const auto previous = MemoryPlacement::getSettings();
+    const auto expected = TimeWarpEngine(30, 2, 3, 5).run(3000);
+    ostringstream log;
+    MemoryPlacementSettings settings;
+    settings.pinThreads = true;
+    settings.log = &log;
+    MemoryPlacement::configure(settings);
+    const auto pinned = TimeWarpEngine(30, 2, 3, 5).run(3000);
+    MemoryPlacement::configure(previous);
+    ASSERT_EQ(pinned.productCount, expected.productCount);
+    ASSERT_EQ(pinned.dropCount, expected.dropCount);
+    for (const auto segment: {"segment 0", "segment 1", "segment 2"}) {
+        ASSERT_NE(log.str().find("placement: " + string(segment) + " pinned to CPU "), string::npos) << segment;
+        ASSERT_NE(log.str().find("placement: " + string(segment) + " runs on CPU "), string::npos) << segment;
+    }
+
+    // The calling thread is pinned to the first CPU it may run on
+    const AffinityGuard guard;
+    ASSERT_TRUE(guard.isSaved());
+    const cpu_set_t& allowed = guard.getAllowed();
+    MemoryPlacement::configure(settings);
+    MemoryPlacement::placeThread(0, "test");
+    MemoryPlacement::configure(previous);
+    cpu_set_t pinnedSet;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(pinnedSet), &pinnedSet), 0);
+    ASSERT_EQ(CPU_COUNT(&pinnedSet), 1);
+    int first = 0;
+    while (!CPU_ISSET(first, &allowed)) {
+        first++;
+    }
+    ASSERT_TRUE(CPU_ISSET(first, &pinnedSet));
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "OutOfCoreEngine.h"
+#include "PackedABState.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// However the belt is split, including into two segments whose read ahead follows the write
+// behind of the other, and the timeslots chunked, and over several runs, the file-backed
+// belt must reproduce the in-memory run with the same seed
+TEST(OutOfCoreEngineTest, OutOfCoreEngineExactnessTest) {
+    const string path = "/tmp/conveyor_sim_belt_" + to_string(getpid()) + ".bin";
+    for (const size_t segmentPositions: {1, 4, 7, 13, 20, 25, 100}) {
+        for (const size_t chunkSlots: {13, 500}) {
+            OutOfCoreEngine::Settings settings;
+            settings.segmentPositions = segmentPositions;
+            settings.chunkSlots = chunkSlots;
+            OutOfCoreEngine engine(25, 2, 11, path, settings);
+            ABConveyorConfiguration sim(25, 2, 11);
+            for (const size_t numSlots: {700, 1300}) {
+                const auto result = engine.run(numSlots);
+                sim.run(numSlots);
+                ASSERT_EQ(result.productCount, sim.getProductCount()) << segmentPositions << " " << chunkSlots;
+                ASSERT_EQ(result.dropCount, sim.getDropCount()) << segmentPositions << " " << chunkSlots;
+            }
+            const auto result = engine.run(0);
+            ASSERT_EQ(result.passes, 700 / chunkSlots + (700 % chunkSlots > 0) + 1300 / chunkSlots
+                                     + (1300 % chunkSlots > 0));
+            ASSERT_EQ(result.bytesRead, result.passes * 25 * PackedABState::EncodedBytesPerPosition);
+            ASSERT_EQ(result.bytesWritten, result.bytesRead);
+        }
+    }
+
+    // The file is scratch space
+    struct stat status{};
+    ASSERT_NE(stat(path.c_str(), &status), 0);
+}
+
+TEST(OutOfCoreEngineTest, OutOfCoreEngineInvalidTest) {
+    const string path = "/tmp/conveyor_sim_belt_" + to_string(getpid()) + ".bin";
+    ASSERT_THROW(OutOfCoreEngine(0, 1, 1, path), invalid_argument);
+    ASSERT_THROW(OutOfCoreEngine(4, 5000000000, 1, path), invalid_argument);
+    OutOfCoreEngine::Settings settings;
+    settings.chunkSlots = 0;
+    ASSERT_THROW(OutOfCoreEngine(4, 1, 1, path, settings), invalid_argument);
+    ASSERT_THROW(OutOfCoreEngine(4, 1, 1, "/nonexistent/belt.bin"), system_error);
+}
+
+// An existing file is refused and left as it was, since the engine removes its file when done
+TEST(OutOfCoreEngineTest, OutOfCoreEngineExistingFileTest) {
+    const string path = "/tmp/conveyor_sim_belt_" + to_string(getpid()) + ".bin";
+    ofstream(path) << "keep";
+    ASSERT_THROW(OutOfCoreEngine(4, 1, 1, path), system_error);
+    string contents;
+    ifstream(path) >> contents;
+    unlink(path.c_str());
+    ASSERT_EQ(contents, "keep");
+}
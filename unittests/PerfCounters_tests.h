@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include "ABConveyorConfiguration.h"
+#include "PerfCounters.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Counters only count while they are started, and add up over the intervals they are started for
+TEST(PerfCountersTest, PerfCountersSoftwareTest) {
+    optional<PerfCounters> counters;
+    try {
+        counters.emplace(false);
+    } catch (const system_error&) {
+        GTEST_SKIP() << "perf_event_open is not permitted";
+    }
+    ASSERT_FALSE(counters->isHardware());
+    ABConveyorConfiguration sim(100, 2, 1);
+
+    counters->start();
+    sim.run(10000);
+    counters->stop();
+    const auto first = counters->read();
+    ASSERT_EQ(first.size(), 4);
+    ASSERT_STREQ(first[0].name, "task-clock [ns]");
+    ASSERT_GT(first[0].value, 0);
+
+    sim.run(10000);
+    ASSERT_EQ(counters->read()[0].value, first[0].value);
+
+    counters->start();
+    sim.run(10000);
+    counters->stop();
+    ASSERT_GT(counters->read()[0].value, first[0].value);
+
+    ostringstream report;
+    counters->report(report, 20000, 2000000);
+    ASSERT_EQ(report.str().rfind("Counters: software", 0), 0);
+    ASSERT_NE(report.str().find(" per position update\n"), string::npos);
+}
+
+// Hardware events are counted where they are available, and the software ones otherwise
+TEST(PerfCountersTest, PerfCountersFallbackTest) {
+    optional<PerfCounters> counters;
+    try {
+        counters.emplace();
+    } catch (const system_error&) {
+        GTEST_SKIP() << "perf_event_open is not permitted";
+    }
+    counters->start();
+    ABConveyorConfiguration(100, 2, 1).run(10000);
+    counters->stop();
+    const auto values = counters->read();
+    ASSERT_FALSE(values.empty());
+    if (counters->isHardware()) {
+        ASSERT_LE(values.size(), 4);
+    } else {
+        ASSERT_STREQ(values[0].name, "task-clock [ns]");
+    }
+    ASSERT_GT(values[0].value, 0);
+}
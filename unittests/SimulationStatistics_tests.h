@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "SimulationStatistics.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Every event lands in the histogram of the segment of its position, with the timeslots
+// elapsed since the item was placed or the product finished
+TEST(SimulationStatisticsTest, SimulationStatisticsEventsTest) {
+    SimulationStatistics stats(10, 3);
+    ASSERT_EQ(stats.getNumSegments(), 3);
+    ASSERT_EQ(stats.segmentOf(0), 0);
+    ASSERT_EQ(stats.segmentOf(3), 0);
+    ASSERT_EQ(stats.segmentOf(4), 1);
+    ASSERT_EQ(stats.segmentOf(9), 2);
+
+    // Items placed on timeslots 1 to 10 are collected on timeslot 10 by a worker of position 5
+    for (size_t slot = 1; slot <= 10; slot++) {
+        stats.startSlot();
+    }
+    ASSERT_EQ(stats.getSlot(), 10);
+    for (size_t enqueueSlot = 1; enqueueSlot <= 10; enqueueSlot++) {
+        stats.recordCollection(10, Item(ItemPN('A'), enqueueSlot));
+    }
+    const auto& collection = stats.getCollectionLatency(1);
+    ASSERT_EQ(collection.getCount(), 10);
+    ASSERT_EQ(collection.getMin(), 0);
+    ASSERT_EQ(collection.getMax(), 9);
+    ASSERT_DOUBLE_EQ(collection.getMean(), 4.5);
+    ASSERT_EQ(collection.getPercentile(0.5), 4);
+    ASSERT_EQ(stats.getCollectionLatency(0).getCount(), 0);
+    ASSERT_EQ(stats.getCollectionLatency(2).getCount(), 0);
+
+    // The bottom worker of position 0 finishes a product and releases it 4 timeslots later
+    stats.recordProductReady(1);
+    for (size_t slot = 0; slot < 4; slot++) {
+        stats.startSlot();
+        stats.recordBusy(1);
+    }
+    stats.recordRelease(1);
+    ASSERT_EQ(stats.getReleaseWait(0).getCount(), 1);
+    ASSERT_EQ(stats.getReleaseWait(0).getMin(), 4);
+    ASSERT_EQ(stats.getReleaseWait(0).getMax(), 4);
+    ASSERT_DOUBLE_EQ(stats.getBusyFraction(0), 4.0 / (2 * 14));
+    ASSERT_DOUBLE_EQ(stats.getBusyFraction(1), 0);
+
+    stats.recordExit(Item(ItemPN('P'), 6), true);
+    stats.recordExit(Item(ItemPN('A'), 4), false);
+    stats.recordExit(Item(ItemPN('B'), 4), false);
+    ASSERT_EQ(stats.getProductTransit().getCount(), 1);
+    ASSERT_EQ(stats.getProductTransit().getMax(), 8);
+    ASSERT_EQ(stats.getDropTransit().getCount(), 2);
+    ASSERT_EQ(stats.getDropTransit().getMin(), 10);
+    ASSERT_EQ(stats.getDropTransit().getMax(), 10);
+
+    ASSERT_THROW(SimulationStatistics(0, 1), invalid_argument);
+    ASSERT_THROW(SimulationStatistics(1, 0), invalid_argument);
+    ASSERT_EQ(SimulationStatistics(2, 5).getNumSegments(), 2);
+}
+
+// On a seeded run the distributions follow from the geometry of the belt: an item reaches
+// position *pos* *pos* timeslots after it is placed, and the unused ones ride the whole belt
+TEST(SimulationStatisticsTest, SimulationStatisticsSeededRunTest) {
+    constexpr size_t capacity = 12;
+    constexpr size_t assemblyDuration = 3;
+    constexpr size_t numSlots = 20000;
+    ABConveyorConfiguration sim(capacity, assemblyDuration, 11);
+    sim.enableStatistics(4);
+    sim.run(numSlots);
+    const SimulationStatistics* stats = sim.getStatistics();
+    ASSERT_NE(stats, nullptr);
+    ASSERT_EQ(stats->getSlot(), numSlots);
+
+    ASSERT_EQ(stats->getProductTransit().getCount(), sim.getProductCount());
+    ASSERT_EQ(stats->getDropTransit().getCount(), sim.getDropCount());
+    ASSERT_GT(sim.getProductCount(), 0);
+    ASSERT_GT(sim.getDropCount(), 0);
+    ASSERT_EQ(stats->getDropTransit().getMin(), capacity);
+    ASSERT_EQ(stats->getDropTransit().getMax(), capacity);
+    // A product rides from the position of its worker on
+    ASSERT_GT(stats->getProductTransit().getMin(), 0);
+    ASSERT_LE(stats->getProductTransit().getMax(), capacity);
+
+    // Segments of 3 positions each
+    uint64_t collected = 0;
+    uint64_t released = 0;
+    for (size_t segment = 0; segment < stats->getNumSegments(); segment++) {
+        const auto& collection = stats->getCollectionLatency(segment);
+        ASSERT_GT(collection.getCount(), 0) << segment;
+        ASSERT_EQ(collection.getMin(), 3 * segment) << segment;
+        ASSERT_EQ(collection.getMax(), 3 * segment + 2) << segment;
+        collected += collection.getCount();
+        released += stats->getReleaseWait(segment).getCount();
+    }
+    // A product takes two items, and a released one has made it through the belt or still rides it
+    ASSERT_LE(released, collected / 2);
+    ASSERT_GE(released, sim.getProductCount());
+    ASSERT_LE(released, sim.getProductCount() + capacity * 2);
+
+    // A worker assembles for *assemblyDuration* timeslots per product
+    double busySlots = 0;
+    for (size_t pos = 0; pos < capacity; pos++) {
+        const double fraction = stats->getBusyFraction(pos);
+        ASSERT_GE(fraction, 0) << pos;
+        ASSERT_LE(fraction, 1) << pos;
+        busySlots += fraction * 2 * numSlots;
+    }
+    ASSERT_GE(busySlots + 0.5, static_cast<double>(released * assemblyDuration));
+    ASSERT_LE(busySlots - 0.5, static_cast<double>((released + capacity * 2) * assemblyDuration));
+}
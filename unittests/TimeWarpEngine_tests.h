@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "ABConveyorConfiguration.h"
+#include "ChunkedRunner.h"
+#include "TimeWarpEngine.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Either way, and however the belt is split, a run must reproduce the unsegmented run with the
+// same seed; small windows and checkpoint intervals force plenty of waiting and rollbacks
+TEST(TimeWarpEngineTest, TimeWarpEngineExactnessTest) {
+    for (const size_t numSegments: {1, 2, 3, 7}) {
+        for (const bool optimistic: {true, false}) {
+            TimeWarpEngine::Settings settings;
+            settings.optimistic = optimistic;
+            settings.checkpointInterval = 5;
+            settings.window = 40;
+            settings.batchSlots = 8;
+            const auto result = TimeWarpEngine(21, 2, numSegments, 13, settings).run(6000);
+            ABConveyorConfiguration sim(21, 2, 13);
+            sim.run(6000);
+            ASSERT_EQ(result.productCount, sim.getProductCount());
+            ASSERT_EQ(result.dropCount, sim.getDropCount());
+            ASSERT_EQ(result.numSlots, 6000);
+            ASSERT_GE(result.executedSlots - result.rolledBackSlots, 6000 * numSegments);
+            if (!optimistic || numSegments == 1) {
+                ASSERT_EQ(result.predictedSlots, 0);
+                ASSERT_EQ(result.rollbacks, 0);
+            }
+        }
+    }
+
+    const auto defaults = TimeWarpEngine(30, 3, 4, 2).run(20000);
+    ABConveyorConfiguration sim(30, 3, 2);
+    sim.run(20000);
+    ASSERT_EQ(defaults.productCount, sim.getProductCount());
+    ASSERT_EQ(defaults.dropCount, sim.getDropCount());
+}
+
+// Either way, a stop must end all segments at the same timeslot, with the counts of the
+// unsegmented run of it, including segments that ran ahead of it optimistically
+TEST(TimeWarpEngineTest, TimeWarpEngineStopTest) {
+    for (const bool optimistic: {true, false}) {
+        TimeWarpEngine::Settings settings;
+        settings.optimistic = optimistic;
+        settings.checkpointInterval = 5;
+        const size_t numSlots = 100000000;
+        thread stopper([] {
+            this_thread::sleep_for(chrono::milliseconds(50));
+            ChunkedRunner::requestStop();
+        });
+        const auto result = TimeWarpEngine(21, 2, 3, 13, settings).run(numSlots);
+        stopper.join();
+        ChunkedRunner::clearStopRequest();
+
+        ASSERT_LT(result.numSlots, numSlots);
+        ABConveyorConfiguration sim(21, 2, 13);
+        sim.run(result.numSlots);
+        ASSERT_EQ(result.productCount, sim.getProductCount()) << optimistic;
+        ASSERT_EQ(result.dropCount, sim.getDropCount()) << optimistic;
+    }
+}
+
+TEST(TimeWarpEngineTest, TimeWarpEngineInvalidTest) {
+    ASSERT_THROW(TimeWarpEngine(4, 1, 0, 1), invalid_argument);
+    ASSERT_THROW(TimeWarpEngine(4, 1, 5, 1), invalid_argument);
+    ASSERT_THROW(TimeWarpEngine(4, 5000000000, 2, 1), invalid_argument);
+    TimeWarpEngine::Settings settings;
+    settings.window = 0;
+    ASSERT_THROW(TimeWarpEngine(4, 1, 2, 1, settings), invalid_argument);
+    ASSERT_EQ(TimeWarpEngine(4, 1, 2, 1).run(0).productCount, 0);
+}
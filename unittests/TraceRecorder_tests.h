@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ABConveyorConfiguration.h"
+#include "ShardLauncher.h"
+#include "TimeWarpEngine.h"
+#include "TraceRecorder.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+namespace {
+
+size_t countOccurrences(const string& text, const string& pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+// A stream buffer that blocks the first write until it is released, so that the writer keeps
+// holding whatever it locked
+class BlockingBuffer : public streambuf {
+public:
+    future<void> getEntered() { return entered.get_future(); }
+    void release() { released.set_value(); }
+
+protected:
+    int_type overflow(const int_type ch) override {
+        if (!blocked) {
+            blocked = true;
+            entered.set_value();
+            released.get_future().wait();
+        }
+        return ch;
+    }
+
+private:
+    bool blocked = false;
+    promise<void> entered;
+    promise<void> released;
+};
+
+string takeEvents() {
+    ostringstream events;
+    TraceRecorder::writeEvents(events);
+    return events.str();
+}
+
+} // namespace
+
+// Only sampled timeslots of attached threads are recorded, into a ring that keeps the latest
+// events
+TEST(TraceRecorderTest, TraceRecorderSamplingTest) {
+    // Nothing is recorded while tracing is off
+    TraceRecorder::attachThread("main");
+    ABConveyorConfiguration fixed(8, 2, 1);
+    fixed.run(100);
+    ASSERT_EQ(takeEvents(), "");
+
+    TraceRecorder::enable(10, 16);
+    TraceRecorder::attachThread("main");
+    fixed.run(40);
+    auto events = takeEvents();
+    ASSERT_EQ(countOccurrences(events, "\"name\":\"generation\""), 4);
+    ASSERT_EQ(countOccurrences(events, "\"name\":\"rotation\""), 4);
+    ASSERT_EQ(countOccurrences(events, "\"name\":\"worker sweep\""), 4);
+    ASSERT_EQ(countOccurrences(events, "\"name\":\"thread_name\""), 1);
+    ASSERT_NE(events.find("\"args\":{\"name\":\"main\"}"), string::npos);
+    ASSERT_EQ(events.rfind(",\n{", 0), 0);
+
+    // The generic path too, with only the latest 16 events kept
+    ABConveyorConfiguration generic(8, 2, 1);
+    generic.enableStatistics(1);
+    generic.run(100);
+    events = takeEvents();
+    ASSERT_EQ(countOccurrences(events, "\"ph\":\"X\""), 16);
+    ASSERT_NE(events.find("\"args\":{\"slot\":130}"), string::npos);
+
+    TraceRecorder::disable();
+    generic.run(100);
+    ASSERT_EQ(countOccurrences(takeEvents(), "\"ph\":\"X\""), 0);
+    ASSERT_THROW(TraceRecorder::enable(0), invalid_argument);
+}
+
+// Threads and forked shards append their timelines to one trace file
+TEST(TraceRecorderTest, TraceRecorderFileTest) {
+    const string path = "/tmp/conveyor_sim_trace_" + to_string(getpid()) + ".json";
+    TraceRecorder::enable(1);
+    TraceRecorder::open(path);
+    (void) TimeWarpEngine(12, 2, 2, 3).run(500);
+    (void) ShardLauncher(12, 2, 2, 3).run(500);
+    TraceRecorder::close();
+    TraceRecorder::disable();
+
+    ifstream in(path);
+    const string trace((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(path.c_str());
+    ASSERT_EQ(trace.rfind("[{\"name\":\"process_name\"", 0), 0);
+    ASSERT_EQ(trace.substr(trace.size() - 3), "\n]\n");
+    for (const auto thread: {"segment 0", "segment 1", "shard 0", "shard 1"}) {
+        ASSERT_NE(trace.find("\"args\":{\"name\":\"" + string(thread) + "\"}"), string::npos) << thread;
+    }
+    ASSERT_NE(trace.find("\"name\":\"io\""), string::npos);
+    ASSERT_EQ(countOccurrences(trace, "{"), countOccurrences(trace, "}"));
+}
+
+// A child forked while another thread of the parent writes the events restarts tracing at once
+TEST(TraceRecorderTest, TraceRecorderRestartAfterForkTest) {
+    TraceRecorder::enable(1);
+    TraceRecorder::attachThread("main");
+    BlockingBuffer buffer;
+    auto entered = buffer.getEntered();
+    thread writer([&buffer] {
+        ostream os(&buffer);
+        TraceRecorder::writeEvents(os);
+    });
+    entered.wait();
+
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (!pid) {
+        TraceRecorder::restartAfterFork("child");
+        _exit(takeEvents().find("\"args\":{\"name\":\"child\"}") == string::npos);
+    }
+    int status = 0;
+    pid_t exited = 0;
+    for (size_t attempt = 0; attempt < 5000 && !exited; attempt++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        exited = waitpid(pid, &status, WNOHANG);
+    }
+    if (!exited) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    buffer.release();
+    writer.join();
+    TraceRecorder::disable();
+    ASSERT_EQ(exited, pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+}
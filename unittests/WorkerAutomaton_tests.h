@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include "ConveyorBelt.h"
+#include "ConveyorPositionController.h"
+#include "Worker.h"
+#include "WorkerAutomaton.h"
+#include "WorkerSpec.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// Every entry of the table must be what apply() works out for its state and inputs
+TEST(WorkerAutomatonTest, WorkerAutomatonTableTest) {
+    const WorkerSpec spec(4, {{ItemPN('A'), 2}, {ItemPN('B'), 1}}, ItemPN('P'), 3);
+    const auto automaton = WorkerAutomaton::build(spec);
+    ASSERT_NE(automaton, nullptr);
+    ASSERT_EQ(automaton->getState(0), WorkerAutomaton::initialState(spec));
+    for (uint16_t state = 0; state < automaton->getNumStates(); state++) {
+        ASSERT_EQ(automaton->findState(automaton->getState(state)), optional(state));
+        for (size_t content = 0; content < spec.getNumParts() + 2; content++) {
+            for (const bool reserved: {false, true}) {
+                for (const bool expired: {false, true}) {
+                    WorkerState next = automaton->getState(state);
+                    const uint8_t actions = WorkerAutomaton::apply(spec, next, content, reserved, expired);
+                    const auto& transition = automaton->transition(state, content, reserved, expired);
+                    ASSERT_EQ(transition.actions, actions);
+                    ASSERT_EQ(automaton->getState(transition.next), next);
+                }
+            }
+        }
+    }
+
+    // A surplus item takes an arm but does not count towards the assembly
+    WorkerState surplus = WorkerAutomaton::initialState(spec);
+    const size_t partB = spec.findPart(ItemPN('B')).value() + 1;
+    ASSERT_EQ(WorkerAutomaton::apply(spec, surplus, partB, false, true), WorkerAutomaton::Collect);
+    ASSERT_EQ(WorkerAutomaton::apply(spec, surplus, partB, false, true), WorkerAutomaton::Collect);
+    ASSERT_EQ(surplus.busyArms, 2);
+    ASSERT_EQ(surplus.neededItemsCount, 2);
+    ASSERT_FALSE(surplus.busy);
+
+    ASSERT_EQ(WorkerAutomaton::classify(spec, nullopt), 0);
+    ASSERT_EQ(WorkerAutomaton::classify(spec, Item(ItemPN('P'))), spec.getNumParts() + 1);
+
+    // Too many states to tabulate
+    const WorkerSpec large(WorkerSpec::MaxArms, {{ItemPN('A'), 60}, {ItemPN('B'), 60}, {ItemPN('C'), 60}},
+                           ItemPN('P'), 1);
+    ASSERT_EQ(WorkerAutomaton::build(large), nullptr);
+}
+
+// Workers looking their timeslots up must do what working them out with apply() does
+TEST(WorkerAutomatonTest, WorkerAutomatonEquivalenceTest) {
+    const vector<WorkerSpec> specs = {
+            WorkerSpec(2, {{ItemPN('A'), 1}, {ItemPN('B'), 1}}, ItemPN('P'), 0),
+            WorkerSpec(2, {{ItemPN('A'), 1}, {ItemPN('B'), 1}}, ItemPN('P'), 4),
+            WorkerSpec(5, {{ItemPN('A'), 2}, {ItemPN('B'), 1}}, ItemPN('P'), 2),
+            WorkerSpec(3, {{ItemPN('A'), 1}, {ItemPN('B'), 1}, {ItemPN('C'), 1}}, ItemPN('D'), 1),
+    };
+    for (const auto& spec: specs) {
+        const auto automaton = WorkerAutomaton::build(spec);
+        ASSERT_NE(automaton, nullptr);
+        const WorkerContext context{spec, *automaton};
+        ConveyorBelt tabulatedBelt(3);
+        ConveyorBelt workedOutBelt(3);
+        ConveyorPositionController tabulatedController(tabulatedBelt, 1);
+        Worker tabulated;
+        WorkerState workedOut = WorkerAutomaton::initialState(spec);
+        size_t workedOutCountdown = 0;
+        mt19937 rng(7);
+        for (size_t slot = 0; slot < 3000; slot++) {
+            tabulatedBelt.run(1);
+            workedOutBelt.run(1);
+            const size_t draw = rng() % 6;
+            if (draw < 4) {
+                tabulatedBelt.enqueueItem(Item(ItemPN('A' + draw)));
+                workedOutBelt.enqueueItem(Item(ItemPN('A' + draw)));
+            }
+            tabulated.run(context, tabulatedController, 0);
+
+            if (workedOutCountdown) {
+                workedOutCountdown--;
+            }
+            const uint8_t actions = WorkerAutomaton::apply(spec, workedOut,
+                                                           WorkerAutomaton::classify(spec, workedOutBelt.peekItem(1)),
+                                                           workedOutBelt.isReserved(1), !workedOutCountdown);
+            if (actions & WorkerAutomaton::Collect) {
+                (void) workedOutBelt.collectItem(1);
+            }
+            if (actions & WorkerAutomaton::Start) {
+                workedOutCountdown = spec.getAssemblyDuration();
+            }
+            if (actions & WorkerAutomaton::Release) {
+                workedOutBelt.emplaceItem(Item(spec.getProductPN()), 1);
+            }
+
+            ostringstream tabulatedState;
+            ostringstream workedOutState;
+            tabulatedState << tabulatedBelt;
+            workedOutState << workedOutBelt;
+            ASSERT_EQ(tabulatedState.str(), workedOutState.str()) << slot;
+        }
+    }
+}
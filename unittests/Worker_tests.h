@@ -4,7 +4,11 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <memory>
+#include "SimulationStatistics.h"
 #include "Worker.h"
+#include "WorkerAutomaton.h"
+#include "WorkerSpec.h"
 #include "ConveyorPositionController.h"
 #include "ConveyorBelt.h"
 
@@ -20,21 +24,29 @@ class WorkerTestFixture : public ::testing::Test {
     // run enough timeslots to empty the belt and the worker
     void TearDown() override {
         belt.run(1);
-        worker.run(2);
+        runWorker(2);
         belt.run(1);
     }
 protected:
+    void runWorker(const size_t& numSlots, const size_t& workerIdx = 0) {
+        for (size_t slot = 0; slot < numSlots; slot++) {
+            worker.run(context, controller, workerIdx);
+        }
+    }
+
     const size_t capacity = 1;
     const size_t duration = 2;
     const size_t numArms = 2;
     ConveyorBelt belt = ConveyorBelt(1);
     ConveyorPositionController controller = ConveyorPositionController(belt,0);
-    Worker worker = Worker(controller,
-                    numArms,
+    WorkerSpec spec = WorkerSpec(numArms,
                     {{ItemPN('A'), 1}, {ItemPN('B'),1}},
                     ItemPN('P'),
                     duration
                     );
+    const std::unique_ptr<const WorkerAutomaton> automaton = WorkerAutomaton::build(spec);
+    WorkerContext context{spec, *automaton};
+    Worker worker;
 
 };
 
@@ -43,8 +55,7 @@ protected:
 
 TEST_F(WorkerTestFixture, WorkerFailTest) {
     // Throws on arms less than total quotas:
-    ASSERT_THROW(Worker worker(controller,
-                               1,
+    ASSERT_THROW(WorkerSpec spec(1,
                                {{ItemPN('A'), 1},
                                 {ItemPN('B'), 1}},
                                ItemPN('P'),
@@ -52,8 +63,15 @@ TEST_F(WorkerTestFixture, WorkerFailTest) {
     ), invalid_argument);
 
     // Throws on no arms:
-    ASSERT_THROW(Worker worker(controller,
-                               0,
+    ASSERT_THROW(WorkerSpec spec(0,
+                               {{ItemPN('A'), 1},
+                                {ItemPN('B'), 1}},
+                               ItemPN('P'),
+                               2
+    ), invalid_argument);
+
+    // Throws on more arms than the held item counters can count:
+    ASSERT_THROW(WorkerSpec spec(WorkerSpec::MaxArms + 1,
                                {{ItemPN('A'), 1},
                                 {ItemPN('B'), 1}},
                                ItemPN('P'),
@@ -61,8 +79,7 @@ TEST_F(WorkerTestFixture, WorkerFailTest) {
     ), invalid_argument);
 
     // This construction is valid and should not throw:
-    ASSERT_NO_THROW(Worker worker(controller,
-                                  2,
+    ASSERT_NO_THROW(WorkerSpec spec(2,
                                   {{ItemPN('A'), 1}, {ItemPN('B'),1}},
                                   ItemPN('P'),
                                   2
@@ -70,16 +87,34 @@ TEST_F(WorkerTestFixture, WorkerFailTest) {
 
 }
 
+// A worker reports to the statistics of its context under the index it is run with
+TEST_F(WorkerTestFixture, WorkerStatisticsIndexTest) {
+    SimulationStatistics stats(capacity, 1);
+    stats.startSlot();
+    belt.enqueueItem(Item(ItemPN('A'), stats.getSlot()));
+    runWorker(1);
+    context.statistics = &stats;
+    stats.startSlot();
+    belt.run(1);
+    belt.enqueueItem(Item(ItemPN('B'), stats.getSlot()));
+    runWorker(1, 1);
+    context.statistics = nullptr;
+    ASSERT_EQ(stats.getCollectionLatency(0).getCount(), 1);
+    // The 'B' starts the assembly in the timeslot it is collected; one of the two workers of the
+    // position was busy for one of the two timeslots
+    ASSERT_DOUBLE_EQ(stats.getBusyFraction(0), 0.25);
+}
+
 // Do nothing for a timeslot
 TEST_F(WorkerTestFixture, WorkerDoNothingTest) {
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
 }
 
 // Put an unrelated item on the belt, worker should not take it
 TEST_F(WorkerTestFixture, WorkerSkipsTest) {
     Item itm(ItemPN('C'));
     belt.enqueueItem(forward<Item>(itm));
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
     ASSERT_EQ(itm, belt.peekItem(0));
 
 }
@@ -91,51 +126,83 @@ TEST_F(WorkerTestFixture, WorkerSucceedsTest) {
     // Worker should be able to claim it:
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('A')));
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
     ASSERT_TRUE(belt.isEmpty(0));
 
     // Run the belt and put the same item on it.
     // Worker has enough of that item and no free hands, so should not be able to claim it:
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('A')));
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
     ASSERT_FALSE(belt.isEmpty(0));
 
     // Run the belt and put a needed item on it but reserve the timeslot.
     // Worker should not be able to claim it:
     belt.run(1);
     belt.emplaceItem(Item(ItemPN('B')),0);
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
     ASSERT_FALSE(belt.isEmpty(0));
 
     // Run the belt and put the other needed item on it
     // Worker should be able to claim it:
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('B')));
-    ASSERT_NO_THROW(worker.run(1));
+    ASSERT_NO_THROW(runWorker(1));
     ASSERT_TRUE(belt.isEmpty(0));
 
     // Item should be ready within two timeslots.
     // Also check that it cannot collect an item during assembly
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('A')));
-    worker.run(1);
+    runWorker(1);
     ASSERT_FALSE(belt.isEmpty(0));
     belt.run(1);
-    worker.run(1);
+    runWorker(1);
     ASSERT_EQ(Item(ItemPN('P')),belt.peekItem(0));
 }
 
 // Test that worker fails to place product on the belt
 TEST_F(WorkerTestFixture, WorkerNoRoomTest) {
     belt.enqueueItem(Item(ItemPN('A')));
-    worker.run(1);
+    runWorker(1);
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('B')));
-    worker.run(1);
+    runWorker(1);
     belt.run(1);
     belt.enqueueItem(Item(ItemPN('A')));
-    worker.run(1);
-    worker.run(1);
+    runWorker(1);
+    runWorker(1);
     ASSERT_EQ(Item(ItemPN('A')), belt.peekItem(0));
 }
+
+// Workers sharing a context keep their own state: one of them assembling does not affect the
+// other
+TEST(WorkerTest, WorkerSharedSpecTest) {
+    const WorkerSpec spec(2, {{ItemPN('A'), 1}, {ItemPN('B'), 1}}, ItemPN('P'), 1);
+    const auto automaton = WorkerAutomaton::build(spec);
+    const WorkerContext context{spec, *automaton};
+    ConveyorBelt belt(2);
+    ConveyorPositionController first(belt, 0);
+    ConveyorPositionController second(belt, 1);
+    Worker firstWorker;
+    Worker secondWorker;
+
+    belt.enqueueItem(Item(ItemPN('A')));
+    firstWorker.run(context, first, 0);
+    belt.run(1);
+    belt.enqueueItem(Item(ItemPN('B')));
+    firstWorker.run(context, first, 0);
+    ASSERT_TRUE(belt.isEmpty(0));
+
+    // The first worker is assembling and skips the next 'A', which the second worker still
+    // needs; the first one places its product once the 'A' moved on
+    belt.run(1);
+    belt.enqueueItem(Item(ItemPN('A')));
+    firstWorker.run(context, first, 0);
+    ASSERT_FALSE(belt.isEmpty(0));
+    belt.run(1);
+    secondWorker.run(context, second, 2);
+    ASSERT_TRUE(belt.isEmpty(1));
+    firstWorker.run(context, first, 0);
+    ASSERT_EQ(Item(ItemPN('P')), belt.peekItem(0));
+}
@@ -7,6 +7,29 @@
 #include "UniformRandomItemGenerator_tests.h"
 #include "ConveyorBelt_tests.h"
 #include "Worker_tests.h"
+#include "LogHistogram_tests.h"
+#include "SimulationStatistics_tests.h"
+#include "MarkovChainSolver_tests.h"
+#include "MeanFieldApproximation_tests.h"
+#include "CommonRandomNumbersComparison_tests.h"
+#include "LockstepReplicaEngine_tests.h"
+#include "LiveMetrics_tests.h"
+#include "ChunkedRunner_tests.h"
+#include "conveyorsim_tests.h"
+#include "BeltShard_tests.h"
+#include "ArbitrationPolicies_tests.h"
+#include "CapacityOptimizer_tests.h"
+#include "JobServer_tests.h"
+#include "FixedShapeEngine_tests.h"
+#include "TimeWarpEngine_tests.h"
+#include "WorkerAutomaton_tests.h"
+#include "TraceRecorder_tests.h"
+#include "PerfCounters_tests.h"
+#include "MemoryPlacement_tests.h"
+#include "OutOfCoreEngine_tests.h"
+#include "EngineCalibration_tests.h"
+#include "ForkedReplicas_tests.h"
+#include "CycleDetectingEngine_tests.h"
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,81 @@
+//
+// Copyright (c) 2020 Konstantinos Fragkiadakis. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "ABConveyorConfiguration.h"
+#include "conveyorsim.h"
+
+using namespace std;
+using namespace conveyorsim;
+
+// A configuration created through the C interface must run like the seeded C++ configuration,
+// also after a reset
+TEST(ConveyorsimCTest, ConveyorsimCRunResetTest) {
+    const conveyorsim_params params{sizeof(conveyorsim_params), 6, 2, 17, 1};
+    conveyorsim_config* config = nullptr;
+    ASSERT_EQ(conveyorsim_create(&params, &config), CONVEYORSIM_OK);
+
+    ABConveyorConfiguration sim(6, 2, 17);
+    sim.run(5000);
+    for (int pass = 0; pass < 2; pass++) {
+        ASSERT_EQ(conveyorsim_run(config, 2000), CONVEYORSIM_OK);
+        ASSERT_EQ(conveyorsim_run(config, 3000), CONVEYORSIM_OK);
+        conveyorsim_counters counters{};
+        ASSERT_EQ(conveyorsim_read(config, &counters), CONVEYORSIM_OK);
+        ASSERT_EQ(counters.slots, 5000);
+        ASSERT_EQ(counters.product_count, sim.getProductCount());
+        ASSERT_EQ(counters.drop_count, sim.getDropCount());
+        ASSERT_EQ(counters.occupied_positions, sim.getOccupiedPositions());
+        ASSERT_EQ(conveyorsim_reset(config, 17, 1), CONVEYORSIM_OK);
+    }
+    conveyorsim_destroy(config);
+}
+
+// Every batch entry must get the counters of its own run, and invalid entries their status
+TEST(ConveyorsimCTest, ConveyorsimCBatchTest) {
+    vector<conveyorsim_batch_entry> entries;
+    for (uint64_t idx = 0; idx < 12; idx++) {
+        entries.push_back({sizeof(conveyorsim_batch_entry), {sizeof(conveyorsim_params), 1 + idx % 5, idx % 4, idx, 1},
+                           1000 + 100 * idx, {}, CONVEYORSIM_ERROR});
+    }
+    entries[7].params.capacity = 0;
+    entries[9].params.struct_size = sizeof(conveyorsim_params) - sizeof(size_t);
+    ASSERT_EQ(conveyorsim_run_batch(entries.data(), entries.size(), 3), CONVEYORSIM_OK);
+
+    for (const auto& entry: entries) {
+        if (!entry.params.capacity || entry.params.struct_size != sizeof(conveyorsim_params)) {
+            ASSERT_EQ(entry.status, CONVEYORSIM_INVALID_ARGUMENT);
+            continue;
+        }
+        ASSERT_EQ(entry.status, CONVEYORSIM_OK);
+        ABConveyorConfiguration sim(entry.params.capacity, entry.params.assembly_duration, entry.params.seed);
+        sim.run(entry.num_slots);
+        ASSERT_EQ(entry.counters.slots, entry.num_slots);
+        ASSERT_EQ(entry.counters.product_count, sim.getProductCount());
+        ASSERT_EQ(entry.counters.drop_count, sim.getDropCount());
+    }
+    ASSERT_EQ(conveyorsim_run_batch(nullptr, 1, 0), CONVEYORSIM_INVALID_ARGUMENT);
+}
+
+// Structures of a size the library does not know are rejected rather than misread
+TEST(ConveyorsimCTest, ConveyorsimCStructSizeTest) {
+    conveyorsim_params params{sizeof(conveyorsim_params) + 8, 6, 2, 17, 1};
+    conveyorsim_config* config = nullptr;
+    ASSERT_EQ(conveyorsim_create(&params, &config), CONVEYORSIM_INVALID_ARGUMENT);
+    params.struct_size = 0;
+    ASSERT_EQ(conveyorsim_create(&params, &config), CONVEYORSIM_INVALID_ARGUMENT);
+    ASSERT_EQ(config, nullptr);
+
+    params.struct_size = sizeof(conveyorsim_params);
+    conveyorsim_batch_entry entries[2] = {{sizeof(conveyorsim_batch_entry) - 8, params, 100, {}, CONVEYORSIM_ERROR},
+                                          {sizeof(conveyorsim_batch_entry), params, 100, {}, CONVEYORSIM_ERROR}};
+    ASSERT_EQ(conveyorsim_run_batch(entries, 2, 1), CONVEYORSIM_INVALID_ARGUMENT);
+    ASSERT_EQ(entries[1].status, CONVEYORSIM_ERROR);
+    entries[0].struct_size = sizeof(conveyorsim_batch_entry);
+    entries[1].struct_size = 0;
+    ASSERT_EQ(conveyorsim_run_batch(entries, 2, 1), CONVEYORSIM_OK);
+    ASSERT_EQ(entries[0].status, CONVEYORSIM_OK);
+    ASSERT_EQ(entries[1].status, CONVEYORSIM_INVALID_ARGUMENT);
+    ASSERT_EQ(conveyorsim_abi_version(), CONVEYORSIM_ABI_VERSION);
+}